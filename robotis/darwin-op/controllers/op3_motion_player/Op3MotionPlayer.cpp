@@ -74,6 +74,11 @@ void Op3MotionPlayer::run() {
   mBodyLED->set(0xFF00FF);
   myStep();
 
+  // expand the pages of the demo loop once, replaying them is then only a copy of the cached joint positions
+  static const int pages[] = {1, 38, 46, 83, 84, 55};
+  for (unsigned int i = 0; i < sizeof(pages) / sizeof(pages[0]); i++)
+    mMotionManager->preloadPage(pages[i]);
+
   mMotionManager->playPage(1);  // Standing position.
 
   while (true) {
@@ -0,0 +1,438 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "GridPlanner.hpp"
+#include "OccupancyGrid.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace std;
+
+static const float cInfinity = numeric_limits<float>::infinity();
+static const float cSqrt2 = 1.41421356f;
+
+// the 8 neighbors, the diagonal ones last
+static const int cDirections = 8;
+static const int cDirectionX[cDirections] = {1, 0, -1, 0, 1, -1, -1, 1};
+static const int cDirectionY[cDirections] = {0, 1, 0, -1, 1, 1, -1, -1};
+static const float cDirectionCost[cDirections] = {1.0f, 1.0f, 1.0f, 1.0f, cSqrt2, cSqrt2, cSqrt2, cSqrt2};
+// extra cost of a cell closer than the clearance to an obstacle, high enough to go around, but the robot
+// can still get out when an obstacle appears next to it
+static const float cInflatedCost = 10.0f;
+
+GridPlanner::GridPlanner(OccupancyGrid *grid, float clearance) :
+  mGrid(grid),
+  mGoal(-1),
+  mStart(-1),
+  mLastStart(-1),
+  mKm(0.0f),
+  mLastExpansions(0),
+  mSearchStamp(0) {
+  mWidth = grid->width();
+  mHeight = grid->height();
+  const int size = mWidth * mHeight;
+
+  mInflation = (int)ceil(clearance / grid->resolution());
+  for (int dy = -mInflation; dy <= mInflation; dy++) {
+    for (int dx = -mInflation; dx <= mInflation; dx++) {
+      if (dx * dx + dy * dy <= mInflation * mInflation) {
+        mInflationOffsetsX.push_back(dx);
+        mInflationOffsetsY.push_back(dy);
+      }
+    }
+  }
+  mObstacleCounts.assign(size, 0);
+  mOccupied.assign(size, 0);
+
+  mHeapIndex.assign(size, -1);
+  mG.assign(size, cInfinity);
+  mRhs.assign(size, cInfinity);
+  mSearchG.assign(size, cInfinity);
+  mSearchParent.assign(size, -1);
+  mSearchStamps.assign(size, 0);
+
+  recomputeObstacleCounts();
+  mGrid->clearChanges();
+}
+
+GridPlanner::~GridPlanner() {
+}
+
+float GridPlanner::heuristic(int a, int b) const {
+  // octile distance
+  const int dx = abs(nodeX(a) - nodeX(b));
+  const int dy = abs(nodeY(a) - nodeY(b));
+  return dx > dy ? dx + (cSqrt2 - 1.0f) * dy : dy + (cSqrt2 - 1.0f) * dx;
+}
+
+float GridPlanner::cost(int goal, int to, int direction) const {
+  // the cost depends only on the entered cell, the goal is always reachable from its neighbors
+  if (to == goal || mObstacleCounts[to] == 0)
+    return cDirectionCost[direction];
+  return mOccupied[to] ? cInfinity : cDirectionCost[direction] + cInflatedCost;
+}
+
+void GridPlanner::costChanged(int n) {
+  if (mGoal < 0 || mLastStart < 0)
+    return;
+  // the costs of the edges entering the cell changed
+  const int x = nodeX(n);
+  const int y = nodeY(n);
+  for (int d = 0; d < cDirections; d++) {
+    const int px = x + cDirectionX[d];
+    const int py = y + cDirectionY[d];
+    if (px >= 0 && py >= 0 && px < mWidth && py < mHeight)
+      updateVertex(node(px, py));
+  }
+}
+
+void GridPlanner::updateObstacleCounts(int cx, int cy, int delta) {
+  const int center = node(cx, cy);
+  mOccupied[center] = delta > 0;
+  costChanged(center);
+  const int n = mInflationOffsetsX.size();
+  for (int i = 0; i < n; i++) {
+    const int x = cx + mInflationOffsetsX[i];
+    const int y = cy + mInflationOffsetsY[i];
+    if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+      continue;
+    unsigned short &count = mObstacleCounts[node(x, y)];
+    const bool wasInflated = count > 0;
+    count += delta;
+    if (wasInflated != (count > 0) && node(x, y) != center)
+      costChanged(node(x, y));
+  }
+}
+
+void GridPlanner::recomputeObstacleCounts() {
+  mObstacleCounts.assign(mWidth * mHeight, 0);
+  mOccupied.assign(mWidth * mHeight, 0);
+  mLastStart = -1;  // no vertex update, D* Lite starts again at the next step
+  for (int y = 0; y < mHeight; y++) {
+    for (int x = 0; x < mWidth; x++) {
+      if (mGrid->isOccupied(x, y))
+        updateObstacleCounts(x, y, 1);
+    }
+  }
+}
+
+void GridPlanner::applyMapChanges() {
+  if (mGrid->changesOverflowed())
+    recomputeObstacleCounts();
+  else {
+    // a cell which flipped several times is listed as many times, only its final state counts
+    const vector<int> &changes = mGrid->changes();
+    for (size_t i = 0; i < changes.size(); i++) {
+      const int x = changes[i] % mWidth;
+      const int y = changes[i] / mWidth;
+      const bool occupied = mGrid->isOccupied(x, y);
+      if (occupied != (mOccupied[changes[i]] != 0))
+        updateObstacleCounts(x, y, occupied ? 1 : -1);
+    }
+  }
+  mGrid->clearChanges();
+}
+
+bool GridPlanner::findPath(int startX, int startY, int goalX, int goalY, vector<int> *path, float *length) {
+  const int start = node(startX, startY);
+  const int goal = node(goalX, goalY);
+  path->clear();
+
+  // the heap is shared with D* Lite, whose search is restarted by the next setGoal() or computePath()
+  heapClear();
+  if (++mSearchStamp == 0) {
+    mSearchStamps.assign(mWidth * mHeight, 0);
+    mSearchStamp = 1;
+  }
+  mSearchStamps[start] = mSearchStamp;
+  mSearchG[start] = 0.0f;
+  mSearchParent[start] = -1;
+  const Key startKey = {heuristic(start, goal), 0.0f};
+  heapPush(start, startKey);
+
+  bool found = false;
+  while (!mHeap.empty()) {
+    const int u = mHeap[0].node;
+    heapPop();
+    if (u == goal) {
+      found = true;
+      break;
+    }
+    const int ux = nodeX(u);
+    const int uy = nodeY(u);
+    for (int d = 0; d < cDirections; d++) {
+      const int x = ux + cDirectionX[d];
+      const int y = uy + cDirectionY[d];
+      if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+        continue;
+      const int v = node(x, y);
+      const float g = mSearchG[u] + cost(goal, v, d);
+      if (g == cInfinity)
+        continue;
+      if (mSearchStamps[v] == mSearchStamp && g >= mSearchG[v])
+        continue;
+      mSearchStamps[v] = mSearchStamp;
+      mSearchG[v] = g;
+      mSearchParent[v] = u;
+      const Key key = {g + heuristic(v, goal), g};
+      if (mHeapIndex[v] >= 0)
+        heapUpdate(v, key);
+      else
+        heapPush(v, key);
+    }
+  }
+  heapClear();
+  mLastStart = -1;  // forces a restart of D* Lite
+
+  if (!found)
+    return false;
+  if (length)
+    *length = mSearchG[goal];
+  for (int n = goal; n >= 0; n = mSearchParent[n])
+    path->push_back(n);
+  for (size_t i = 0, j = path->size() - 1; i < j; i++, j--) {
+    const int tmp = (*path)[i];
+    (*path)[i] = (*path)[j];
+    (*path)[j] = tmp;
+  }
+  return true;
+}
+
+void GridPlanner::setGoal(int goalX, int goalY) {
+  mGoal = node(goalX, goalY);
+  resetSearch();
+}
+
+void GridPlanner::resetSearch() {
+  heapClear();
+  mG.assign(mWidth * mHeight, cInfinity);
+  mRhs.assign(mWidth * mHeight, cInfinity);
+  mKm = 0.0f;
+  mRhs[mGoal] = 0.0f;
+  if (mStart >= 0) {
+    mLastStart = mStart;
+    heapPush(mGoal, calculateKey(mGoal));
+  } else
+    mLastStart = -1;
+}
+
+void GridPlanner::setStart(int startX, int startY) {
+  mStart = node(startX, startY);
+  if (mGoal < 0)
+    return;
+  if (mLastStart < 0)
+    resetSearch();  // first start since the goal was set, or A* used the heap
+  else if (mStart != mLastStart) {
+    // the keys already in the heap are lower bounds from the old start, km keeps them comparable
+    mKm += heuristic(mLastStart, mStart);
+    mLastStart = mStart;
+  }
+}
+
+GridPlanner::Key GridPlanner::calculateKey(int n) const {
+  const float m = mG[n] < mRhs[n] ? mG[n] : mRhs[n];
+  const Key key = {m + heuristic(mStart, n) + mKm, m};
+  return key;
+}
+
+void GridPlanner::updateVertex(int n) {
+  if (n != mGoal) {
+    // rhs is the best cost through a neighbor, the edges are symmetric except for the blocked cells
+    float rhs = cInfinity;
+    const int x = nodeX(n);
+    const int y = nodeY(n);
+    for (int d = 0; d < cDirections; d++) {
+      const int sx = x + cDirectionX[d];
+      const int sy = y + cDirectionY[d];
+      if (sx < 0 || sy < 0 || sx >= mWidth || sy >= mHeight)
+        continue;
+      const int s = node(sx, sy);
+      const float value = mG[s] + cost(mGoal, s, d);
+      if (value < rhs)
+        rhs = value;
+    }
+    mRhs[n] = rhs;
+  }
+  if (mG[n] != mRhs[n]) {
+    if (mHeapIndex[n] >= 0)
+      heapUpdate(n, calculateKey(n));
+    else
+      heapPush(n, calculateKey(n));
+  } else if (mHeapIndex[n] >= 0)
+    heapRemove(n);
+}
+
+bool GridPlanner::computePath(int maxExpansions) {
+  mLastExpansions = 0;
+  if (mGoal < 0 || mStart < 0)
+    return false;
+  if (mLastStart < 0)
+    resetSearch();
+  while (!mHeap.empty() && (mHeap[0].key < calculateKey(mStart) || mRhs[mStart] != mG[mStart])) {
+    if (mLastExpansions >= maxExpansions)
+      return false;  // resumed at the next call
+    mLastExpansions++;
+    const int u = mHeap[0].node;
+    const Key oldKey = mHeap[0].key;
+    const Key newKey = calculateKey(u);
+    const int ux = nodeX(u);
+    const int uy = nodeY(u);
+    if (oldKey < newKey)
+      heapUpdate(u, newKey);
+    else if (mG[u] > mRhs[u]) {
+      mG[u] = mRhs[u];
+      heapRemove(u);
+      for (int d = 0; d < cDirections; d++) {
+        const int x = ux + cDirectionX[d];
+        const int y = uy + cDirectionY[d];
+        if (x >= 0 && y >= 0 && x < mWidth && y < mHeight)
+          updateVertex(node(x, y));
+      }
+    } else {
+      mG[u] = cInfinity;
+      for (int d = 0; d < cDirections; d++) {
+        const int x = ux + cDirectionX[d];
+        const int y = uy + cDirectionY[d];
+        if (x >= 0 && y >= 0 && x < mWidth && y < mHeight)
+          updateVertex(node(x, y));
+      }
+      updateVertex(u);
+    }
+  }
+  return mG[mStart] != cInfinity;
+}
+
+float GridPlanner::pathCost() const {
+  return (mGoal >= 0 && mStart >= 0) ? mG[mStart] : cInfinity;
+}
+
+bool GridPlanner::nextWaypoint(float lookahead, float *x, float *y) {
+  if (pathCost() == cInfinity)
+    return false;
+
+  // follows the best neighbor from the start, as long as the path stays closer than the lookahead
+  const float limit = lookahead / mGrid->resolution();
+  const int sx = nodeX(mStart);
+  const int sy = nodeY(mStart);
+  int n = mStart;
+  int waypoint = mStart;
+  mPath.clear();
+  while (n != mGoal && (int)mPath.size() < mWidth + mHeight) {
+    const int nx = nodeX(n);
+    const int ny = nodeY(n);
+    int best = -1;
+    float bestValue = cInfinity;
+    for (int d = 0; d < cDirections; d++) {
+      const int cx = nx + cDirectionX[d];
+      const int cy = ny + cDirectionY[d];
+      if (cx < 0 || cy < 0 || cx >= mWidth || cy >= mHeight)
+        continue;
+      const int s = node(cx, cy);
+      const float value = mG[s] + cost(mGoal, s, d);
+      if (value < bestValue) {
+        bestValue = value;
+        best = s;
+      }
+    }
+    if (best < 0 || bestValue == cInfinity)
+      break;
+    n = best;
+    mPath.push_back(n);
+    const float dx = (float)(nodeX(n) - sx);
+    const float dy = (float)(nodeY(n) - sy);
+    if (dx * dx + dy * dy > limit * limit)
+      break;
+    waypoint = n;
+  }
+  mGrid->cellToWorld(nodeX(waypoint), nodeY(waypoint), x, y);
+  return true;
+}
+
+void GridPlanner::heapPush(int n, const Key &key) {
+  const HeapEntry entry = {key, n};
+  mHeap.push_back(entry);
+  mHeapIndex[n] = mHeap.size() - 1;
+  heapSiftUp(mHeap.size() - 1);
+}
+
+void GridPlanner::heapUpdate(int n, const Key &key) {
+  const int position = mHeapIndex[n];
+  const bool decreased = key < mHeap[position].key;
+  mHeap[position].key = key;
+  if (decreased)
+    heapSiftUp(position);
+  else
+    heapSiftDown(position);
+}
+
+void GridPlanner::heapRemove(int n) {
+  const int position = mHeapIndex[n];
+  const int last = mHeap.size() - 1;
+  mHeapIndex[n] = -1;
+  if (position != last) {
+    mHeap[position] = mHeap[last];
+    mHeapIndex[mHeap[position].node] = position;
+    mHeap.pop_back();
+    if (position > 0 && mHeap[position].key < mHeap[(position - 1) / 2].key)
+      heapSiftUp(position);
+    else
+      heapSiftDown(position);
+  } else
+    mHeap.pop_back();
+}
+
+void GridPlanner::heapPop() {
+  heapRemove(mHeap[0].node);
+}
+
+void GridPlanner::heapSiftUp(int position) {
+  const HeapEntry entry = mHeap[position];
+  while (position > 0) {
+    const int parent = (position - 1) / 2;
+    if (!(entry.key < mHeap[parent].key))
+      break;
+    mHeap[position] = mHeap[parent];
+    mHeapIndex[mHeap[position].node] = position;
+    position = parent;
+  }
+  mHeap[position] = entry;
+  mHeapIndex[entry.node] = position;
+}
+
+void GridPlanner::heapSiftDown(int position) {
+  const HeapEntry entry = mHeap[position];
+  const int size = mHeap.size();
+  while (true) {
+    int child = 2 * position + 1;
+    if (child >= size)
+      break;
+    if (child + 1 < size && mHeap[child + 1].key < mHeap[child].key)
+      child++;
+    if (!(mHeap[child].key < entry.key))
+      break;
+    mHeap[position] = mHeap[child];
+    mHeapIndex[mHeap[position].node] = position;
+    position = child;
+  }
+  mHeap[position] = entry;
+  mHeapIndex[entry.node] = position;
+}
+
+void GridPlanner::heapClear() {
+  for (size_t i = 0; i < mHeap.size(); i++)
+    mHeapIndex[mHeap[i].node] = -1;
+  mHeap.clear();
+}
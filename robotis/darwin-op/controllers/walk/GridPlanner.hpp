@@ -0,0 +1,122 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   A* and D* Lite path search over the cells of an occupancy grid
+
+#ifndef GRID_PLANNER_HPP
+#define GRID_PLANNER_HPP
+
+#include <vector>
+
+class OccupancyGrid;
+
+// The nodes are the cells of the grid, 8-connected, indexed by y * width + x in flat arrays allocated
+// once. The costs are in cells: an occupied cell cannot be entered and a cell closer than the clearance
+// to an occupied cell costs much more, except the goal so that an exhibit standing close to its key point
+// can still be reached.
+//
+// findPath() is a one-shot A* search. The D* Lite search is kept between the steps: it searches from the
+// goal to the robot, so that when the robot moves or when a few cells of the map change, only the
+// affected part of the search is repaired. computePath() can be given a budget of expansions so that
+// a replanning never takes more than a fraction of a control step, it resumes at the next call.
+class GridPlanner {
+public:
+  GridPlanner(OccupancyGrid *grid, float clearance);
+  virtual ~GridPlanner();
+
+  // updates the blocked cells with the changes of the occupancy grid since the last call
+  void applyMapChanges();
+  bool isBlocked(int x, int y) const { return mObstacleCounts[node(x, y)] > 0; }
+
+  // A* from scratch, path from start to goal (both included), false if the goal cannot be reached
+  bool findPath(int startX, int startY, int goalX, int goalY, std::vector<int> *path, float *length = 0);
+
+  // D* Lite
+  void setGoal(int goalX, int goalY);
+  void clearGoal() { mGoal = -1; }
+  bool hasGoal() const { return mGoal >= 0; }
+  bool isGoal(int x, int y) const { return mGoal == node(x, y); }
+  void setStart(int startX, int startY);
+  // true when the shortest path from the start is known, false if the budget ran out or if there is no path
+  bool computePath(int maxExpansions);
+  float pathCost() const;  // from the start, infinite if unknown
+  // farthest point of the path closer than lookahead (in meters) to the start, in world coordinates
+  bool nextWaypoint(float lookahead, float *x, float *y);
+  int lastExpansions() const { return mLastExpansions; }
+
+  int node(int x, int y) const { return y * mWidth + x; }
+  int nodeX(int n) const { return n % mWidth; }
+  int nodeY(int n) const { return n / mWidth; }
+
+private:
+  struct Key {
+    float k1;
+    float k2;
+    bool operator<(const Key &other) const { return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2); }
+  };
+  struct HeapEntry {
+    Key key;
+    int node;
+  };
+
+  float heuristic(int a, int b) const;
+  float cost(int goal, int to, int direction) const;
+  void costChanged(int n);
+  void updateObstacleCounts(int cx, int cy, int delta);
+  void recomputeObstacleCounts();
+
+  // D* Lite
+  Key calculateKey(int n) const;
+  void updateVertex(int n);
+  void resetSearch();
+
+  // binary heap of the open nodes, mHeapIndex gives the position of each node in the heap
+  void heapPush(int n, const Key &key);
+  void heapUpdate(int n, const Key &key);
+  void heapRemove(int n);
+  void heapPop();
+  void heapSiftUp(int position);
+  void heapSiftDown(int position);
+  void heapClear();
+
+  OccupancyGrid *mGrid;
+  int mWidth, mHeight;
+  int mInflation;  // clearance in cells
+  std::vector<int> mInflationOffsetsX;
+  std::vector<int> mInflationOffsetsY;
+  // number of occupied cells closer than the clearance, the cell is blocked if it is not 0
+  std::vector<unsigned short> mObstacleCounts;
+  std::vector<unsigned char> mOccupied;
+
+  std::vector<HeapEntry> mHeap;
+  std::vector<int> mHeapIndex;
+
+  // D* Lite, g is the cost to the goal
+  std::vector<float> mG;
+  std::vector<float> mRhs;
+  int mGoal;
+  int mStart;
+  int mLastStart;
+  float mKm;
+  int mLastExpansions;
+  std::vector<int> mPath;
+
+  // A*, the nodes of an older search are recognized by their stamp and considered unvisited
+  std::vector<float> mSearchG;
+  std::vector<int> mSearchParent;
+  std::vector<unsigned int> mSearchStamps;
+  unsigned int mSearchStamp;
+};
+
+#endif
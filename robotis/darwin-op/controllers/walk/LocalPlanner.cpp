@@ -0,0 +1,213 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LocalPlanner.hpp"
+#include "OccupancyGrid.hpp"
+#include "ScanProcessor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// the window is sampled on a grid of cXSamples x cASamples commands
+static const int cXSamples = 5;
+static const int cASamples = 11;
+static const int cSamples = cXSamples * cASamples;
+// the arcs are simulated in steps, their points are checked against the obstacles
+static const int cArcSteps = 10;
+// below this X amplitude, an arc turns in place
+static const float cMinXAmplitude = 1e-3f;
+// the robot faces the goal when the goal is closer to its heading than this, in radians
+static const float cFacingAngle = 0.3f;
+
+LocalPlanner::LocalPlanner(const OccupancyGrid *grid) : mGrid(grid), mXAmplitude(0.0f), mAAmplitude(0.0f) {
+  mParameters.maxSpeed = 0.15f;
+  mParameters.maxTurnRate = 0.8f;
+  mParameters.xAcceleration = 2.0f;
+  mParameters.aAcceleration = 4.0f;
+  mParameters.horizon = 2.0f;
+  mParameters.robotRadius = 0.15f;
+  mParameters.maxClearance = 0.6f;
+  mParameters.headingWeight = 1.0f;
+  mParameters.clearanceWeight = 0.3f;
+  mParameters.progressWeight = 1.0f;
+
+  mSampleX.resize(cSamples);
+  mSampleA.resize(cSamples);
+  mPoseX.resize(cSamples);
+  mPoseY.resize(cSamples);
+  mHeadingCos.resize(cSamples);
+  mHeadingSin.resize(cSamples);
+  mStepCos.resize(cSamples);
+  mStepSin.resize(cSamples);
+  mClearance.resize(cSamples);
+  mBlocked.resize(cSamples);
+  mScore.resize(cSamples);
+}
+
+LocalPlanner::~LocalPlanner() {
+}
+
+void LocalPlanner::reset() {
+  mXAmplitude = 0.0f;
+  mAAmplitude = 0.0f;
+}
+
+void LocalPlanner::collectObstacles(float x, float y, const ScanProcessor *scan) {
+  mObstacleX.clear();
+  mObstacleY.clear();
+  if (!scan)
+    return;
+  // allocated when the resolution of the Lidar grows only
+  mObstacleX.reserve(scan->count());
+  mObstacleY.reserve(scan->count());
+  const Parameters &p = mParameters;
+  const float reach = p.maxSpeed * p.horizon + p.maxClearance + p.robotRadius;
+  for (int i = 0; i < scan->count(); i++) {
+    const float dx = scan->pointX(i) - x;
+    const float dy = scan->pointY(i) - y;
+    if (scan->isValid(i) && dx * dx + dy * dy < reach * reach) {
+      mObstacleX.push_back(scan->pointX(i));
+      mObstacleY.push_back(scan->pointY(i));
+    }
+  }
+}
+
+bool LocalPlanner::plan(float x, float y, float yaw, float goalX, float goalY, const ScanProcessor *scan, float dt,
+                        float *xAmplitude, float *aAmplitude) {
+  const Parameters &p = mParameters;
+  collectObstacles(x, y, scan);
+  const int obstacles = mObstacleX.size();
+
+  // dynamic window around the last command
+  const float xMin = max(0.0f, mXAmplitude - p.xAcceleration * dt);
+  const float xMax = min(1.0f, mXAmplitude + p.xAcceleration * dt);
+  const float aMin = max(-1.0f, mAAmplitude - p.aAcceleration * dt);
+  const float aMax = min(1.0f, mAAmplitude + p.aAcceleration * dt);
+  const float h = p.horizon / cArcSteps;
+  for (int i = 0; i < cXSamples; i++) {
+    for (int j = 0; j < cASamples; j++) {
+      const int s = i * cASamples + j;
+      mSampleX[s] = xMin + (xMax - xMin) * i / (cXSamples - 1);
+      mSampleA[s] = aMin + (aMax - aMin) * j / (cASamples - 1);
+      // the heading of each step is taken in its middle, the first one is rotated by half a step
+      const float turn = p.maxTurnRate * mSampleA[s] * h;
+      mStepCos[s] = cos(turn);
+      mStepSin[s] = sin(turn);
+      mHeadingCos[s] = cos(yaw + 0.5f * turn);
+      mHeadingSin[s] = sin(yaw + 0.5f * turn);
+    }
+  }
+
+  // clearance of the current position, an obstacle already too close does not block the ways out
+  float initialClearance = p.maxClearance * p.maxClearance;
+  int closest = -1;
+  for (int k = 0; k < obstacles; k++) {
+    const float dx = mObstacleX[k] - x;
+    const float dy = mObstacleY[k] - y;
+    if (dx * dx + dy * dy < initialClearance) {
+      initialClearance = dx * dx + dy * dy;
+      closest = k;
+    }
+  }
+  initialClearance = sqrt(initialClearance);
+  const float minClearance = min(p.robotRadius, initialClearance);
+
+  float *poseX = &mPoseX[0];
+  float *poseY = &mPoseY[0];
+  float *headingCos = &mHeadingCos[0];
+  float *headingSin = &mHeadingSin[0];
+  const float *stepCos = &mStepCos[0];
+  const float *stepSin = &mStepSin[0];
+  const float *sampleX = &mSampleX[0];
+  float *clearance = &mClearance[0];
+  unsigned char *blocked = &mBlocked[0];
+  const float maxClearance2 = p.maxClearance * p.maxClearance;
+  for (int s = 0; s < cSamples; s++) {
+    poseX[s] = x;
+    poseY[s] = y;
+    clearance[s] = maxClearance2;
+    blocked[s] = 0;
+  }
+
+  for (int step = 0; step < cArcSteps; step++) {
+    for (int s = 0; s < cSamples; s++) {
+      const float distance = p.maxSpeed * sampleX[s] * h;
+      poseX[s] += distance * headingCos[s];
+      poseY[s] += distance * headingSin[s];
+      const float c = headingCos[s] * stepCos[s] - headingSin[s] * stepSin[s];
+      headingSin[s] = headingSin[s] * stepCos[s] + headingCos[s] * stepSin[s];
+      headingCos[s] = c;
+    }
+    for (int k = 0; k < obstacles; k++) {
+      const float ox = mObstacleX[k];
+      const float oy = mObstacleY[k];
+      for (int s = 0; s < cSamples; s++) {
+        const float dx = ox - poseX[s];
+        const float dy = oy - poseY[s];
+        clearance[s] = min(clearance[s], dx * dx + dy * dy);
+      }
+    }
+    if (mGrid) {
+      for (int s = 0; s < cSamples; s++)
+        blocked[s] |= mGrid->isOccupied(poseX[s], poseY[s]);
+    }
+  }
+
+  // score of the arcs, heading is the cosine of the angle between the last heading and the goal
+  const float d0 = sqrt((goalX - x) * (goalX - x) + (goalY - y) * (goalY - y));
+  const float progressScale = 1.0f / (p.maxSpeed * p.horizon);
+  float *score = &mScore[0];
+  for (int s = 0; s < cSamples; s++) {
+    const float gx = goalX - poseX[s];
+    const float gy = goalY - poseY[s];
+    const float d = sqrt(gx * gx + gy * gy);
+    const float heading = d > 1e-3f ? 0.5f * (1.0f + (headingCos[s] * gx + headingSin[s] * gy) / d) : 1.0f;
+    const float c = sqrt(clearance[s]);
+    clearance[s] = c;
+    score[s] = p.headingWeight * heading + p.clearanceWeight * c / p.maxClearance +
+               p.progressWeight * (d0 - d) * progressScale;
+  }
+  int best = -1;
+  for (int s = 0; s < cSamples; s++) {
+    if (!blocked[s] && clearance[s] >= minClearance && (best < 0 || score[s] > score[best]))
+      best = s;
+  }
+  // The arcs which do not walk keep the current clearance and are always safe. The best one does not
+  // lead anywhere if it does not turn the robot closer to the goal either: every arc which walks is
+  // rejected, the robot is stuck as if no arc was safe.
+  const float goalAngle = atan2(goalY - y, goalX - x);
+  if (best >= 0 && mSampleX[best] < cMinXAmplitude &&
+      headingCos[best] * cos(goalAngle) + headingSin[best] * sin(goalAngle) <= cos(goalAngle - yaw))
+    best = -1;
+
+  if (best < 0) {
+    // No safe arc, turns in place towards the goal, or away from the closest obstacle when it already
+    // faces the goal: the arcs which walk away from the obstacle are safe again in a few steps.
+    float angle = atan2(sin(goalAngle - yaw), cos(goalAngle - yaw));
+    if (fabs(angle) < cFacingAngle && closest >= 0) {
+      const float obstacleAngle = atan2(mObstacleY[closest] - y, mObstacleX[closest] - x) - yaw;
+      angle = sin(obstacleAngle) > 0.0f ? -1.0f : 1.0f;
+    }
+    mXAmplitude = 0.0f;
+    mAAmplitude = max(-1.0f, min(1.0f, angle));
+  } else {
+    mXAmplitude = mSampleX[best];
+    mAAmplitude = mSampleA[best];
+  }
+  *xAmplitude = mXAmplitude;
+  *aAmplitude = mAAmplitude;
+  return best >= 0;
+}
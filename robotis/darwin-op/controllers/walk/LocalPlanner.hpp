@@ -0,0 +1,88 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Dynamic window planner choosing the amplitudes of the gait
+//                which lead to a point without hitting the obstacles around
+
+#ifndef LOCAL_PLANNER_HPP
+#define LOCAL_PLANNER_HPP
+
+#include <vector>
+
+class OccupancyGrid;
+class ScanProcessor;
+
+// The commands are the X amplitude (forward, 0 to 1) and the A amplitude (turn, -1 to 1, to the left)
+// of the gait manager, the robot is modeled as walking at maxSpeed * X and turning at maxTurnRate * A.
+// Every step, the commands reachable from the last one within the accelerations (the dynamic window)
+// are sampled, the arcs they follow during the horizon are simulated and the arcs which come closer
+// than robotRadius to a point of the scan or which enter an occupied cell of the map are rejected.
+// The others are scored by the heading to the goal at the end of the arc, the clearance and the
+// progress towards the goal. The samples are stored by arrays of values, the loops over them have no
+// branch so that the compiler vectorizes them.
+class LocalPlanner {
+public:
+  struct Parameters {
+    float maxSpeed;          // m/s at X amplitude 1
+    float maxTurnRate;       // rad/s at A amplitude 1
+    float xAcceleration;     // X amplitude change per second
+    float aAcceleration;     // A amplitude change per second
+    float horizon;           // s
+    float robotRadius;       // m
+    float maxClearance;      // m, farther obstacles do not improve the score
+    float headingWeight;
+    float clearanceWeight;
+    float progressWeight;
+  };
+
+  explicit LocalPlanner(const OccupancyGrid *grid);
+  virtual ~LocalPlanner();
+
+  void setParameters(const Parameters &parameters) { mParameters = parameters; }
+  const Parameters &parameters() const { return mParameters; }
+  // the window starts again from a standing robot
+  void reset();
+
+  // Chooses the amplitudes for the next step of dt seconds from the pose of the robot, false if every
+  // sampled arc which walks hits an obstacle and turning in place does not face the goal better. Then
+  // the robot stops walking forward and turns towards the goal, or away from the closest obstacle.
+  bool plan(float x, float y, float yaw, float goalX, float goalY, const ScanProcessor *scan, float dt,
+            float *xAmplitude, float *aAmplitude);
+
+private:
+  void collectObstacles(float x, float y, const ScanProcessor *scan);
+
+  const OccupancyGrid *mGrid;
+  Parameters mParameters;
+  float mXAmplitude;
+  float mAAmplitude;
+
+  // samples of the window
+  std::vector<float> mSampleX;
+  std::vector<float> mSampleA;
+  std::vector<float> mPoseX;
+  std::vector<float> mPoseY;
+  std::vector<float> mHeadingCos;
+  std::vector<float> mHeadingSin;
+  std::vector<float> mStepCos;
+  std::vector<float> mStepSin;
+  std::vector<float> mClearance;
+  std::vector<unsigned char> mBlocked;
+  std::vector<float> mScore;
+  // points of the scan close enough to be reached during the horizon
+  std::vector<float> mObstacleX;
+  std::vector<float> mObstacleY;
+};
+
+#endif
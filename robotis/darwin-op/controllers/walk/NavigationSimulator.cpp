@@ -0,0 +1,388 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "NavigationSimulator.hpp"
+#include "Navigator.hpp"
+#include "RobotInterface.hpp"
+
+#include <minIni.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+static const float cPi = 3.14159265f;
+static const float cInfinity = numeric_limits<float>::infinity();
+// cells of the ground truth, finer than the map so that the map is not exact
+static const float cWorldResolution = 0.02f;
+// free space around the start and the goal
+static const float cStartClearance = 0.4f;
+// attempts to draw a start, a goal or a box before giving up
+static const int cMaxDraws = 1000;
+// Episodes which revealed a bug of the navigation with the default config, replayed by checkRegressions().
+// 2, 15, 20: the path passes a box closer than the radius of the local planner, which stood still by it.
+static const unsigned int cRegressionSeeds[] = {2, 15, 20};
+
+// ground truth of the obstacles, everything outside of the rectangle is a wall
+class SimulatedWorld {
+public:
+  SimulatedWorld(float minX, float minY, float maxX, float maxY) : mMinX(minX), mMinY(minY) {
+    mWidth = max(1, (int)ceil((maxX - minX) / cWorldResolution));
+    mHeight = max(1, (int)ceil((maxY - minY) / cWorldResolution));
+    mCells.assign(mWidth * mHeight, 0);
+  }
+
+  void addBox(const NavigationSimulator::Box &box) {
+    const int x0 = max(0, (int)floor((box.minX - mMinX) / cWorldResolution));
+    const int y0 = max(0, (int)floor((box.minY - mMinY) / cWorldResolution));
+    const int x1 = min(mWidth - 1, (int)floor((box.maxX - mMinX) / cWorldResolution));
+    const int y1 = min(mHeight - 1, (int)floor((box.maxY - mMinY) / cWorldResolution));
+    for (int y = y0; y <= y1; y++) {
+      for (int x = x0; x <= x1; x++)
+        mCells[y * mWidth + x] = 1;
+    }
+  }
+
+  bool isOccupied(int cx, int cy) const {
+    return cx < 0 || cy < 0 || cx >= mWidth || cy >= mHeight || mCells[cy * mWidth + cx];
+  }
+
+  // no obstacle closer than radius to the point
+  bool isFree(float x, float y, float radius) const {
+    const int cx = (int)floor((x - mMinX) / cWorldResolution);
+    const int cy = (int)floor((y - mMinY) / cWorldResolution);
+    const int r = (int)ceil(radius / cWorldResolution);
+    for (int dy = -r; dy <= r; dy++) {
+      for (int dx = -r; dx <= r; dx++) {
+        if (dx * dx + dy * dy <= r * r && isOccupied(cx + dx, cy + dy))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  // distance to the first occupied cell along the ray, infinity beyond maxRange
+  float castRay(float x, float y, float angle, float maxRange) const {
+    const float dx = cos(angle);
+    const float dy = sin(angle);
+    int cx = (int)floor((x - mMinX) / cWorldResolution);
+    int cy = (int)floor((y - mMinY) / cWorldResolution);
+    const int stepX = dx > 0.0f ? 1 : -1;
+    const int stepY = dy > 0.0f ? 1 : -1;
+    // distances along the ray to the next vertical and horizontal border of the cells (Amanatides and Woo)
+    const float deltaX = dx != 0.0f ? cWorldResolution / fabs(dx) : cInfinity;
+    const float deltaY = dy != 0.0f ? cWorldResolution / fabs(dy) : cInfinity;
+    float nextX = dx != 0.0f ? ((cx + (dx > 0.0f)) * cWorldResolution + mMinX - x) / dx : cInfinity;
+    float nextY = dy != 0.0f ? ((cy + (dy > 0.0f)) * cWorldResolution + mMinY - y) / dy : cInfinity;
+    float t = 0.0f;
+    while (t < maxRange) {
+      if (isOccupied(cx, cy))
+        return t;
+      if (nextX < nextY) {
+        t = nextX;
+        nextX += deltaX;
+        cx += stepX;
+      } else {
+        t = nextY;
+        nextY += deltaY;
+        cy += stepY;
+      }
+    }
+    return cInfinity;
+  }
+
+private:
+  float mMinX, mMinY;
+  int mWidth, mHeight;
+  vector<unsigned char> mCells;
+};
+
+// unicycle driven by the gait amplitudes, its sensors are read after each move
+class SimulatedRobot : public RobotInterface {
+public:
+  SimulatedRobot(const SimulatedWorld *world, const NavigationSimulator::Parameters &parameters, mt19937 *random,
+                 float speedScale, float turnScale, float timeConstant) :
+    mWorld(world),
+    mParameters(parameters),
+    mRandom(random),
+    mSpeedScale(speedScale),
+    mTurnScale(turnScale),
+    mTimeConstant(timeConstant),
+    mTime(0.0),
+    mX(0.0f),
+    mY(0.0f),
+    mYaw(0.0f),
+    mSpeed(0.0f),
+    mYawRate(0.0f),
+    mXAmplitude(0.0f),
+    mAAmplitude(0.0f),
+    mRanges(parameters.lidarBeams) {}
+
+  void setPose(float x, float y, float yaw) {
+    mX = x;
+    mY = y;
+    mYaw = yaw;
+  }
+  float x() const { return mX; }
+  float y() const { return mY; }
+
+  void move(float dt) {
+    const float lag = dt < mTimeConstant ? dt / mTimeConstant : 1.0f;
+    mSpeed += (mSpeedScale * mXAmplitude - mSpeed) * lag;
+    mYawRate += (mTurnScale * mAAmplitude - mYawRate) * lag;
+    mX += mSpeed * cos(mYaw) * dt;
+    mY += mSpeed * sin(mYaw) * dt;
+    mYaw = atan2(sin(mYaw + mYawRate * dt), cos(mYaw + mYawRate * dt));
+    mTime += dt;
+  }
+
+  void sense() {
+    normal_distribution<float> noise(0.0f, 1.0f);
+    const NavigationSimulator::Parameters &p = mParameters;
+    const int n = p.lidarBeams;
+    for (int i = 0; i < n; i++) {
+      const float angle = mYaw + 0.5f * p.lidarFieldOfView - (i + 0.5f) * p.lidarFieldOfView / n;
+      const float range = mWorld->castRay(mX, mY, angle, p.lidarMaxRange);
+      mRanges[i] = range < p.lidarMaxRange ? max(0.0f, range + p.rangeNoise * noise(*mRandom)) : cInfinity;
+    }
+    mGpsX = mX + p.gpsNoise * noise(*mRandom);
+    mGpsY = mY + p.gpsNoise * noise(*mRandom);
+    mImuYaw = mYaw + p.yawNoise * noise(*mRandom);
+    mGyro = mYawRate + p.gyroNoise * noise(*mRandom);
+  }
+
+  virtual double time() const { return mTime; }
+  virtual float timeStep() const { return mParameters.timeStep; }
+  virtual bool gpsPosition(float *x, float *y) const {
+    *x = mGpsX;
+    *y = mGpsY;
+    return true;
+  }
+  virtual bool imuYaw(float *yaw) const {
+    *yaw = mImuYaw;
+    return true;
+  }
+  virtual float gyroYawRate() const { return mGyro; }
+  virtual const float *lidarRanges() const { return &mRanges[0]; }
+  virtual int lidarResolution() const { return mParameters.lidarBeams; }
+  virtual float lidarFieldOfView() const { return mParameters.lidarFieldOfView; }
+  virtual float lidarMinRange() const { return 0.0f; }
+  virtual float lidarMaxRange() const { return mParameters.lidarMaxRange; }
+  virtual void setGaitAmplitudes(float xAmplitude, float aAmplitude) {
+    mXAmplitude = max(-1.0f, min(1.0f, xAmplitude));
+    mAAmplitude = max(-1.0f, min(1.0f, aAmplitude));
+  }
+  virtual void gaitAmplitudes(float *xAmplitude, float *yAmplitude, float *aAmplitude, bool *walking) const {
+    *xAmplitude = mXAmplitude;
+    *yAmplitude = 0.0f;
+    *aAmplitude = mAAmplitude;
+    *walking = true;
+  }
+
+private:
+  const SimulatedWorld *mWorld;
+  const NavigationSimulator::Parameters &mParameters;
+  mt19937 *mRandom;
+  float mSpeedScale, mTurnScale, mTimeConstant;
+  double mTime;
+  float mX, mY, mYaw;
+  float mSpeed, mYawRate;
+  float mXAmplitude, mAAmplitude;
+  vector<float> mRanges;
+  float mGpsX, mGpsY, mImuYaw, mGyro;
+};
+
+NavigationSimulator::NavigationSimulator(const string &configFile) : mConfigFile(configFile) {
+  minIni ini(configFile);
+  mMinX = ini.getf(EXHIBITION_SECTION, "map_min_x", -1.0f);
+  mMinY = ini.getf(EXHIBITION_SECTION, "map_min_y", -6.0f);
+  mMaxX = ini.getf(EXHIBITION_SECTION, "map_max_x", 9.0f);
+  mMaxY = ini.getf(EXHIBITION_SECTION, "map_max_y", 6.0f);
+  for (int i = 0;; i++) {
+    char key[32];
+    sprintf(key, "obstacle_%d", i);
+    Box box;
+    if (sscanf(ini.gets(EXHIBITION_SECTION, key).c_str(), "%f %f %f %f", &box.minX, &box.minY, &box.maxX,
+               &box.maxY) != 4)
+      break;
+    mWalls.push_back(box);
+  }
+  // the same model of the gait as the navigation
+  mSpeedScale = ini.getf("Local Planner", "max_speed", 0.15f);
+  mTurnScale = ini.getf("Local Planner", "max_turn_rate", 0.8f);
+  mTimeConstant = ini.getf("Pose Estimator", "time_constant", 0.3f);
+
+  mParameters.timeStep = 0.016f;
+  mParameters.timeout = 180.0f;
+  mParameters.obstacles = 5;
+  mParameters.minBoxSize = 0.2f;
+  mParameters.maxBoxSize = 0.6f;
+  mParameters.minDistance = 2.0f;
+  mParameters.goalTolerance = 0.2f;
+  mParameters.bodyRadius = 0.1f;
+  mParameters.speedError = 0.2f;
+  // Sick LMS 291 of the robot
+  mParameters.lidarBeams = 180;
+  mParameters.lidarFieldOfView = cPi;
+  mParameters.lidarMaxRange = 8.0f;
+  mParameters.rangeNoise = 0.01f;
+  mParameters.gpsNoise = 0.02f;
+  mParameters.yawNoise = 0.01f;
+  mParameters.gyroNoise = 0.05f;
+}
+
+NavigationSimulator::~NavigationSimulator() {
+}
+
+NavigationSimulator::Outcome NavigationSimulator::runEpisode(unsigned int seed, double *time) const {
+  const Parameters &p = mParameters;
+  mt19937 random(seed);
+  uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  *time = 0.0;
+
+  SimulatedWorld world(mMinX, mMinY, mMaxX, mMaxY);
+  for (size_t i = 0; i < mWalls.size(); i++)
+    world.addBox(mWalls[i]);
+
+  // start and goal in the free space of the known walls
+  float startX = 0.0f, startY = 0.0f, goalX = 0.0f, goalY = 0.0f;
+  for (int draw = 0; draw < cMaxDraws; draw++) {
+    startX = mMinX + (mMaxX - mMinX) * uniform(random);
+    startY = mMinY + (mMaxY - mMinY) * uniform(random);
+    goalX = mMinX + (mMaxX - mMinX) * uniform(random);
+    goalY = mMinY + (mMaxY - mMinY) * uniform(random);
+    if (hypot(goalX - startX, goalY - startY) >= p.minDistance && world.isFree(startX, startY, cStartClearance) &&
+        world.isFree(goalX, goalY, cStartClearance))
+      break;
+  }
+
+  // boxes unknown to the map, away from the start and the goal
+  for (int i = 0; i < p.obstacles; i++) {
+    for (int draw = 0; draw < cMaxDraws; draw++) {
+      const float width = p.minBoxSize + (p.maxBoxSize - p.minBoxSize) * uniform(random);
+      const float height = p.minBoxSize + (p.maxBoxSize - p.minBoxSize) * uniform(random);
+      Box box;
+      box.minX = mMinX + (mMaxX - mMinX - width) * uniform(random);
+      box.minY = mMinY + (mMaxY - mMinY - height) * uniform(random);
+      box.maxX = box.minX + width;
+      box.maxY = box.minY + height;
+      const float startDistance = hypot(max(0.0f, max(box.minX - startX, startX - box.maxX)),
+                                        max(0.0f, max(box.minY - startY, startY - box.maxY)));
+      const float goalDistance = hypot(max(0.0f, max(box.minX - goalX, goalX - box.maxX)),
+                                       max(0.0f, max(box.minY - goalY, goalY - box.maxY)));
+      if (startDistance > cStartClearance && goalDistance > cStartClearance) {
+        world.addBox(box);
+        break;
+      }
+    }
+  }
+
+  // the gait of each episode is slower or faster than its model
+  const float speedFactor = 1.0f + p.speedError * (2.0f * uniform(random) - 1.0f);
+  const float turnFactor = 1.0f + p.speedError * (2.0f * uniform(random) - 1.0f);
+  SimulatedRobot robot(&world, p, &random, mSpeedScale * speedFactor, mTurnScale * turnFactor, mTimeConstant);
+  const float startYaw = cPi * (2.0f * uniform(random) - 1.0f);
+  robot.setPose(startX, startY, startYaw);
+  Navigator navigator(&robot, mConfigFile.c_str());
+  navigator.setInitialPose(startX, startY, startYaw);
+
+  // the first step starts from a standing robot
+  robot.move(p.timeStep);
+  robot.sense();
+  while (robot.time() < p.timeout) {
+    navigator.updatePose();
+    navigator.updateScan();
+    navigator.updateMap();
+    if (!navigator.goAlongPath(goalX, goalY))
+      robot.setGaitAmplitudes(0.0f, 0.0f);
+    robot.move(p.timeStep);
+    robot.sense();
+    *time = robot.time();
+    if (!world.isFree(robot.x(), robot.y(), p.bodyRadius))
+      return COLLISION;
+    if (hypot(goalX - robot.x(), goalY - robot.y()) < p.goalTolerance)
+      return SUCCESS;
+  }
+  return TIMEOUT;
+}
+
+void NavigationSimulator::runEpisodes(const vector<unsigned int> &seeds, int threads, vector<Outcome> *outcomes,
+                                      vector<double> *times) const {
+  outcomes->assign(seeds.size(), TIMEOUT);
+  times->assign(seeds.size(), 0.0);
+  // the threads take the next episode until there is none left
+  const int episodes = seeds.size();
+  atomic<int> next(0);
+  vector<thread> workers;
+  for (int i = 0; i < max(1, threads); i++) {
+    workers.push_back(thread([&]() {
+      for (int episode = next++; episode < episodes; episode = next++)
+        (*outcomes)[episode] = runEpisode(seeds[episode], &(*times)[episode]);
+    }));
+  }
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+SimulationStatistics NavigationSimulator::run(int episodes, int threads, unsigned int seed) const {
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<unsigned int> seeds(max(0, episodes));
+  for (size_t i = 0; i < seeds.size(); i++)
+    seeds[i] = seed + i;
+  vector<Outcome> outcomes;
+  vector<double> times;
+  runEpisodes(seeds, threads, &outcomes, &times);
+
+  SimulationStatistics statistics;
+  statistics.episodes = outcomes.size();
+  statistics.successes = 0;
+  statistics.collisions = 0;
+  statistics.timeouts = 0;
+  statistics.meanTimeToGoal = 0.0;
+  statistics.simulatedTime = 0.0;
+  for (size_t i = 0; i < outcomes.size(); i++) {
+    statistics.simulatedTime += times[i];
+    if (outcomes[i] == SUCCESS) {
+      statistics.successes++;
+      statistics.meanTimeToGoal += times[i];
+    } else if (outcomes[i] == COLLISION)
+      statistics.collisions++;
+    else
+      statistics.timeouts++;
+  }
+  if (statistics.successes > 0)
+    statistics.meanTimeToGoal /= statistics.successes;
+  statistics.wallTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return statistics;
+}
+
+vector<unsigned int> NavigationSimulator::checkRegressions(int threads) const {
+  const vector<unsigned int> seeds(cRegressionSeeds,
+                                   cRegressionSeeds + sizeof(cRegressionSeeds) / sizeof(cRegressionSeeds[0]));
+  vector<Outcome> outcomes;
+  vector<double> times;
+  runEpisodes(seeds, threads, &outcomes, &times);
+  vector<unsigned int> failures;
+  for (size_t i = 0; i < seeds.size(); i++) {
+    if (outcomes[i] != SUCCESS)
+      failures.push_back(seeds[i]);
+  }
+  return failures;
+}
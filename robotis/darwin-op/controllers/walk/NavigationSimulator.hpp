@@ -0,0 +1,94 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Headless 2D simulation of the robot in the exhibition, to
+//                evaluate the navigation on many random episodes without Webots
+
+#ifndef NAVIGATION_SIMULATOR_HPP
+#define NAVIGATION_SIMULATOR_HPP
+
+#include <string>
+#include <vector>
+
+struct SimulationStatistics {
+  int episodes;
+  int successes;
+  int collisions;
+  int timeouts;
+  // simulated seconds to reach the goal, over the successful episodes
+  double meanTimeToGoal;
+  double simulatedTime;
+  double wallTime;
+};
+
+// The walls of the [Exhibition] section of the config file and the border of the map are the world known
+// in advance. Each episode adds random boxes unknown to the map, and draws a start and a goal in the free
+// space far enough from each other. The robot is a unicycle: its speeds follow the gait amplitudes scaled
+// like in the local planner (with a random error of each episode) and a first order lag. The GPS, the IMU,
+// the gyro and the Lidar (ray casting on a fine grid) are noisy. A Navigator drives the robot until it
+// reaches the goal, its body touches an obstacle or the timeout expires. The episodes run in parallel,
+// each one from its own seed, so the results do not depend on the number of threads.
+class NavigationSimulator {
+public:
+  struct Parameters {
+    float timeStep;       // s
+    float timeout;        // s
+    int obstacles;        // random boxes per episode
+    float minBoxSize;     // m
+    float maxBoxSize;     // m
+    float minDistance;    // m between the start and the goal
+    float goalTolerance;  // m
+    float bodyRadius;     // m, a collision is counted when an obstacle is closer
+    float speedError;     // relative, the real speeds differ from the model by up to this
+    int lidarBeams;
+    float lidarFieldOfView;
+    float lidarMaxRange;
+    float rangeNoise;  // m
+    float gpsNoise;    // m
+    float yawNoise;    // rad
+    float gyroNoise;   // rad/s
+  };
+
+  struct Box {
+    float minX, minY, maxX, maxY;
+  };
+
+  explicit NavigationSimulator(const std::string &configFile);
+  virtual ~NavigationSimulator();
+
+  void setParameters(const Parameters &parameters) { mParameters = parameters; }
+  const Parameters &parameters() const { return mParameters; }
+
+  // runs the episodes seed, seed + 1, ... on the given number of threads (at least one)
+  SimulationStatistics run(int episodes, int threads, unsigned int seed) const;
+  // replays the episodes which revealed bugs with the default config, returns the seeds of those which fail
+  std::vector<unsigned int> checkRegressions(int threads) const;
+
+private:
+  enum Outcome { SUCCESS, COLLISION, TIMEOUT };
+  Outcome runEpisode(unsigned int seed, double *time) const;
+  void runEpisodes(const std::vector<unsigned int> &seeds, int threads, std::vector<Outcome> *outcomes,
+                   std::vector<double> *times) const;
+
+  std::string mConfigFile;
+  Parameters mParameters;
+  float mMinX, mMinY, mMaxX, mMaxY;
+  // commanded speeds at amplitude 1, from the local planner
+  float mSpeedScale;
+  float mTurnScale;
+  float mTimeConstant;
+  std::vector<Box> mWalls;
+};
+
+#endif
@@ -0,0 +1,213 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Navigator.hpp"
+#include "RobotInterface.hpp"
+
+#include <minIni.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+#define LOCAL_PLANNER_SECTION "Local Planner"
+#define POSE_ESTIMATOR_SECTION "Pose Estimator"
+#define LOCALIZATION_SECTION "Localization"
+
+// default area of the exhibition covered by the occupancy grid, in meters
+#define MAP_MIN_X -1.0f
+#define MAP_MIN_Y -6.0f
+#define MAP_MAX_X 9.0f
+#define MAP_MAX_Y 6.0f
+#define MAP_RESOLUTION 0.05f
+// the far beams are too sparse to clear the map reliably, they are cut at this range
+#define MAP_MAX_RANGE 4.0f
+// Without GPS, the scans are matched and integrated up to the range of the Sick LMS 291: within 4 m,
+// the open areas of the exhibition have too few walls to keep the matched pose from drifting.
+#define SCAN_MATCH_MAX_RANGE 8.0f
+// half width of the robot with a margin, an occupied cell closer to the path blocks it
+#define MAP_CLEARANCE 0.2f
+// a replanning resumes at the next step rather than delaying the gait, about 2 ms
+#define PLANNER_MAX_EXPANSIONS 4000
+// the local planner walks to the farthest point of the path closer than this
+#define PLANNER_LOOKAHEAD 0.5f
+// distance to the target under which the robot stops walking
+#define TARGET_TOLERANCE 0.1f
+// standard deviations of the poses found by the scan matcher, about the size of a cell and of a yaw step
+#define SCAN_MATCH_POSITION_NOISE 0.05f
+#define SCAN_MATCH_YAW_NOISE 0.02f
+
+Navigator::Navigator(RobotInterface *robot, const char *configFile) : mRobot(robot), mPoseTime(0.0) {
+  minIni ini(configFile);
+  mScan = new ScanProcessor();
+  mMap = new OccupancyGrid(ini.getf(EXHIBITION_SECTION, "map_min_x", MAP_MIN_X),
+                           ini.getf(EXHIBITION_SECTION, "map_min_y", MAP_MIN_Y),
+                           ini.getf(EXHIBITION_SECTION, "map_max_x", MAP_MAX_X),
+                           ini.getf(EXHIBITION_SECTION, "map_max_y", MAP_MAX_Y),
+                           ini.getf(EXHIBITION_SECTION, "map_resolution", MAP_RESOLUTION));
+  // walls known in advance, obstacle_<i> = min_x min_y max_x max_y
+  for (int i = 0;; i++) {
+    char key[32];
+    sprintf(key, "obstacle_%d", i);
+    const string value = ini.gets(EXHIBITION_SECTION, key);
+    float minX, minY, maxX, maxY;
+    if (sscanf(value.c_str(), "%f %f %f %f", &minX, &minY, &maxX, &maxY) != 4)
+      break;
+    mMap->addStaticObstacle(minX, minY, maxX, maxY);
+  }
+  mPlanner = new GridPlanner(mMap, MAP_CLEARANCE);
+
+  mLocalPlanner = new LocalPlanner(mMap);
+  LocalPlanner::Parameters parameters = mLocalPlanner->parameters();
+  parameters.maxSpeed = ini.getf(LOCAL_PLANNER_SECTION, "max_speed", parameters.maxSpeed);
+  parameters.maxTurnRate = ini.getf(LOCAL_PLANNER_SECTION, "max_turn_rate", parameters.maxTurnRate);
+  parameters.xAcceleration = ini.getf(LOCAL_PLANNER_SECTION, "x_acceleration", parameters.xAcceleration);
+  parameters.aAcceleration = ini.getf(LOCAL_PLANNER_SECTION, "a_acceleration", parameters.aAcceleration);
+  parameters.horizon = ini.getf(LOCAL_PLANNER_SECTION, "horizon", parameters.horizon);
+  parameters.robotRadius = ini.getf(LOCAL_PLANNER_SECTION, "robot_radius", parameters.robotRadius);
+  parameters.maxClearance = ini.getf(LOCAL_PLANNER_SECTION, "max_clearance", parameters.maxClearance);
+  parameters.headingWeight = ini.getf(LOCAL_PLANNER_SECTION, "heading_weight", parameters.headingWeight);
+  parameters.clearanceWeight = ini.getf(LOCAL_PLANNER_SECTION, "clearance_weight", parameters.clearanceWeight);
+  parameters.progressWeight = ini.getf(LOCAL_PLANNER_SECTION, "progress_weight", parameters.progressWeight);
+  mLocalPlanner->setParameters(parameters);
+
+  mPose = new PoseEstimator();
+  PoseEstimator::Parameters poseParameters = mPose->parameters();
+  // the commands are modeled like in the local planner
+  poseParameters.speedScale = parameters.maxSpeed;
+  poseParameters.turnScale = parameters.maxTurnRate;
+  poseParameters.lateralScale = ini.getf(POSE_ESTIMATOR_SECTION, "lateral_speed", poseParameters.lateralScale);
+  poseParameters.timeConstant = ini.getf(POSE_ESTIMATOR_SECTION, "time_constant", poseParameters.timeConstant);
+  poseParameters.accelerationNoise =
+    ini.getf(POSE_ESTIMATOR_SECTION, "acceleration_noise", poseParameters.accelerationNoise);
+  poseParameters.angularNoise = ini.getf(POSE_ESTIMATOR_SECTION, "angular_noise", poseParameters.angularNoise);
+  poseParameters.positionNoise = ini.getf(POSE_ESTIMATOR_SECTION, "position_noise", poseParameters.positionNoise);
+  poseParameters.gpsNoise = ini.getf(POSE_ESTIMATOR_SECTION, "gps_noise", poseParameters.gpsNoise);
+  poseParameters.yawNoise = ini.getf(POSE_ESTIMATOR_SECTION, "yaw_noise", poseParameters.yawNoise);
+  poseParameters.gyroNoise = ini.getf(POSE_ESTIMATOR_SECTION, "gyro_noise", poseParameters.gyroNoise);
+  poseParameters.gate = ini.getf(POSE_ESTIMATOR_SECTION, "gate", poseParameters.gate);
+  mPose->setParameters(poseParameters);
+
+  // the GPS of the simulation, or the scan matcher starting from a known pose
+  mUseGps = ini.geti(LOCALIZATION_SECTION, "use_gps", 1) != 0;
+  mInitialX = 0.0f;
+  mInitialY = 0.0f;
+  mInitialYaw = 0.0f;
+  sscanf(ini.gets(LOCALIZATION_SECTION, "initial_pose").c_str(), "%f %f %f", &mInitialX, &mInitialY, &mInitialYaw);
+  mMatcher = new ScanMatcher(mMap);
+  ScanMatcher::Parameters matcherParameters = mMatcher->parameters();
+  matcherParameters.linearWindow = ini.getf(LOCALIZATION_SECTION, "linear_window", matcherParameters.linearWindow);
+  matcherParameters.angularWindow = ini.getf(LOCALIZATION_SECTION, "angular_window", matcherParameters.angularWindow);
+  mMapMaxRange = mUseGps ? MAP_MAX_RANGE : SCAN_MATCH_MAX_RANGE;
+  matcherParameters.maxRange = mMapMaxRange;
+  matcherParameters.minScore = ini.getf(LOCALIZATION_SECTION, "min_score", matcherParameters.minScore);
+  mMatcher->setParameters(matcherParameters);
+}
+
+Navigator::~Navigator() {
+  delete mMatcher;
+  delete mPose;
+  delete mLocalPlanner;
+  delete mPlanner;
+  delete mMap;
+  delete mScan;
+}
+
+float Navigator::clearance() const {
+  return MAP_CLEARANCE;
+}
+
+void Navigator::updatePose() {
+  const double time = mRobot->time();
+  if (time == mPoseTime)
+    return;
+  float yaw;
+  const bool hasYaw = mRobot->imuYaw(&yaw);
+  // the gait applied the amplitudes which were set before the last step
+  float xAmplitude, yAmplitude, aAmplitude;
+  bool walking;
+  mRobot->gaitAmplitudes(&xAmplitude, &yAmplitude, &aAmplitude, &walking);
+  mPose->predict(time - mPoseTime, xAmplitude, yAmplitude, aAmplitude, walking);
+  if (mUseGps) {
+    float gpsX, gpsY;
+    if (mRobot->gpsPosition(&gpsX, &gpsY) && hasYaw) {
+      if (!mPose->isInitialized())
+        mPose->reset(gpsX, gpsY, yaw);
+      mPose->correctPosition(gpsX, gpsY);
+    }
+  } else {
+    if (!mPose->isInitialized())
+      mPose->reset(mInitialX, mInitialY, hasYaw ? yaw : mInitialYaw);
+    // the matcher searches around the prediction, in the map built with the previous poses
+    float matchedX = mPose->x(), matchedY = mPose->y(), matchedYaw = mPose->yaw();
+    if (mMatcher->match(mRobot->lidarRanges(), mRobot->lidarResolution(), mRobot->lidarFieldOfView(), &matchedX,
+                        &matchedY, &matchedYaw)) {
+      mPose->correctPosition(matchedX, matchedY, SCAN_MATCH_POSITION_NOISE);
+      mPose->correctYaw(matchedYaw, SCAN_MATCH_YAW_NOISE);
+    }
+  }
+  if (hasYaw)
+    mPose->correctYaw(yaw);
+  mPose->correctYawRate(mRobot->gyroYawRate());
+  mPoseTime = time;
+}
+
+void Navigator::updateScan() {
+  mScan->process(mRobot->lidarRanges(), mRobot->lidarResolution(), mRobot->lidarFieldOfView(),
+                 mRobot->lidarMinRange(), mRobot->lidarMaxRange(), x(), y(), yaw());
+}
+
+void Navigator::updateMap() {
+  if (mScan->count() == 0)
+    return;
+  const float maxRange = min(mScan->maxRange(), mMapMaxRange);
+  mMap->update(x(), y(), yaw(), mScan->ranges(), mScan->count(), mRobot->lidarFieldOfView(), maxRange);
+}
+
+void Navigator::resetMotion() {
+  mLocalPlanner->reset();
+}
+
+// walks to the point along the arc chosen by the local planner in the current scan and map
+void Navigator::goToPoint(float targetX, float targetY) {
+  if (hypot(targetX - x(), targetY - y()) <= TARGET_TOLERANCE) {
+    mRobot->setGaitAmplitudes(0.0f, 0.0f);
+    mLocalPlanner->reset();
+    return;
+  }
+  float xAmplitude, aAmplitude;
+  mLocalPlanner->plan(x(), y(), yaw(), targetX, targetY, mScan, mRobot->timeStep(), &xAmplitude, &aAmplitude);
+  mRobot->setGaitAmplitudes(xAmplitude, aAmplitude);
+}
+
+bool Navigator::goAlongPath(float targetX, float targetY) {
+  int startX, startY, goalX, goalY;
+  if (!mMap->worldToCell(x(), y(), &startX, &startY) || !mMap->worldToCell(targetX, targetY, &goalX, &goalY))
+    return false;
+  if (!mPlanner->hasGoal() || !mPlanner->isGoal(goalX, goalY))
+    mPlanner->setGoal(goalX, goalY);
+  mPlanner->setStart(startX, startY);
+  mPlanner->applyMapChanges();
+
+  float waypointX, waypointY;
+  if (mPlanner->computePath(PLANNER_MAX_EXPANSIONS) &&
+      mPlanner->nextWaypoint(PLANNER_LOOKAHEAD, &waypointX, &waypointY) &&
+      hypot(targetX - x(), targetY - y()) >= PLANNER_LOOKAHEAD)
+    goToPoint(waypointX, waypointY);
+  else
+    goToPoint(targetX, targetY);  // close to the target, still searching, or no path in the map
+  return true;
+}
@@ -0,0 +1,88 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Localization, mapping and motion planning of the robot
+//                through the sensors and actuators of a RobotInterface
+
+#ifndef NAVIGATOR_HPP
+#define NAVIGATOR_HPP
+
+#include "GridPlanner.hpp"
+#include "LocalPlanner.hpp"
+#include "OccupancyGrid.hpp"
+#include "PoseEstimator.hpp"
+#include "ScanMatcher.hpp"
+#include "ScanProcessor.hpp"
+
+class RobotInterface;
+
+// layout of the exhibition in the config file
+#define EXHIBITION_SECTION "Exhibition"
+
+// The parameters are read from the config file. Each step, updatePose(), updateScan() and updateMap() are
+// called in this order after the sensors are updated, then goAlongPath() chooses the gait amplitudes.
+class Navigator {
+public:
+  Navigator(RobotInterface *robot, const char *configFile);
+  virtual ~Navigator();
+
+  // filters the pose once per time step, the other calls of the same step do nothing
+  void updatePose();
+  // filters the range image and converts it to points at the last pose
+  void updateScan();
+  // integrates the last scan at the last pose
+  void updateMap();
+  // Walks towards the target along the shortest path in the map, which is repaired incrementally as the
+  // map changes. False if the robot or the target is out of the map, then nothing is commanded.
+  bool goAlongPath(float targetX, float targetY);
+  // the next walk starts from a standing robot
+  void resetMotion();
+  // pose from which the scan matcher starts without GPS, instead of the one of the config file
+  void setInitialPose(float x, float y, float yaw) {
+    mInitialX = x;
+    mInitialY = y;
+    mInitialYaw = yaw;
+  }
+
+  float x() const { return mPose->x(); }
+  float y() const { return mPose->y(); }
+  float yaw() const { return mPose->yaw(); }
+  bool usesGps() const { return mUseGps; }
+  // distance to the obstacles kept by the paths
+  float clearance() const;
+
+  OccupancyGrid *map() const { return mMap; }
+  GridPlanner *planner() const { return mPlanner; }
+  const ScanProcessor *scan() const { return mScan; }
+  const PoseEstimator *pose() const { return mPose; }
+
+private:
+  void goToPoint(float targetX, float targetY);
+
+  RobotInterface *mRobot;
+  OccupancyGrid *mMap;
+  GridPlanner *mPlanner;
+  LocalPlanner *mLocalPlanner;
+  ScanProcessor *mScan;
+  PoseEstimator *mPose;
+  double mPoseTime;
+  // without GPS, the position is corrected by matching the range images against the map
+  bool mUseGps;
+  ScanMatcher *mMatcher;
+  float mInitialX, mInitialY, mInitialYaw;
+  // range up to which the scans are integrated in the map and matched against it
+  float mMapMaxRange;
+};
+
+#endif
@@ -0,0 +1,230 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "OccupancyGrid.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+// added before converting to int so that the conversion rounds down the negative coordinates as well
+static const float cFloorBias = 4096.0f;
+
+OccupancyGrid::OccupancyGrid(float minX, float minY, float maxX, float maxY, float resolution) :
+  mMinX(minX),
+  mMinY(minY),
+  mResolution(resolution),
+  mRevision(0),
+  mBeamCount(0),
+  mFieldOfView(0.0f) {
+  mWidth = (int)ceil((maxX - minX) / resolution);
+  mHeight = (int)ceil((maxY - minY) / resolution);
+  if (mWidth < 1)
+    mWidth = 1;
+  if (mHeight < 1)
+    mHeight = 1;
+  mTilesX = (mWidth + TILE_MASK) >> TILE_SHIFT;
+  mTilesY = (mHeight + TILE_MASK) >> TILE_SHIFT;
+  mCells.assign(mTilesX * mTilesY * TILE_SIZE * TILE_SIZE, 0);
+  mStatic.assign(mCells.size(), 0);
+  mChanges.reserve(MAX_CHANGES);
+  mChangesOverflowed = false;
+}
+
+OccupancyGrid::~OccupancyGrid() {
+}
+
+void OccupancyGrid::clear() {
+  for (size_t i = 0; i < mCells.size(); i++)
+    mCells[i] = mStatic[i] ? LOG_ODDS_LIMIT : 0;
+  mChanges.clear();
+  mChangesOverflowed = true;
+  mRevision++;
+}
+
+void OccupancyGrid::addStaticObstacle(float minX, float minY, float maxX, float maxY) {
+  int x0, y0, x1, y1;
+  worldToCell(minX, minY, &x0, &y0);
+  worldToCell(maxX, maxY, &x1, &y1);
+  x0 = x0 < 0 ? 0 : x0;
+  y0 = y0 < 0 ? 0 : y0;
+  x1 = x1 >= mWidth ? mWidth - 1 : x1;
+  y1 = y1 >= mHeight ? mHeight - 1 : y1;
+  for (int cy = y0; cy <= y1; cy++) {
+    for (int cx = x0; cx <= x1; cx++) {
+      const int i = index(cx, cy);
+      if (mCells[i] < LOG_ODDS_OCCUPIED)
+        recordChange(cx, cy);
+      mCells[i] = LOG_ODDS_LIMIT;
+      mStatic[i] = 1;
+    }
+  }
+}
+
+void OccupancyGrid::clearChanges() {
+  mChanges.clear();
+  mChangesOverflowed = false;
+}
+
+void OccupancyGrid::recordChange(int cx, int cy) {
+  mRevision++;
+  if (mChangesOverflowed)
+    return;
+  if (mChanges.size() >= MAX_CHANGES) {
+    mChanges.clear();
+    mChangesOverflowed = true;
+    return;
+  }
+  mChanges.push_back(cy * mWidth + cx);
+}
+
+bool OccupancyGrid::worldToCell(float x, float y, int *cx, int *cy) const {
+  *cx = (int)floor((x - mMinX) / mResolution);
+  *cy = (int)floor((y - mMinY) / mResolution);
+  return isInside(*cx, *cy);
+}
+
+void OccupancyGrid::cellToWorld(int cx, int cy, float *x, float *y) const {
+  *x = mMinX + (cx + 0.5f) * mResolution;
+  *y = mMinY + (cy + 0.5f) * mResolution;
+}
+
+int OccupancyGrid::logOdds(int cx, int cy) const {
+  return isInside(cx, cy) ? mCells[index(cx, cy)] : 0;
+}
+
+float OccupancyGrid::probability(float x, float y) const {
+  int cx, cy;
+  if (!worldToCell(x, y, &cx, &cy))
+    return 0.5f;
+  return 1.0f - 1.0f / (1.0f + exp((float)mCells[index(cx, cy)] / LOG_ODDS_SCALE));
+}
+
+bool OccupancyGrid::isOccupied(float x, float y) const {
+  int cx, cy;
+  return worldToCell(x, y, &cx, &cy) && isOccupied(cx, cy);
+}
+
+bool OccupancyGrid::isSegmentFree(float x0, float y0, float x1, float y1, float clearance) const {
+  // sample the segment every half cell and check the square of cells around each sample
+  const float length = sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+  const int samples = (int)(2.0f * length / mResolution) + 1;
+  const int margin = (int)ceil(clearance / mResolution);
+  for (int i = 0; i <= samples; i++) {
+    const float t = (float)i / samples;
+    int cx, cy;
+    worldToCell(x0 + t * (x1 - x0), y0 + t * (y1 - y0), &cx, &cy);
+    for (int dy = -margin; dy <= margin; dy++) {
+      for (int dx = -margin; dx <= margin; dx++) {
+        if (isOccupied(cx + dx, cy + dy))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+void OccupancyGrid::add(int cx, int cy, int value) {
+  const int i = index(cx, cy);
+  if (mStatic[i])
+    return;
+  signed char &cell = mCells[i];
+  const int updated = cell + value;
+  const bool wasOccupied = cell >= LOG_ODDS_OCCUPIED;
+  cell = updated > LOG_ODDS_LIMIT ? LOG_ODDS_LIMIT : updated < -LOG_ODDS_LIMIT ? -LOG_ODDS_LIMIT : updated;
+  if (wasOccupied != (cell >= LOG_ODDS_OCCUPIED))
+    recordChange(cx, cy);
+}
+
+void OccupancyGrid::updateBeamTable(int count, float fieldOfView) {
+  if (count == mBeamCount && fieldOfView == mFieldOfView)
+    return;
+  mBeamCount = count;
+  mFieldOfView = fieldOfView;
+  mBeamCos.resize(count);
+  mBeamSin.resize(count);
+  mEndX.resize(count);
+  mEndY.resize(count);
+  mHit.resize(count);
+  // the beams are at the center of the columns of the range image, from left to right
+  for (int i = 0; i < count; i++) {
+    const float angle = 0.5f * fieldOfView - (i + 0.5f) * fieldOfView / count;
+    mBeamCos[i] = cos(angle);
+    mBeamSin[i] = sin(angle);
+  }
+}
+
+void OccupancyGrid::update(float x, float y, float yaw, const float *ranges, int count, float fieldOfView,
+                           float maxRange) {
+  if (!ranges || count <= 0)
+    return;
+  int x0, y0;
+  if (!worldToCell(x, y, &x0, &y0))
+    return;
+  updateBeamTable(count, fieldOfView);
+
+  // end of every beam in cells, this loop has no branch so that the compiler vectorizes it
+  // (the invalid and infinite ranges fail the comparison and become misses at maxRange)
+  const float c = cos(yaw);
+  const float s = sin(yaw);
+  const float ox = (x - mMinX) / mResolution;
+  const float oy = (y - mMinY) / mResolution;
+  const float scale = 1.0f / mResolution;
+  const float *beamCos = &mBeamCos[0];
+  const float *beamSin = &mBeamSin[0];
+  int *endX = &mEndX[0];
+  int *endY = &mEndY[0];
+  unsigned char *hit = &mHit[0];
+  for (int i = 0; i < count; i++) {
+    const float range = ranges[i];
+    const bool isHit = range < maxRange;
+    const float r = (isHit ? range : maxRange) * scale;
+    // rotation of the beam direction by the yaw of the robot
+    const float dx = c * beamCos[i] - s * beamSin[i];
+    const float dy = s * beamCos[i] + c * beamSin[i];
+    // floor() without a library call, the ends stay above -cFloorBias cells
+    endX[i] = (int)(ox + r * dx + cFloorBias) - (int)cFloorBias;
+    endY[i] = (int)(oy + r * dy + cFloorBias) - (int)cFloorBias;
+    hit[i] = isHit;
+  }
+
+  for (int i = 0; i < count; i++)
+    traceRay(x0, y0, endX[i], endY[i], hit[i]);
+}
+
+void OccupancyGrid::traceRay(int x0, int y0, int x1, int y1, bool hit) {
+  // Bresenham, the cells crossed by the beam are free, the last one is occupied if the beam hit something
+  const int dx = abs(x1 - x0);
+  const int dy = -abs(y1 - y0);
+  const int sx = x0 < x1 ? 1 : -1;
+  const int sy = y0 < y1 ? 1 : -1;
+  int error = dx + dy;
+  while (x0 != x1 || y0 != y1) {
+    if (!isInside(x0, y0))
+      return;  // the rest of the beam is outside of the grid as well
+    add(x0, y0, LOG_ODDS_MISS);
+    const int e2 = 2 * error;
+    if (e2 >= dy) {
+      error += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      error += dx;
+      y0 += sy;
+    }
+  }
+  if (isInside(x1, y1))
+    add(x1, y1, hit ? LOG_ODDS_HIT : LOG_ODDS_MISS);
+}
@@ -0,0 +1,104 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Log-odds occupancy grid built incrementally from the Lidar
+//                range images and the pose of the robot
+
+#ifndef OCCUPANCY_GRID_HPP
+#define OCCUPANCY_GRID_HPP
+
+#include <vector>
+
+// The grid covers a fixed rectangle of the world, its memory is allocated once. The cells are
+// stored in square tiles so that the cells close to each other in both directions, which are
+// updated and read together by the rays and by the planners, are close in memory.
+// The log-odds are fixed point numbers (LOG_ODDS_SCALE per unit) clamped to +/-LOG_ODDS_LIMIT
+// so that the map still follows the people walking in the exhibition.
+class OccupancyGrid {
+public:
+  enum { TILE_SHIFT = 4, TILE_SIZE = 1 << TILE_SHIFT, TILE_MASK = TILE_SIZE - 1 };
+  enum { LOG_ODDS_SCALE = 10, LOG_ODDS_HIT = 9, LOG_ODDS_MISS = -4, LOG_ODDS_LIMIT = 40, LOG_ODDS_OCCUPIED = 10 };
+
+  OccupancyGrid(float minX, float minY, float maxX, float maxY, float resolution);
+  virtual ~OccupancyGrid();
+
+  // Integrates one scan taken at the given pose (yaw counterclockwise, 0 along x). The beams go from
+  // left (+fieldOfView / 2) to right, the ranges beyond maxRange only clear the cells up to maxRange.
+  void update(float x, float y, float yaw, const float *ranges, int count, float fieldOfView, float maxRange);
+  // marks a rectangle as occupied for good, for the walls known in advance
+  void addStaticObstacle(float minX, float minY, float maxX, float maxY);
+  void clear();
+
+  // Cells (y * width + x) which became occupied or free since the last clearChanges(), for the planners
+  // which only repair their search around them. A cell is listed at each flip, so it can appear several
+  // times and be back to its first state. Past MAX_CHANGES the list is dropped and
+  // changesOverflowed() tells that the whole grid should be read again.
+  enum { MAX_CHANGES = 4096 };
+  const std::vector<int> &changes() const { return mChanges; }
+  bool changesOverflowed() const { return mChangesOverflowed; }
+  void clearChanges();
+  // changes whenever a cell becomes occupied or free, for the users which rebuild their own view of the grid
+  unsigned int revision() const { return mRevision; }
+
+  int width() const { return mWidth; }
+  int height() const { return mHeight; }
+  float resolution() const { return mResolution; }
+  float minX() const { return mMinX; }
+  float minY() const { return mMinY; }
+
+  bool worldToCell(float x, float y, int *cx, int *cy) const;
+  void cellToWorld(int cx, int cy, float *x, float *y) const;
+  // 0 for an unknown cell or outside of the grid
+  int logOdds(int cx, int cy) const;
+  float probability(float x, float y) const;
+  bool isOccupied(int cx, int cy) const { return logOdds(cx, cy) >= LOG_ODDS_OCCUPIED; }
+  bool isOccupied(float x, float y) const;
+  // no occupied cell closer than clearance to the segment, the unknown cells are considered free
+  bool isSegmentFree(float x0, float y0, float x1, float y1, float clearance) const;
+
+private:
+  int index(int cx, int cy) const {
+    const int tile = (cy >> TILE_SHIFT) * mTilesX + (cx >> TILE_SHIFT);
+    return (tile << (2 * TILE_SHIFT)) + ((cy & TILE_MASK) << TILE_SHIFT) + (cx & TILE_MASK);
+  }
+  bool isInside(int cx, int cy) const { return cx >= 0 && cy >= 0 && cx < mWidth && cy < mHeight; }
+  void add(int cx, int cy, int value);
+  void traceRay(int x0, int y0, int x1, int y1, bool hit);
+  void updateBeamTable(int count, float fieldOfView);
+  void recordChange(int cx, int cy);
+
+  float mMinX, mMinY;
+  float mResolution;
+  int mWidth, mHeight;
+  int mTilesX, mTilesY;
+  std::vector<signed char> mCells;
+  // the static obstacles are never cleared by the beams
+  std::vector<unsigned char> mStatic;
+
+  std::vector<int> mChanges;
+  bool mChangesOverflowed;
+  unsigned int mRevision;
+
+  // direction of each beam in the frame of the robot, recomputed only when the Lidar changes
+  int mBeamCount;
+  float mFieldOfView;
+  std::vector<float> mBeamCos;
+  std::vector<float> mBeamSin;
+  // end of each beam of the current scan, in cells
+  std::vector<int> mEndX;
+  std::vector<int> mEndY;
+  std::vector<unsigned char> mHit;
+};
+
+#endif
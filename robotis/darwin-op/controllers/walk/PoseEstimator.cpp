@@ -0,0 +1,182 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PoseEstimator.hpp"
+
+#include <cmath>
+
+using namespace std;
+
+// standard deviations of the state when the filter starts
+static const float cInitialPosition = 0.1f;
+static const float cInitialYaw = 0.1f;
+static const float cInitialSpeed = 0.05f;
+static const float cInitialYawRate = 0.1f;
+// after this number of positions rejected in a row, the filter is lost and starts again from the measurement
+static const int cMaxRejectedPositions = 25;
+
+static float normalizeAngle(float angle) {
+  return atan2(sin(angle), cos(angle));
+}
+
+PoseEstimator::PoseEstimator() : mInitialized(false), mRejectedPositions(0), mLateralSpeed(0.0f) {
+  mParameters.speedScale = 0.15f;
+  mParameters.lateralScale = 0.1f;
+  mParameters.turnScale = 0.8f;
+  mParameters.timeConstant = 0.3f;
+  mParameters.accelerationNoise = 0.2f;
+  mParameters.angularNoise = 0.5f;
+  mParameters.positionNoise = 0.02f;
+  mParameters.gpsNoise = 0.05f;
+  mParameters.yawNoise = 0.02f;
+  mParameters.gyroNoise = 0.1f;
+  mParameters.gate = 4.0f;
+  reset(0.0f, 0.0f, 0.0f);
+  mInitialized = false;
+}
+
+PoseEstimator::~PoseEstimator() {
+}
+
+void PoseEstimator::reset(float x, float y, float yaw) {
+  mState[X] = x;
+  mState[Y] = y;
+  mState[YAW] = normalizeAngle(yaw);
+  mState[SPEED] = 0.0f;
+  mState[YAW_RATE] = 0.0f;
+  mLateralSpeed = 0.0f;
+  mRejectedPositions = 0;
+  for (int i = 0; i < STATE_SIZE; i++) {
+    for (int j = 0; j < STATE_SIZE; j++)
+      mCovariance[i][j] = 0.0f;
+  }
+  mCovariance[X][X] = cInitialPosition * cInitialPosition;
+  mCovariance[Y][Y] = cInitialPosition * cInitialPosition;
+  mCovariance[YAW][YAW] = cInitialYaw * cInitialYaw;
+  mCovariance[SPEED][SPEED] = cInitialSpeed * cInitialSpeed;
+  mCovariance[YAW_RATE][YAW_RATE] = cInitialYawRate * cInitialYawRate;
+  mInitialized = true;
+}
+
+void PoseEstimator::predict(float dt, float xAmplitude, float yAmplitude, float aAmplitude, bool walking) {
+  if (!mInitialized || dt <= 0.0f)
+    return;
+  const Parameters &p = mParameters;
+  const float commandedSpeed = walking ? p.speedScale * xAmplitude : 0.0f;
+  const float commandedYawRate = walking ? p.turnScale * aAmplitude : 0.0f;
+  mLateralSpeed = walking ? p.lateralScale * yAmplitude : 0.0f;
+  const float lag = dt < p.timeConstant ? dt / p.timeConstant : 1.0f;
+
+  const float c = cos(mState[YAW]);
+  const float s = sin(mState[YAW]);
+  const float v = mState[SPEED];
+  const float vl = mLateralSpeed;
+
+  // jacobian of the motion, the identity except for these terms
+  float F[STATE_SIZE][STATE_SIZE] = {};
+  for (int i = 0; i < STATE_SIZE; i++)
+    F[i][i] = 1.0f;
+  F[X][YAW] = -(v * s + vl * c) * dt;
+  F[X][SPEED] = c * dt;
+  F[Y][YAW] = (v * c - vl * s) * dt;
+  F[Y][SPEED] = s * dt;
+  F[YAW][YAW_RATE] = dt;
+  F[SPEED][SPEED] = 1.0f - lag;
+  F[YAW_RATE][YAW_RATE] = 1.0f - lag;
+
+  mState[X] += (v * c - vl * s) * dt;
+  mState[Y] += (v * s + vl * c) * dt;
+  mState[YAW] = normalizeAngle(mState[YAW] + mState[YAW_RATE] * dt);
+  mState[SPEED] += (commandedSpeed - v) * lag;
+  mState[YAW_RATE] += (commandedYawRate - mState[YAW_RATE]) * lag;
+
+  // P = F P F' + Q
+  float FP[STATE_SIZE][STATE_SIZE];
+  for (int i = 0; i < STATE_SIZE; i++) {
+    for (int j = 0; j < STATE_SIZE; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k < STATE_SIZE; k++)
+        sum += F[i][k] * mCovariance[k][j];
+      FP[i][j] = sum;
+    }
+  }
+  for (int i = 0; i < STATE_SIZE; i++) {
+    for (int j = i; j < STATE_SIZE; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k < STATE_SIZE; k++)
+        sum += FP[i][k] * F[j][k];
+      mCovariance[i][j] = sum;
+      mCovariance[j][i] = sum;
+    }
+  }
+  mCovariance[X][X] += p.positionNoise * p.positionNoise * dt;
+  mCovariance[Y][Y] += p.positionNoise * p.positionNoise * dt;
+  mCovariance[SPEED][SPEED] += p.accelerationNoise * p.accelerationNoise * dt;
+  mCovariance[YAW_RATE][YAW_RATE] += p.angularNoise * p.angularNoise * dt;
+}
+
+bool PoseEstimator::correct(int i, float innovation, float r) {
+  if (!mInitialized)
+    return false;
+  const float S = mCovariance[i][i] + r;
+  // also rejects a NaN measurement
+  if (!(innovation * innovation <= mParameters.gate * mParameters.gate * S))
+    return false;
+
+  // the measurement matrix selects the variable i, the gain is the column i of P over S
+  float K[STATE_SIZE];
+  float row[STATE_SIZE];
+  for (int j = 0; j < STATE_SIZE; j++) {
+    K[j] = mCovariance[j][i] / S;
+    row[j] = mCovariance[i][j];
+  }
+  for (int j = 0; j < STATE_SIZE; j++)
+    mState[j] += K[j] * innovation;
+  mState[YAW] = normalizeAngle(mState[YAW]);
+  for (int j = 0; j < STATE_SIZE; j++) {
+    for (int k = j; k < STATE_SIZE; k++) {
+      const float value = mCovariance[j][k] - K[j] * row[k];
+      mCovariance[j][k] = value;
+      mCovariance[k][j] = value;
+    }
+  }
+  return true;
+}
+
+bool PoseEstimator::correctPosition(float x, float y, float noise) {
+  const float r = noise * noise;
+  const bool xAccepted = correct(X, x - mState[X], r);
+  const bool yAccepted = correct(Y, y - mState[Y], r);
+  if (xAccepted && yAccepted)
+    mRejectedPositions = 0;
+  else if (++mRejectedPositions > cMaxRejectedPositions)
+    reset(x, y, mState[YAW]);
+  return xAccepted && yAccepted;
+}
+
+bool PoseEstimator::correctYaw(float yaw, float noise) {
+  return correct(YAW, normalizeAngle(yaw - mState[YAW]), noise * noise);
+}
+
+bool PoseEstimator::correctYawRate(float yawRate) {
+  return correct(YAW_RATE, yawRate - mState[YAW_RATE], mParameters.gyroNoise * mParameters.gyroNoise);
+}
+
+float PoseEstimator::velocityX() const {
+  return mState[SPEED] * cos(mState[YAW]) - mLateralSpeed * sin(mState[YAW]);
+}
+
+float PoseEstimator::velocityY() const {
+  return mState[SPEED] * sin(mState[YAW]) + mLateralSpeed * cos(mState[YAW]);
+}
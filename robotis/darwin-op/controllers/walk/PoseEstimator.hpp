@@ -0,0 +1,87 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Extended Kalman filter estimating the pose and the velocity
+//                of the robot from the gait commands, the GPS, the IMU and the gyro
+
+#ifndef POSE_ESTIMATOR_HPP
+#define POSE_ESTIMATOR_HPP
+
+// The state is (x, y, yaw, forward speed, yaw rate) in the frame of the GPS. The prediction moves the
+// robot at the estimated speeds, which follow the speeds commanded by the amplitudes of the gait with a
+// first order lag. Each measurement corrects the state alone, the updates are scalar so that no matrix is
+// inverted, and a measurement too far from the prediction (more than gate standard deviations) is
+// rejected as a glitch, unless the positions keep disagreeing. The matrices are arrays of fixed size, nothing
+// is allocated.
+class PoseEstimator {
+public:
+  enum { X = 0, Y, YAW, SPEED, YAW_RATE, STATE_SIZE };
+
+  struct Parameters {
+    float speedScale;           // m/s forward at X amplitude 1
+    float lateralScale;         // m/s to the left at Y amplitude 1
+    float turnScale;            // rad/s at A amplitude 1
+    float timeConstant;         // s, lag of the speeds behind the commands
+    float accelerationNoise;    // m/s^2, unmodeled changes of speed
+    float angularNoise;         // rad/s^2, unmodeled changes of yaw rate
+    float positionNoise;        // m/sqrt(s), slipping of the feet
+    float gpsNoise;             // m
+    float yawNoise;             // rad
+    float gyroNoise;            // rad/s
+    float gate;                 // standard deviations
+  };
+
+  PoseEstimator();
+  virtual ~PoseEstimator();
+
+  void setParameters(const Parameters &parameters) { mParameters = parameters; }
+  const Parameters &parameters() const { return mParameters; }
+
+  // the first measurements of the GPS and the IMU start the filter, standing
+  void reset(float x, float y, float yaw);
+  bool isInitialized() const { return mInitialized; }
+
+  // moves the state dt seconds ahead, the amplitudes are the ones given to the gait manager (in [-1, 1])
+  // and walking is false while the gait is stopped
+  void predict(float dt, float xAmplitude, float yAmplitude, float aAmplitude, bool walking);
+  // false if the measurement is rejected, the noise is given for the sources other than the GPS and the IMU
+  bool correctPosition(float x, float y) { return correctPosition(x, y, mParameters.gpsNoise); }
+  bool correctPosition(float x, float y, float noise);
+  bool correctYaw(float yaw) { return correctYaw(yaw, mParameters.yawNoise); }
+  bool correctYaw(float yaw, float noise);
+  bool correctYawRate(float yawRate);
+
+  float x() const { return mState[X]; }
+  float y() const { return mState[Y]; }
+  float yaw() const { return mState[YAW]; }
+  float speed() const { return mState[SPEED]; }
+  float yawRate() const { return mState[YAW_RATE]; }
+  // velocity in the frame of the GPS, including the commanded lateral speed
+  float velocityX() const;
+  float velocityY() const;
+  float covariance(int i, int j) const { return mCovariance[i][j]; }
+
+private:
+  // measurement of the state variable i with the variance r, the innovation is given
+  bool correct(int i, float innovation, float r);
+
+  Parameters mParameters;
+  bool mInitialized;
+  int mRejectedPositions;
+  float mLateralSpeed;
+  float mState[STATE_SIZE];
+  float mCovariance[STATE_SIZE][STATE_SIZE];
+};
+
+#endif
@@ -0,0 +1,49 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Sensors and actuators used by the navigation, implemented by
+//                the Webots controller and by the headless simulator
+
+#ifndef ROBOT_INTERFACE_HPP
+#define ROBOT_INTERFACE_HPP
+
+// The poses are in the frame of the GPS, the yaw counterclockwise and 0 along x.
+class RobotInterface {
+public:
+  virtual ~RobotInterface() {}
+
+  // s, since the start
+  virtual double time() const = 0;
+  // s, period of the control loop
+  virtual float timeStep() const = 0;
+  // false while the sensor has no valid value, or if the robot has none
+  virtual bool gpsPosition(float *x, float *y) const = 0;
+  virtual bool imuYaw(float *yaw) const = 0;
+  // rad/s, counterclockwise
+  virtual float gyroYawRate() const = 0;
+
+  // range image of the Lidar, the beams go from left (+fieldOfView / 2) to right
+  virtual const float *lidarRanges() const = 0;
+  virtual int lidarResolution() const = 0;
+  virtual float lidarFieldOfView() const = 0;
+  virtual float lidarMinRange() const = 0;
+  virtual float lidarMaxRange() const = 0;
+
+  // amplitudes of the gait, in [-1, 1], applied during the next step
+  virtual void setGaitAmplitudes(float xAmplitude, float aAmplitude) = 0;
+  // amplitudes applied during the last step, walking is false while the gait is stopped
+  virtual void gaitAmplitudes(float *xAmplitude, float *yAmplitude, float *aAmplitude, bool *walking) const = 0;
+};
+
+#endif
@@ -0,0 +1,293 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ScanMatcher.hpp"
+#include "OccupancyGrid.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+using namespace std;
+
+// the distances of the chamfer transform are in thirds of cells, 3 along an axis and 4 along a diagonal
+static const int cStraight = 3;
+static const int cDiagonal = 4;
+static const int cFar = 1 << 20;
+// the field is 0 farther than this number of sigmas from the obstacles
+static const float cFieldCutoff = 3.0f;
+// the beams closer than this hit the robot itself
+static const float cMinRange = 0.05f;
+// the field is rebuilt at most once in this number of matches, about 1 ms for the whole exhibition
+static const int cFieldPeriod = 10;
+// finest yaw step, in radians, for the scans with only close points
+static const float cMaxAngularStep = 0.05f;
+
+ScanMatcher::ScanMatcher(const OccupancyGrid *grid) :
+  mGrid(grid),
+  mScore(0.0f),
+  mWidth(0),
+  mHeight(0),
+  mFieldRevision(0),
+  mFieldValid(false),
+  mFieldAge(0),
+  mBeamCount(0),
+  mFieldOfView(0.0f) {
+  Parameters parameters;
+  parameters.linearWindow = 0.25f;
+  parameters.angularWindow = 0.15f;
+  parameters.sigma = 0.1f;
+  parameters.maxRange = 4.0f;
+  parameters.minScore = 0.4f;
+  parameters.priorWeight = 0.05f;
+  parameters.minPoints = 20;
+  setParameters(parameters);
+}
+
+ScanMatcher::~ScanMatcher() {
+}
+
+void ScanMatcher::setParameters(const Parameters &parameters) {
+  mParameters = parameters;
+  // the size of the padding depends on the window
+  mFieldValid = false;
+}
+
+int ScanMatcher::scorePoints(const vector<unsigned char> &field, const int *cells, int offset) const {
+  const unsigned char *f = &field[0];
+  int score = 0;
+  const int n = mPointsX.size();
+  for (int i = 0; i < n; i++)
+    score += f[cells[i] + offset];
+  return score;
+}
+
+void ScanMatcher::updateField() {
+  mFieldAge++;
+  if (mFieldValid && (mFieldRevision == mGrid->revision() || mFieldAge < cFieldPeriod))
+    return;
+  mFieldValid = true;
+  mFieldAge = 0;
+  mFieldRevision = mGrid->revision();
+
+  // the field is padded with zeros so that the points of the grid moved by any offset of the window stay
+  // in the field
+  const float resolution = mGrid->resolution();
+  const int gridWidth = mGrid->width();
+  const int gridHeight = mGrid->height();
+  const int margin = (int)ceil(mParameters.linearWindow / resolution) + COARSE_SIZE;
+  mWidth = gridWidth + 2 * margin;
+  mHeight = gridHeight + 2 * margin;
+
+  // chamfer distance to the closest occupied cell, in a forward and a backward pass
+  mDistances.resize(gridWidth * gridHeight);
+  int *d = &mDistances[0];
+  for (int y = 0; y < gridHeight; y++) {
+    for (int x = 0; x < gridWidth; x++)
+      d[y * gridWidth + x] = mGrid->isOccupied(x, y) ? 0 : cFar;
+  }
+  for (int y = 0; y < gridHeight; y++) {
+    for (int x = 0; x < gridWidth; x++) {
+      int &c = d[y * gridWidth + x];
+      if (x > 0)
+        c = min(c, d[y * gridWidth + x - 1] + cStraight);
+      if (y > 0) {
+        c = min(c, d[(y - 1) * gridWidth + x] + cStraight);
+        if (x > 0)
+          c = min(c, d[(y - 1) * gridWidth + x - 1] + cDiagonal);
+        if (x < gridWidth - 1)
+          c = min(c, d[(y - 1) * gridWidth + x + 1] + cDiagonal);
+      }
+    }
+  }
+  for (int y = gridHeight - 1; y >= 0; y--) {
+    for (int x = gridWidth - 1; x >= 0; x--) {
+      int &c = d[y * gridWidth + x];
+      if (x < gridWidth - 1)
+        c = min(c, d[y * gridWidth + x + 1] + cStraight);
+      if (y < gridHeight - 1) {
+        c = min(c, d[(y + 1) * gridWidth + x] + cStraight);
+        if (x < gridWidth - 1)
+          c = min(c, d[(y + 1) * gridWidth + x + 1] + cDiagonal);
+        if (x > 0)
+          c = min(c, d[(y + 1) * gridWidth + x - 1] + cDiagonal);
+      }
+    }
+  }
+
+  // gaussian of the distance, tabulated for the distances under the cutoff
+  const float step = resolution / cStraight;
+  const int cutoff = (int)(cFieldCutoff * mParameters.sigma / step);
+  unsigned char table[256];
+  const int tableSize = min(cutoff + 1, 256);
+  for (int i = 0; i < tableSize; i++) {
+    const float distance = i * step / mParameters.sigma;
+    table[i] = (unsigned char)(255.0f * exp(-0.5f * distance * distance) + 0.5f);
+  }
+  mField.assign(mWidth * mHeight, 0);
+  for (int y = 0; y < gridHeight; y++) {
+    for (int x = 0; x < gridWidth; x++) {
+      const int distance = d[y * gridWidth + x];
+      if (distance < tableSize)
+        mField[(y + margin) * mWidth + x + margin] = table[distance];
+    }
+  }
+
+  // maximum of the block starting at each cell, along the rows then along the columns
+  vector<unsigned char> &coarse = mCoarseField;
+  coarse.resize(mWidth * mHeight);
+  for (int y = 0; y < mHeight; y++) {
+    for (int x = 0; x < mWidth; x++) {
+      unsigned char m = 0;
+      for (int k = 0; k < COARSE_SIZE && x + k < mWidth; k++)
+        m = max(m, mField[y * mWidth + x + k]);
+      coarse[y * mWidth + x] = m;
+    }
+  }
+  for (int y = 0; y < mHeight; y++) {
+    for (int x = 0; x < mWidth; x++) {
+      unsigned char m = coarse[y * mWidth + x];
+      for (int k = 1; k < COARSE_SIZE && y + k < mHeight; k++)
+        m = max(m, coarse[(y + k) * mWidth + x]);
+      coarse[y * mWidth + x] = m;
+    }
+  }
+}
+
+void ScanMatcher::updateBeamTable(int count, float fieldOfView) {
+  if (count == mBeamCount && fieldOfView == mFieldOfView)
+    return;
+  mBeamCount = count;
+  mFieldOfView = fieldOfView;
+  mBeamCos.resize(count);
+  mBeamSin.resize(count);
+  mPointsX.reserve(count);
+  mPointsY.reserve(count);
+  for (int i = 0; i < count; i++) {
+    const float angle = 0.5f * fieldOfView - (i + 0.5f) * fieldOfView / count;
+    mBeamCos[i] = cos(angle);
+    mBeamSin[i] = sin(angle);
+  }
+}
+
+bool ScanMatcher::match(const float *ranges, int count, float fieldOfView, float *x, float *y, float *yaw) {
+  mScore = 0.0f;
+  if (!ranges || count <= 0)
+    return false;
+  updateBeamTable(count, fieldOfView);
+  updateField();
+  const Parameters &p = mParameters;
+
+  // points of the valid beams, NaN fails the comparisons
+  mPointsX.clear();
+  mPointsY.clear();
+  float farthest = 0.0f;
+  for (int i = 0; i < count; i++) {
+    const float r = ranges[i];
+    if (r > cMinRange && r < p.maxRange) {
+      mPointsX.push_back(r * mBeamCos[i]);
+      mPointsY.push_back(r * mBeamSin[i]);
+      farthest = max(farthest, r);
+    }
+  }
+  const int n = mPointsX.size();
+  if (n < p.minPoints)
+    return false;
+
+  // the yaw step moves the farthest point by about one cell
+  const float resolution = mGrid->resolution();
+  const float angularStep = min(cMaxAngularStep, resolution / farthest);
+  const int angles = (int)ceil(p.angularWindow / angularStep);
+  const int window = (int)ceil(p.linearWindow / resolution);
+  const int margin = (mWidth - mGrid->width()) / 2;
+  const float minX = mGrid->minX();
+  const float minY = mGrid->minY();
+
+  // cells of the points for each yaw, relative to the origin of the field, the points out of the grid
+  // would score 0 at any offset and point to the first cell of the padding on the left of the grid
+  // instead, moved by any offset of the window it stays in the padding of its row or of the previous one
+  mCells.resize((2 * angles + 1) * n);
+  const int outside = margin * mWidth;
+  for (int a = -angles; a <= angles; a++) {
+    const float c = cos(*yaw + a * angularStep);
+    const float s = sin(*yaw + a * angularStep);
+    int *cells = &mCells[(a + angles) * n];
+    for (int i = 0; i < n; i++) {
+      const float wx = *x + c * mPointsX[i] - s * mPointsY[i];
+      const float wy = *y + s * mPointsX[i] + c * mPointsY[i];
+      const int cx = (int)floor((wx - minX) / resolution);
+      const int cy = (int)floor((wy - minY) / resolution);
+      const bool inside = cx >= 0 && cy >= 0 && cx < mGrid->width() && cy < mGrid->height();
+      cells[i] = inside ? (cy + margin) * mWidth + cx + margin : outside;
+    }
+  }
+
+  // the moves away from the previous pose are penalized, in fractions of the perfect score, so that the
+  // pose does not slide along a featureless wall with the noise of the ranges
+  const float linearPenalty = 255.0f * n * p.priorWeight / (window * window);
+  const float angularPenalty = angles > 0 ? 255.0f * n * p.priorWeight / (angles * angles) : 0.0f;
+
+  // bounds of the blocks of translations, with the smallest penalty of the block
+  mCandidates.clear();
+  for (int a = -angles; a <= angles; a++) {
+    const int *cells = &mCells[(a + angles) * n];
+    for (int dy = -window; dy <= window; dy += COARSE_SIZE) {
+      for (int dx = -window; dx <= window; dx += COARSE_SIZE) {
+        const int closestX = dx > 0 ? dx : min(0, min(dx + COARSE_SIZE - 1, window));
+        const int closestY = dy > 0 ? dy : min(0, min(dy + COARSE_SIZE - 1, window));
+        Candidate candidate;
+        candidate.angle = a;
+        candidate.dx = dx;
+        candidate.dy = dy;
+        candidate.score = scorePoints(mCoarseField, cells, dy * mWidth + dx) -
+                          (int)(linearPenalty * (closestX * closestX + closestY * closestY) + angularPenalty * a * a);
+        mCandidates.push_back(candidate);
+      }
+    }
+  }
+  stable_sort(mCandidates.begin(), mCandidates.end());
+
+  // the translations of the blocks, the ones with the best bound first
+  int bestScore = INT_MIN;
+  int bestMatch = 0;
+  int bestAngle = 0, bestX = 0, bestY = 0;
+  for (size_t k = 0; k < mCandidates.size(); k++) {
+    const Candidate &candidate = mCandidates[k];
+    if (candidate.score <= bestScore)
+      break;
+    const int *cells = &mCells[(candidate.angle + angles) * n];
+    const float penalty = angularPenalty * candidate.angle * candidate.angle;
+    for (int dy = candidate.dy; dy < candidate.dy + COARSE_SIZE && dy <= window; dy++) {
+      for (int dx = candidate.dx; dx < candidate.dx + COARSE_SIZE && dx <= window; dx++) {
+        const int match = scorePoints(mField, cells, dy * mWidth + dx);
+        const int score = match - (int)(linearPenalty * (dx * dx + dy * dy) + penalty);
+        if (score > bestScore) {
+          bestScore = score;
+          bestMatch = match;
+          bestAngle = candidate.angle;
+          bestX = dx;
+          bestY = dy;
+        }
+      }
+    }
+  }
+
+  mScore = bestMatch / (255.0f * n);
+  if (mScore < p.minScore)
+    return false;
+  *x += bestX * resolution;
+  *y += bestY * resolution;
+  *yaw = atan2(sin(*yaw + bestAngle * angularStep), cos(*yaw + bestAngle * angularStep));
+  return true;
+}
@@ -0,0 +1,98 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Correlative matching of the Lidar range images against the
+//                occupancy grid, to localize the robot without GPS
+
+#ifndef SCAN_MATCHER_HPP
+#define SCAN_MATCHER_HPP
+
+#include <vector>
+
+class OccupancyGrid;
+
+// The occupied cells of the grid are blurred into a likelihood field (255 on an obstacle, decreasing
+// with the distance to it), which is rebuilt when the grid changes, at most every few scans. A pose is
+// scored by the sum of the field under the points of the scan. The poses around the previous one are
+// searched exhaustively in two resolutions: for each yaw, blocks of COARSE_SIZE x COARSE_SIZE
+// translations are scored on a field where each cell holds the maximum of the block of cells starting
+// at it, which bounds the scores of the translations of the block. The blocks are then refined by decreasing bound, until the bound falls
+// below the best translation found (branch and bound), so that most of the window is never scored at
+// the full resolution. The scores are lowered with the distance to the previous pose, which is the
+// prediction of the pose estimator.
+class ScanMatcher {
+public:
+  enum { COARSE_SIZE = 4 };
+
+  struct Parameters {
+    float linearWindow;     // m, the translations searched around the previous pose
+    float angularWindow;    // rad
+    float sigma;            // m, width of the likelihood around the obstacles
+    float maxRange;         // m, the farther beams are ignored
+    float minScore;         // average field under the points, in [0, 1], to accept a match
+    float priorWeight;      // fraction of the perfect score lost by a move to the edge of the window
+    int minPoints;
+  };
+
+  explicit ScanMatcher(const OccupancyGrid *grid);
+  virtual ~ScanMatcher();
+
+  void setParameters(const Parameters &parameters);
+  const Parameters &parameters() const { return mParameters; }
+
+  // Searches the pose of the Lidar around (*x, *y, *yaw) which best aligns the scan with the grid, the
+  // beams go from left (+fieldOfView / 2) to right. The pose is changed and true returned if the match
+  // is good enough.
+  bool match(const float *ranges, int count, float fieldOfView, float *x, float *y, float *yaw);
+  // average field under the points at the last match, in [0, 1]
+  float score() const { return mScore; }
+
+private:
+  void updateField();
+  void updateBeamTable(int count, float fieldOfView);
+  int scorePoints(const std::vector<unsigned char> &field, const int *cells, int offset) const;
+
+  const OccupancyGrid *mGrid;
+  Parameters mParameters;
+  float mScore;
+
+  // likelihood fields, row major, the coarse one holds the maxima of the blocks
+  int mWidth, mHeight;
+  std::vector<unsigned char> mField;
+  std::vector<unsigned char> mCoarseField;
+  unsigned int mFieldRevision;
+  bool mFieldValid;
+  int mFieldAge;
+  std::vector<int> mDistances;
+
+  int mBeamCount;
+  float mFieldOfView;
+  std::vector<float> mBeamCos;
+  std::vector<float> mBeamSin;
+  // points of the scan in the frame of the Lidar
+  std::vector<float> mPointsX;
+  std::vector<float> mPointsY;
+  // cells of the points for each yaw of the window, relative to the cell of the previous pose
+  std::vector<int> mCells;
+
+  struct Candidate {
+    int angle;
+    int dx, dy;
+    int score;
+    bool operator<(const Candidate &other) const { return score > other.score; }
+  };
+  std::vector<Candidate> mCandidates;
+};
+
+#endif
@@ -0,0 +1,213 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ScanProcessor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const float cPi = 3.14159265f;
+
+// two neighbor beams are on different objects if their ranges differ by more than
+// cJumpDistance + cJumpRatio * range, the ratio allows the walls seen at a grazing angle
+static const float cJumpDistance = 0.1f;
+static const float cJumpRatio = 0.15f;
+static const int cMinClusterBeams = 3;
+// a part of a cluster is straight if no point is farther than this from the line between its ends
+static const float cSplitDistance = 0.05f;
+static const int cMinSegmentBeams = 3;
+// smallest angle between two segments making a corner, in radians
+static const float cCornerAngle = 0.5f;
+
+ScanProcessor::ScanProcessor() : mCount(0), mFieldOfView(0.0f), mMaxRange(0.0f) {
+}
+
+ScanProcessor::~ScanProcessor() {
+}
+
+float ScanProcessor::beamAngle(int beam) const {
+  return 0.5f * mFieldOfView - (beam + 0.5f) * mFieldOfView / mCount;
+}
+
+void ScanProcessor::updateBeamTable(int count, float fieldOfView) {
+  if (count == mCount && fieldOfView == mFieldOfView)
+    return;
+  mCount = count;
+  mFieldOfView = fieldOfView;
+  mBeamCos.resize(count);
+  mBeamSin.resize(count);
+  mClipped.resize(count);
+  mFiltered.resize(count);
+  mPointsX.resize(count);
+  mPointsY.resize(count);
+  // less features than beams, nothing is allocated while processing a scan
+  mClusters.reserve(count);
+  mSegments.reserve(count);
+  mCorners.reserve(count);
+  mStack.reserve(count);
+  // the beams are at the center of the columns of the range image, from left to right
+  for (int i = 0; i < count; i++) {
+    mBeamCos[i] = cos(beamAngle(i));
+    mBeamSin[i] = sin(beamAngle(i));
+  }
+}
+
+void ScanProcessor::process(const float *ranges, int count, float fieldOfView, float minRange, float maxRange,
+                            float x, float y, float yaw) {
+  mClusters.clear();
+  mSegments.clear();
+  mCorners.clear();
+  if (!ranges || count <= 0) {
+    mCount = 0;
+    return;
+  }
+  updateBeamTable(count, fieldOfView);
+  mMaxRange = maxRange;
+
+  // clipping, NaN fails both comparisons
+  float *clipped = &mClipped[0];
+  for (int i = 0; i < count; i++) {
+    const float r = ranges[i];
+    const bool valid = (r >= minRange) & (r < maxRange);
+    clipped[i] = valid ? r : maxRange;
+  }
+
+  // median of each beam and its two neighbors
+  float *filtered = &mFiltered[0];
+  filtered[0] = clipped[0];
+  filtered[count - 1] = clipped[count - 1];
+  for (int i = 1; i < count - 1; i++) {
+    const float a = clipped[i - 1];
+    const float b = clipped[i];
+    const float c = clipped[i + 1];
+    filtered[i] = max(min(a, b), min(max(a, b), c));
+  }
+
+  // points in the world frame, the beam directions are rotated by the yaw
+  const float cy = cos(yaw);
+  const float sy = sin(yaw);
+  const float *beamCos = &mBeamCos[0];
+  const float *beamSin = &mBeamSin[0];
+  float *pointsX = &mPointsX[0];
+  float *pointsY = &mPointsY[0];
+  for (int i = 0; i < count; i++) {
+    const float r = filtered[i];
+    pointsX[i] = x + r * (cy * beamCos[i] - sy * beamSin[i]);
+    pointsY[i] = y + r * (sy * beamCos[i] + cy * beamSin[i]);
+  }
+
+  findClusters();
+  for (size_t i = 0; i < mClusters.size(); i++)
+    splitCluster(mClusters[i]);
+}
+
+void ScanProcessor::findClusters() {
+  const float *filtered = &mFiltered[0];
+  int first = -1;
+  for (int i = 0; i <= mCount; i++) {
+    bool end = i == mCount || !isValid(i);
+    if (!end && first >= 0) {
+      const float near = min(filtered[i - 1], filtered[i]);
+      end = fabs(filtered[i] - filtered[i - 1]) > cJumpDistance + cJumpRatio * near;
+    }
+    if (end && first >= 0) {
+      if (i - first >= cMinClusterBeams) {
+        const ScanCluster cluster = {first, i - 1};
+        mClusters.push_back(cluster);
+      }
+      first = -1;
+    }
+    if (first < 0 && i < mCount && isValid(i))
+      first = i;
+  }
+}
+
+float ScanProcessor::farthestFromChord(int first, int last, int *beam) const {
+  const float x0 = mPointsX[first];
+  const float y0 = mPointsY[first];
+  const float dx = mPointsX[last] - x0;
+  const float dy = mPointsY[last] - y0;
+  const float length = sqrt(dx * dx + dy * dy);
+  float farthest = 0.0f;
+  *beam = first;
+  if (length <= 0.0f)
+    return 0.0f;
+  for (int i = first + 1; i < last; i++) {
+    const float distance = fabs(dx * (mPointsY[i] - y0) - dy * (mPointsX[i] - x0)) / length;
+    if (distance > farthest) {
+      farthest = distance;
+      *beam = i;
+    }
+  }
+  return farthest;
+}
+
+void ScanProcessor::addSegment(int first, int last) {
+  // merged with the previous segment if they are aligned
+  int beam;
+  if (!mSegments.empty() && mSegments.back().lastBeam == first &&
+      farthestFromChord(mSegments.back().firstBeam, last, &beam) <= cSplitDistance)
+    first = mSegments.back().firstBeam;
+  else if (last - first + 1 < cMinSegmentBeams)
+    return;
+  else
+    mSegments.push_back(ScanSegment());
+  ScanSegment &segment = mSegments.back();
+  segment.x0 = mPointsX[first];
+  segment.y0 = mPointsY[first];
+  segment.x1 = mPointsX[last];
+  segment.y1 = mPointsY[last];
+  segment.firstBeam = first;
+  segment.lastBeam = last;
+}
+
+void ScanProcessor::splitCluster(const ScanCluster &cluster) {
+  const size_t firstSegment = mSegments.size();
+
+  // split at the farthest point until the parts are straight, the left part first
+  mStack.clear();
+  mStack.push_back(cluster);
+  while (!mStack.empty()) {
+    const ScanCluster part = mStack.back();
+    mStack.pop_back();
+    int beam;
+    if (part.lastBeam - part.firstBeam >= 2 &&
+        farthestFromChord(part.firstBeam, part.lastBeam, &beam) > cSplitDistance) {
+      const ScanCluster right = {beam, part.lastBeam};
+      const ScanCluster left = {part.firstBeam, beam};
+      mStack.push_back(right);
+      mStack.push_back(left);
+    } else
+      addSegment(part.firstBeam, part.lastBeam);
+  }
+
+  // corners between the consecutive segments of the cluster
+  for (size_t i = firstSegment + 1; i < mSegments.size(); i++) {
+    const ScanSegment &a = mSegments[i - 1];
+    const ScanSegment &b = mSegments[i];
+    if (a.lastBeam != b.firstBeam)
+      continue;
+    const float angleA = atan2(a.y1 - a.y0, a.x1 - a.x0);
+    const float angleB = atan2(b.y1 - b.y0, b.x1 - b.x0);
+    float angle = fabs(angleB - angleA);
+    if (angle > cPi)
+      angle = 2.0f * cPi - angle;
+    if (angle > cCornerAngle) {
+      const ScanCorner corner = {a.x1, a.y1};
+      mCorners.push_back(corner);
+    }
+  }
+}
@@ -0,0 +1,97 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Filtering of the Lidar range images and extraction of the
+//                walls and corners they show
+
+#ifndef SCAN_PROCESSOR_HPP
+#define SCAN_PROCESSOR_HPP
+
+#include <vector>
+
+// consecutive beams hitting the same object, without a jump of range between them
+struct ScanCluster {
+  int firstBeam;
+  int lastBeam;
+};
+
+// straight part of a cluster, in world coordinates
+struct ScanSegment {
+  float x0, y0;
+  float x1, y1;
+  int firstBeam;
+  int lastBeam;
+};
+
+struct ScanCorner {
+  float x, y;
+};
+
+// process() runs the steps in order, each one over the whole scan:
+// - the invalid ranges (infinite, NaN, out of [minRange, maxRange[) are replaced by maxRange,
+// - a median filter of 3 beams removes the isolated noisy beams,
+// - the beams are converted to points in the world frame with the per-beam sin/cos tables,
+// - the valid beams are grouped in clusters, split where the range jumps,
+// - each cluster is split into straight segments (split and merge), the sharp angles between two
+//   segments of a cluster are corners.
+// The first three steps have no branch so that the compiler vectorizes them. The buffers are allocated
+// when the resolution of the Lidar changes only.
+class ScanProcessor {
+public:
+  ScanProcessor();
+  virtual ~ScanProcessor();
+
+  // The beams go from left (+fieldOfView / 2) to right like in the range image of the Lidar,
+  // (x, y, yaw) is the pose of the Lidar in the world.
+  void process(const float *ranges, int count, float fieldOfView, float minRange, float maxRange, float x, float y,
+               float yaw);
+
+  int count() const { return mCount; }
+  float maxRange() const { return mMaxRange; }
+  // filtered ranges, maxRange for the invalid beams
+  const float *ranges() const { return mCount > 0 ? &mFiltered[0] : 0; }
+  bool isValid(int beam) const { return mFiltered[beam] < mMaxRange; }
+  float beamAngle(int beam) const;
+  float pointX(int beam) const { return mPointsX[beam]; }
+  float pointY(int beam) const { return mPointsY[beam]; }
+
+  const std::vector<ScanCluster> &clusters() const { return mClusters; }
+  const std::vector<ScanSegment> &segments() const { return mSegments; }
+  const std::vector<ScanCorner> &corners() const { return mCorners; }
+
+private:
+  void updateBeamTable(int count, float fieldOfView);
+  void findClusters();
+  void splitCluster(const ScanCluster &cluster);
+  float farthestFromChord(int first, int last, int *beam) const;
+  void addSegment(int first, int last);
+
+  int mCount;
+  float mFieldOfView;
+  float mMaxRange;
+  std::vector<float> mBeamCos;
+  std::vector<float> mBeamSin;
+  std::vector<float> mClipped;
+  std::vector<float> mFiltered;
+  std::vector<float> mPointsX;
+  std::vector<float> mPointsY;
+
+  std::vector<ScanCluster> mClusters;
+  std::vector<ScanSegment> mSegments;
+  std::vector<ScanCorner> mCorners;
+  // beam ranges still to be split
+  std::vector<ScanCluster> mStack;
+};
+
+#endif
@@ -0,0 +1,187 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TourOptimizer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+static const float cInfinity = numeric_limits<float>::infinity();
+// replaces the infinite costs so that the differences of costs stay finite, but no tour uses them
+static const float cUnreachable = 1.0e6f;
+// a move has to shorten the tour by more than this, the rounding errors cannot make it loop
+static const float cMinGain = 1.0e-4f;
+// longest sequence of stops moved by Or-opt
+static const int cMaxSegment = 3;
+
+TourOptimizer::TourOptimizer() : mCount(0) {
+}
+
+TourOptimizer::~TourOptimizer() {
+}
+
+float TourOptimizer::optimize(const vector<float> &costs, int n, int end, vector<int> *order) {
+  order->clear();
+  if (n <= 0)
+    return 0.0f;
+  if (end == 0 || end >= n)
+    end = -1;
+  mCount = n;
+  mCosts.resize(n * n);
+  for (int i = 0; i < n * n; i++)
+    mCosts[i] = costs[i] < cUnreachable ? costs[i] : cUnreachable;
+
+  if (n <= MAX_EXACT_STOPS)
+    exact(end, order);
+  else
+    improve(end, order);
+
+  float total = 0.0f;
+  for (int i = 1; i < n; i++) {
+    const float c = costs[(*order)[i - 1] * n + (*order)[i]];
+    if (!(c < cUnreachable))
+      return cInfinity;
+    total += c;
+  }
+  return total;
+}
+
+float TourOptimizer::exact(int end, vector<int> *order) {
+  // the sets are the bit masks of the stops 1 to n - 1, the entry (mask, j) is the best path from 0
+  // through the stops of mask ending at j
+  const int n = mCount;
+  const int full = (1 << (n - 1)) - 1;
+  mTable.assign((full + 1) * n, cInfinity);
+  mParents.assign((full + 1) * n, 0);
+  for (int j = 1; j < n; j++)
+    mTable[(1 << (j - 1)) * n + j] = cost(0, j);
+  for (int mask = 1; mask <= full; mask++) {
+    for (int j = 1; j < n; j++) {
+      const float value = mTable[mask * n + j];
+      if (!(mask & (1 << (j - 1))) || value == cInfinity)
+        continue;
+      for (int k = 1; k < n; k++) {
+        const int bit = 1 << (k - 1);
+        if (mask & bit)
+          continue;
+        // the end is visited last
+        if (k == end && (mask | bit) != full)
+          continue;
+        const float c = value + cost(j, k);
+        if (c < mTable[(mask | bit) * n + k]) {
+          mTable[(mask | bit) * n + k] = c;
+          mParents[(mask | bit) * n + k] = j;
+        }
+      }
+    }
+  }
+
+  int last = end;
+  if (last < 0) {
+    last = 0;
+    for (int j = 1; j < n; j++) {
+      if (last == 0 || mTable[full * n + j] < mTable[full * n + last])
+        last = j;
+    }
+  }
+  const float best = last > 0 ? mTable[full * n + last] : 0.0f;
+  for (int mask = full, j = last; mask; ) {
+    order->push_back(j);
+    const int parent = mParents[mask * n + j];
+    mask &= ~(1 << (j - 1));
+    j = parent;
+  }
+  order->push_back(0);
+  reverse(order->begin(), order->end());
+  return best;
+}
+
+float TourOptimizer::improve(int end, vector<int> *order) {
+  // nearest neighbor tour, the end is added last
+  const int n = mCount;
+  vector<bool> visited(n, false);
+  visited[0] = true;
+  if (end > 0)
+    visited[end] = true;
+  order->push_back(0);
+  for (int i = (end > 0 ? 2 : 1); i < n; i++) {
+    const int from = order->back();
+    int next = -1;
+    for (int j = 1; j < n; j++) {
+      if (!visited[j] && (next < 0 || cost(from, j) < cost(from, next)))
+        next = j;
+    }
+    visited[next] = true;
+    order->push_back(next);
+  }
+  if (end > 0)
+    order->push_back(end);
+
+  // the last stop which can be moved
+  const int last = end > 0 ? n - 2 : n - 1;
+  while (twoOpt(last, order) || orOpt(last, order)) {
+  }
+
+  float total = 0.0f;
+  for (int i = 1; i < n; i++)
+    total += cost((*order)[i - 1], (*order)[i]);
+  return total;
+}
+
+bool TourOptimizer::twoOpt(int last, vector<int> *order) const {
+  // reverses the stops i to j
+  vector<int> &o = *order;
+  const int n = mCount;
+  for (int i = 1; i < last; i++) {
+    for (int j = i + 1; j <= last; j++) {
+      const int next = j + 1 < n ? o[j + 1] : -1;
+      const float delta = cost(o[i - 1], o[j]) + cost(o[i], next) - cost(o[i - 1], o[i]) - cost(o[j], next);
+      if (delta < -cMinGain) {
+        reverse(o.begin() + i, o.begin() + j + 1);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool TourOptimizer::orOpt(int last, vector<int> *order) const {
+  // moves the stops i to i + length - 1 between the stops p and p + 1
+  vector<int> &o = *order;
+  const int n = mCount;
+  for (int length = 1; length <= cMaxSegment; length++) {
+    for (int i = 1; i + length - 1 <= last; i++) {
+      const int first = o[i];
+      const int segmentEnd = o[i + length - 1];
+      const int next = i + length < n ? o[i + length] : -1;
+      const float removed = cost(o[i - 1], first) + cost(segmentEnd, next) - cost(o[i - 1], next);
+      for (int p = 0; p <= last; p++) {
+        if (p >= i - 1 && p <= i + length - 1)
+          continue;
+        const int y = p + 1 < n ? o[p + 1] : -1;
+        const float added = cost(o[p], first) + cost(segmentEnd, y) - cost(o[p], y);
+        if (added - removed < -cMinGain) {
+          if (p > i)
+            rotate(o.begin() + i, o.begin() + i + length, o.begin() + p + 1);
+          else
+            rotate(o.begin() + p + 1, o.begin() + i, o.begin() + i + length);
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,52 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Order of the visit of several exhibits minimizing the
+//                walked distance
+
+#ifndef TOUR_OPTIMIZER_HPP
+#define TOUR_OPTIMIZER_HPP
+
+#include <vector>
+
+// The stops are numbered from 0 to n - 1, the tour starts at the stop 0 and ends either at a given stop
+// or anywhere. Up to MAX_EXACT_STOPS the order is the optimal one (Held-Karp dynamic programming),
+// above it is improved from the nearest neighbor tour by moving the stops (2-opt and Or-opt) until no
+// move shortens it. The costs are expected to be symmetric, an unreachable pair has an infinite cost.
+class TourOptimizer {
+public:
+  enum { MAX_EXACT_STOPS = 13 };
+
+  TourOptimizer();
+  virtual ~TourOptimizer();
+
+  // costs is the n x n matrix of the costs between the stops, row major. Writes the n stops in the order
+  // of the visit and returns the cost of the tour, infinite if a stop cannot be reached.
+  float optimize(const std::vector<float> &costs, int n, int end, std::vector<int> *order);
+
+private:
+  float cost(int from, int to) const { return to < 0 ? 0.0f : mCosts[from * mCount + to]; }
+  float exact(int end, std::vector<int> *order);
+  float improve(int end, std::vector<int> *order);
+  bool twoOpt(int last, std::vector<int> *order) const;
+  bool orOpt(int last, std::vector<int> *order) const;
+
+  std::vector<float> mCosts;
+  int mCount;
+  // Held-Karp, best cost of the paths from 0 visiting a set of stops and ending at one of them
+  std::vector<float> mTable;
+  std::vector<unsigned char> mParents;
+};
+
+#endif
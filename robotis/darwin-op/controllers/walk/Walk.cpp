@@ -36,8 +36,11 @@ and run.
 #include <webots/InertialUnit.hpp>
 #include <webots/Lidar.hpp>
 #include <webots/DistanceSensor.hpp>
+#include <minIni.h>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
@@ -51,6 +54,20 @@ using namespace std;
 
 #define NOT_REVOLVE float('inf')
 
+// number of key points close to the robot where a route to an exhibit can start
+#define ROUTE_START_CANDIDATES 3
+// the gyro gives 512 at rest and 1024 at 27.925 rad/s, its third axis is vertical
+#define GYRO_CENTER 512.0
+#define GYRO_SCALE (27.925 / 512.0)
+#define GYRO_YAW_AXIS 2
+// distance to a key point and yaw error under which the robot reached it
+#define KEY_POINT_TOLERANCE 0.2
+#define YAW_TOLERANCE 0.1
+// s, the gait needs this time to start or stop
+#define GAIT_SETTLE_TIME 0.2
+// s, the arm stays raised this time after the gait has stopped
+#define SHOW_TIME 1.0
+
 static const char *motorNames[NMOTORS] = {
   "ShoulderR" /*ID1 */, "ShoulderL" /*ID2 */, "ArmUpperR" /*ID3 */, "ArmUpperL" /*ID4 */, "ArmLowerR" /*ID5 */,
   "ArmLowerL" /*ID6 */, "PelvYR" /*ID7 */,    "PelvYL" /*ID8 */,    "PelvR" /*ID9 */,     "PelvL" /*ID10*/,
@@ -62,74 +79,6 @@ bool isAutoMove() { // TODO: 自由移动
   return false;
 }
 
-vector<int> getShowOrder(int start, int end) {
-  vector<int> output_ordert = {};
-  if (start == end) {
-    output_ordert.push_back(start);
-    return output_ordert;
-  }
-  if (start == 3 && end == 6) {
-    output_ordert = {3, 2, 6};
-    return output_ordert;
-  }
-  if (start == 6 && end == 3) {
-    output_ordert = {6, 2, 3};
-    return output_ordert;
-  }
-  vector<int> current_order1 = {1, 0, 2, 3, 4, 5, 6};
-  vector<int> current_order2 = {1, 0, 2, 6, 5, 4, 3};
-  vector<int> current_order3 = {6, 5, 4, 3, 2, 0, 1};
-  vector<int> current_order4 = {3, 4, 5, 6, 2, 0, 1};
-  auto f = [](int start, int end, vector<int> current_order) {
-    vector<int> output_order = {};
-    bool findStart = false;
-    for (int i: current_order) {
-      if (i == start) {
-        output_order.push_back(i);
-        findStart = true;
-      }
-      else if (findStart && i != end) {
-        output_order.push_back(i);
-      }
-      else if (i == end && findStart) {
-        output_order.push_back(i);
-        break;
-      }
-      else if (i == end && !findStart) {
-        output_order = {};
-        break;
-      }
-
-    }
-    return output_order;
-  };
-  vector<vector<int>> nonEmptyVectors;
-  if (!f(start, end, current_order1).empty()) {nonEmptyVectors.push_back(f(start, end, current_order1));}
-  if (!f(start, end, current_order2).empty()) {nonEmptyVectors.push_back(f(start, end, current_order2));}
-  if (!f(start, end, current_order3).empty()) {nonEmptyVectors.push_back(f(start, end, current_order3));}
-  if (!f(start, end, current_order4).empty()) {nonEmptyVectors.push_back(f(start, end, current_order4));}
-  if (nonEmptyVectors.empty()) {
-    return {};
-  }
-
-  // cout << "nonEmptyVectors" << nonEmptyVectors.size() << endl;
-  // for (auto i: nonEmptyVectors) {
-  //   for (auto j: i) {
-  //     cout << j << " ";
-  //   }
-  //   cout << endl;
-  // }
-
-  int min_vec = 0;
-  for (int i = 0; i < nonEmptyVectors.size(); ++i) {
-    if (nonEmptyVectors[i].size() < nonEmptyVectors[min_vec].size()) {
-      min_vec = i;
-    }
-  }
-  return nonEmptyVectors[min_vec];
-}
-
-
 Walk::Walk() : Robot() {
   mTimeStep = getBasicTimeStep();
 
@@ -138,6 +87,7 @@ Walk::Walk() : Robot() {
   mAccelerometer = getAccelerometer("Accelerometer");
   mGPS = getGPS("gps");
   mIMU = getInertialUnit("imu");
+  // the accelerometer detects the falls and the gyro balances the gait, they are never disabled
   mAccelerometer->enable(mTimeStep);
   mLidar = getLidar("Sick LMS 291");
   mDistanceSensors[0] = getDistanceSensor("front1");
@@ -146,7 +96,8 @@ Walk::Walk() : Robot() {
   mDistanceSensors[3] = getDistanceSensor("left2");
   mDistanceSensors[4] = getDistanceSensor("right1");
   mDistanceSensors[5] = getDistanceSensor("right2");
-  getGyro("Gyro")->enable(mTimeStep);
+  mGyro = getGyro("Gyro");
+  mGyro->enable(mTimeStep);
 
   for (int i = 0; i < NMOTORS; i++) {
     mMotors[i] = getMotor(motorNames[i]);
@@ -158,16 +109,17 @@ Walk::Walk() : Robot() {
 
   mKeyboard = getKeyboard();
   mKeyboard->enable(mTimeStep);
-  mGPS->enable(mTimeStep);
-  mIMU->enable(mTimeStep);
-  mLidar->enable(mTimeStep);
-  mLidar->enablePointCloud();
-
-  for (int i = 0; i < 6; i++)
-    mDistanceSensors[i]->enable(mTimeStep);
 
   mMotionManager = new RobotisOp2MotionManager(this);
   mGaitManager = new RobotisOp2GaitManager(this, "config.ini");
+
+  lidar_depths = NULL;
+  mNavigator = new Navigator(this, "config.ini");
+  mScan = mNavigator->scan();
+  mMap = mNavigator->map();
+  mPlanner = mNavigator->planner();
+  mSensors = SENSOR_NONE;
+  setSensors(SENSOR_POSE | SENSOR_LIDAR | SENSOR_DISTANCE);
 }
 
 /*          x
@@ -180,10 +132,10 @@ Walk::Walk() : Robot() {
 */
 
 void Walk::GetNowPosition(){
-  const double *position = mGPS->getValues();
-  now_position.x = position[0];
-  now_position.y = position[1];
-  now_yaw = mIMU->getRollPitchYaw()[2];
+  mNavigator->updatePose();
+  now_position.x = mNavigator->x();
+  now_position.y = mNavigator->y();
+  now_yaw = mNavigator->yaw();
   // cout<<"yaw: "<<now_yaw<<endl;
   // cout<<"x: "<<now_position.x<<" y: "<<now_position.y<<endl;
 }
@@ -229,32 +181,33 @@ void Walk::Go2PointBug0(Point target_point){
   if (angle < -M_PI)
     angle += 2 * M_PI;
 
-
-
+  // the map accumulated from all the previous scans tells whether the straight way to the target is clear
+  if (mMap->isSegmentFree(x, y, x_target, y_target, mNavigator->clearance())) {
+    Go2Point(target_point);
+    return;
+  }
 
   // 基于激光雷达的深度信息，判断是否有障碍物
   // 有障碍物，就绕行
   // 没有障碍物，直接走向目标点
 
   // 1. 基于激光雷达的深度信息，发现深度突变的地方，就是障碍物的边缘
-  int i=-1;
-
-  for(int j=45; j<135; j++){
-
-    if(lidar_depths[j+1] > 2.0){
-      continue;
-    }
-    if(lidar_depths[j] - lidar_depths[j+1] > 0.8){
-      // 有障碍物
-      i = j+1; // 记录障碍物左侧边缘的角度
-      break;
-
+  // (the scan processor splits the clusters where the range jumps, the left edge of an obstacle closer
+  // than 2 m is the first beam of a cluster more than 0.8 m in front of the beam on its left)
+  if (mScan->count() == 0) {
+    Go2Point(target_point);
+    return;
   }
-
-
+  const float *depths = mScan->ranges();
+  const vector<ScanCluster> &clusters = mScan->clusters();
+  int i=-1;
+  for (size_t c = 0; c < clusters.size() && i == -1; c++) {
+    const int first = clusters[c].firstBeam;
+    if (first > 45 && first <= 135 && depths[first] <= 2.0 && depths[first - 1] - depths[first] > 0.8)
+      i = first; // 记录障碍物左侧边缘的角度
   }
 
-  if(fabs(angle) > M_PI/6 && lidar_depths[i] > 0.8){
+  if(fabs(angle) > M_PI/6 && (i == -1 || depths[i] > 0.8)){
     Go2Point(target_point);
     return;
   }
@@ -264,13 +217,13 @@ void Walk::Go2PointBug0(Point target_point){
   if (i != -1)
   {
     // cout << "障碍物角度: " << i << endl;
-    // cout<<"障碍物深度: "<<lidar_depths[i]<<endl;
+    // cout<<"障碍物深度: "<<depths[i]<<endl;
     // cout<<"yaw: "<<now_yaw<<endl;
     
     // cout<<"x: "<<x<<" y: "<<y<<endl;
     // 2. 计算障碍物的边缘点的坐标
-    float x_obstacle = x + lidar_depths[i] * sin(i * M_PI / 180 + now_yaw);
-    float y_obstacle = y + lidar_depths[i] * cos(i * M_PI / 180 + now_yaw);
+    float x_obstacle = mScan->pointX(i);
+    float y_obstacle = mScan->pointY(i);
 
 
     // cout<<"目标角度:"<<theta_target<<endl;
@@ -350,6 +303,12 @@ void Walk::Go2PointBug0(Point target_point){
 
 }
 
+// follows the shortest path in the map, which is repaired incrementally as the map changes
+void Walk::GoAlongPath(Point target_point) {
+  if (!mNavigator->goAlongPath(target_point.x, target_point.y))
+    Go2PointBug0(target_point);
+}
+
 void Walk::RevolveYaw(fp32 target_yaw)
 {
   if (target_yaw == NOT_REVOLVE) {
@@ -362,9 +321,12 @@ void Walk::RevolveYaw(fp32 target_yaw)
     angle += 2 * M_PI;
   mGaitManager->setXAmplitude(0.0);
   mGaitManager->setAAmplitude(0.5*angle);
+  // the next walk starts from a standing robot
+  mNavigator->resetMotion();
 }
 
 Walk::~Walk() {
+  delete mNavigator;
 }
 
 void Walk::myStep() {
@@ -381,12 +343,18 @@ void Walk::wait(int ms) {
 }
 
 
+// stops the gait and raises the right arm, the arm is lowered when the gait starts again
+void Walk::RaiseArm() {
+  mGaitManager->stop();
+  mNavigator->resetMotion();
+  mMotors[2]->setPosition(-0.68);
+  mMotors[4]->setPosition(-1.65);
+  mMotors[0]->setPosition(2.3);
+}
+
 void Walk::RaiseArmToShow(bool &isWalking){
     if (isWalking) {
-      mGaitManager->stop();
-      mMotors[2]->setPosition(-0.68);
-      mMotors[4]->setPosition(-1.65);
-      mMotors[0]->setPosition(2.3);
+      RaiseArm();
       wait(200);
     } else {
       mGaitManager->start();
@@ -411,13 +379,114 @@ void Walk::GetDistanceSensorsValues()
 
 
 void Walk::GetLidarData(){
-  lidar_depths = mLidar->getRangeImage();
+  lidar_depths = lidarRanges();
+  // filtered and converted to points at the last position, GetNowPosition() is called before
+  mNavigator->updateScan();
 
   // cout<<"Lidar Depth 90 degree: "<<lidar_depths[90]<<endl;
   // cout<<"Lidar getNumberOfLayers: "<<mLidar->getNumberOfLayers()<<endl;  // 1
   // cout<<"Lidar Depth Number: "<<sizeof(lidar_depths)/sizeof(lidar_depths[0])<<endl;
 }
 
+// integrates the last range image at the last position, GetNowPosition() and GetLidarData() are called before
+void Walk::UpdateMap() {
+  mNavigator->updateMap();
+}
+
+// The disabled devices are not sampled by the simulator. A device enabled during a step gives its first
+// values at the next step, until then it is read as invalid.
+void Walk::setSensors(int sensors) {
+  // without GPS, the position is found by matching the range images against the map
+  if ((sensors & SENSOR_POSE) && !mNavigator->usesGps())
+    sensors |= SENSOR_LIDAR;
+  const int changed = sensors ^ mSensors;
+  if (changed & SENSOR_POSE) {
+    if (sensors & SENSOR_POSE) {
+      if (mNavigator->usesGps())
+        mGPS->enable(mTimeStep);
+      mIMU->enable(mTimeStep);
+    } else {
+      mGPS->disable();
+      mIMU->disable();
+    }
+  }
+  if (changed & SENSOR_LIDAR) {
+    if (sensors & SENSOR_LIDAR)
+      mLidar->enable(mTimeStep);
+    else
+      mLidar->disable();
+  }
+  if (changed & SENSOR_DISTANCE) {
+    for (int i = 0; i < 6; i++) {
+      if (sensors & SENSOR_DISTANCE)
+        mDistanceSensors[i]->enable(mTimeStep);
+      else
+        mDistanceSensors[i]->disable();
+    }
+  }
+  mSensors = sensors;
+}
+
+double Walk::time() const {
+  return getTime();
+}
+
+float Walk::timeStep() const {
+  return mTimeStep / 1000.0f;
+}
+
+bool Walk::gpsPosition(float *x, float *y) const {
+  if (!(mSensors & SENSOR_POSE))
+    return false;
+  const double *position = mGPS->getValues();
+  *x = position[0];
+  *y = position[1];
+  return std::isfinite(position[0]) && std::isfinite(position[1]);
+}
+
+bool Walk::imuYaw(float *yaw) const {
+  if (!(mSensors & SENSOR_POSE))
+    return false;
+  *yaw = mIMU->getRollPitchYaw()[2];
+  return std::isfinite(*yaw);
+}
+
+float Walk::gyroYawRate() const {
+  return (mGyro->getValues()[GYRO_YAW_AXIS] - GYRO_CENTER) * GYRO_SCALE;
+}
+
+const float *Walk::lidarRanges() const {
+  return (mSensors & SENSOR_LIDAR) ? mLidar->getRangeImage() : NULL;
+}
+
+int Walk::lidarResolution() const {
+  return mLidar->getHorizontalResolution();
+}
+
+float Walk::lidarFieldOfView() const {
+  return mLidar->getFov();
+}
+
+float Walk::lidarMinRange() const {
+  return mLidar->getMinRange();
+}
+
+float Walk::lidarMaxRange() const {
+  return mLidar->getMaxRange();
+}
+
+void Walk::setGaitAmplitudes(float xAmplitude, float aAmplitude) {
+  mGaitManager->setXAmplitude(xAmplitude);
+  mGaitManager->setAAmplitude(aAmplitude);
+}
+
+void Walk::gaitAmplitudes(float *xAmplitude, float *yAmplitude, float *aAmplitude, bool *walking) const {
+  *xAmplitude = mGaitManager->xAmplitude();
+  *yAmplitude = mGaitManager->yAmplitude();
+  *aAmplitude = mGaitManager->aAmplitude();
+  *walking = mGaitManager->isWalking();
+}
+
 
 
 // function containing the main feedback loop
@@ -522,66 +591,323 @@ void Walk::checkIfFallen() {
 //----------Ke's code begin----------
 
 fp32 get_distance(Point current, Point target) { //未声明
-  return pow(pow(current.x-target.x, 2) + pow(current.y-target.y, 2), 0.5);
+  return hypot(current.x - target.x, current.y - target.y);
 }
 
 PathPlanning::PathPlanning() {
-  PathPlanning::robotStatu = START;
+  PathPlanning::robotStatu = IDLE;
   PathPlanning::current_step = 0;
+  state_time = 0.0;
+  hold_time = 0.0;
+  current_key = -1;
+  last_current_key = -1;
+  current_p = 0;
   PathPlanning::show_order = {};
-  key_points = {
-    {{3.2, 3.3}, NOT_REVOLVE},
-    {{6.2, 3.3}, 0.0f},
-    {{3.5, 0.3}, -M_PI/2.0f},
-    {{5.8, 0.3}, 0.0f},
-    {{5.8, -3.2}, 0.0f},
-    {{1.5, -3.2}, M_PI},
-    {{1.5, 0.3}, M_PI}
-  };
+  PathPlanning::show_order.reserve(WaypointGraph::MAX_WAYPOINTS);
+  show_steps.reserve(WaypointGraph::MAX_WAYPOINTS);
+  loadKeyPoints("config.ini");
   PathPlanning::controller = new Walk();
 }
 
 PathPlanning::PathPlanning(std::vector<int> show_order) {
-  PathPlanning::robotStatu = START;
+  PathPlanning::robotStatu = IDLE;
   PathPlanning::current_step = 0;
-  PathPlanning::show_order = show_order;
-  key_points = {
-    {{3.5, 3.3}, NOT_REVOLVE},
-    {{6.2, 3.3}, 0.0f},
-    {{3.5, 0.3}, -M_PI/2.0f},
-    {{5.8, 0.3}, 0.0f},
-    {{5.8, -3.2}, 0.0f},
-    {{1.5, -3.2}, M_PI},
-    {{1.5, 0.3}, M_PI}
-  };
+  state_time = 0.0;
+  hold_time = 0.0;
+  current_key = -1;
+  last_current_key = -1;
+  current_p = 0;
+  // the order is optimized once the position of the robot is known
+  tour_exhibits = show_order;
+  PathPlanning::show_order.reserve(WaypointGraph::MAX_WAYPOINTS);
+  show_steps.reserve(WaypointGraph::MAX_WAYPOINTS);
+  loadKeyPoints("config.ini");
   PathPlanning::controller = new Walk();
 }
 
+// key_point_<i> = x y yaw, the yaw is "none" if the robot does not have to turn to the exhibit
+// edge_<i> = a b, the robot can walk straight between the key points a and b
+void PathPlanning::loadKeyPoints(const char *filename) {
+  minIni ini(filename);
+  key_points.clear();
+  waypoints.clear();
+  for (int i = 0;; i++) {
+    char key[32];
+    sprintf(key, "key_point_%d", i);
+    const string value = ini.gets(EXHIBITION_SECTION, key);
+    PointWithYaw point;
+    char yaw[16];
+    if (sscanf(value.c_str(), "%f %f %15s", &point.p.x, &point.p.y, yaw) != 3)
+      break;
+    if (waypoints.addWaypoint(point.p.x, point.p.y) < 0) {
+      cerr << "Too many key points in " << filename << ", only the first " << WaypointGraph::MAX_WAYPOINTS
+           << " are used" << endl;
+      break;
+    }
+    point.yaw = strcmp(yaw, "none") == 0 ? NOT_REVOLVE : atof(yaw);
+    key_points.push_back(point);
+  }
+  if (key_points.empty())
+    cerr << "No key point in the [" EXHIBITION_SECTION "] section of " << filename << endl;
+
+  for (int i = 0;; i++) {
+    char key[32];
+    sprintf(key, "edge_%d", i);
+    const string value = ini.gets(EXHIBITION_SECTION, key);
+    int a, b;
+    if (sscanf(value.c_str(), "%d %d", &a, &b) != 2)
+      break;
+    if (!waypoints.addEdge(a, b))
+      cerr << "Invalid edge " << a << " " << b << " in " << filename << endl;
+  }
+  waypoints.build();
+}
+
 PathPlanning::~PathPlanning() {
   delete PathPlanning::controller;
 }
 
+// length of the way between two key points, through the corridors or else through the map
+float PathPlanning::pathCost(int from, int to) {
+  const float distance = waypoints.distance(from, to);
+  if (distance < INFINITY)
+    return distance;
+  int fromX, fromY, toX, toY;
+  float length;
+  vector<int> path;
+  if (controller->mMap->worldToCell(key_points[from].p.x, key_points[from].p.y, &fromX, &fromY) &&
+      controller->mMap->worldToCell(key_points[to].p.x, key_points[to].p.y, &toX, &toY) &&
+      controller->mPlanner->findPath(fromX, fromY, toX, toY, &path, &length))
+    return length * controller->mMap->resolution();
+  return INFINITY;
+}
+
+// appends the route between two key points to show_order, the exhibit at the end is shown
+void PathPlanning::appendRoute(int from, int to) {
+  int route[WaypointGraph::MAX_WAYPOINTS];
+  int length = waypoints.route(from, to, route, WaypointGraph::MAX_WAYPOINTS);
+  if (length == 0) {
+    // not connected to the other key points, the planner goes straight to the exhibit
+    route[0] = to;
+    length = 1;
+  }
+  for (int i = show_order.empty() ? 0 : 1; i < length; i++) {
+    show_order.push_back(route[i]);
+    show_steps.push_back(i == length - 1 && route[i] != 0);
+  }
+}
+
+// visits the exhibits of the tour from the start in the shortest order
+void PathPlanning::planTour(int start) {
+  vector<int> stops(1, start);
+  for (size_t i = 0; i < tour_exhibits.size(); i++) {
+    const int exhibit = tour_exhibits[i];
+    if (exhibit >= 0 && exhibit < int(key_points.size()) && find(stops.begin(), stops.end(), exhibit) == stops.end())
+      stops.push_back(exhibit);
+  }
+  const int n = stops.size();
+  vector<float> costs(n * n);
+  for (int i = 0; i < n; i++) {
+    for (int j = i; j < n; j++)
+      costs[i * n + j] = costs[j * n + i] = i == j ? 0.0f : pathCost(stops[i], stops[j]);
+  }
+  vector<int> order;
+  const float length = tour_optimizer.optimize(costs, n, -1, &order);
+
+  show_order.clear();
+  show_steps.clear();
+  // the start is shown only if it is one of the exhibits
+  show_order.push_back(start);
+  show_steps.push_back(start != 0 && find(tour_exhibits.begin(), tour_exhibits.end(), start) != tour_exhibits.end());
+  cout << "Tour: " << start;
+  for (int i = 1; i < n; i++) {
+    cout << " " << stops[order[i]];
+    appendRoute(stops[order[i - 1]], stops[order[i]]);
+  }
+  cout << " (" << length << " m)" << endl;
+  current_step = 0;
+}
+
+// the route to the exhibit starts at the close key point with the shortest way to it
+void PathPlanning::planRoute(int target) {
+  int candidates[ROUTE_START_CANDIDATES];
+  const int n =
+    waypoints.nearest(controller->now_position.x, controller->now_position.y, ROUTE_START_CANDIDATES, candidates);
+  float current_distance = waypoints.distance(candidates[0], target);
+  current_p = candidates[0];
+  for (int i = 1; i < n; ++i) {
+    const float distance = get_distance(controller->now_position, key_points[candidates[i]].p) -
+                           get_distance(controller->now_position, key_points[candidates[0]].p) +
+                           waypoints.distance(candidates[i], target);
+    if (distance < current_distance) {
+      current_p = candidates[i];
+      current_distance = distance;
+    }
+  }
+  // the planner finds the way between two key points of the route in the map
+  show_order.clear();
+  show_steps.clear();
+  appendRoute(current_p, target);
+  current_step = 0;
+  cout << "出发坐标: (" << key_points[current_p].p.x << "," << key_points[current_p].p.y << ")"
+       << " 目标坐标: (" << key_points[target].p.x << "," << key_points[target].p.y << ")" << endl;
+  if (target != 0)
+    cout << "正在前往展品：" << target << "号展品" << endl;
+  else
+    cout << "返回0号点位" << endl;
+}
+
+// The first row matching the state and the event is applied, ANY_STATE matches all the states. A row from
+// a state to itself ignores the event, the other rows enter the new state even if it is the current one.
+#define ANY_STATE -1
+
+static const struct {
+  int from;
+  RobotEvent_e event;
+  RobotStatu_e to;
+} transitions[] = {
+  {IDLE, EVENT_GO, START},
+  // the exhibit selected before G is walked to once G is pressed
+  {IDLE, EVENT_TARGET, IDLE},
+  {IDLE, EVENT_STOP, IDLE},
+  {ANY_STATE, EVENT_STOP, IDLE},
+  {ANY_STATE, EVENT_TARGET, START},
+  {START, EVENT_DONE, OFF},
+  {START, EVENT_STOPPED, RESUME},
+  {START, EVENT_NEXT, RUNNING},
+  {RUNNING, EVENT_ARRIVED, REVOLVE},
+  {RUNNING, EVENT_AUTO_MOVE, AUTO_MOVE},
+  {AUTO_MOVE, EVENT_MANUAL_MOVE, RUNNING},
+  {REVOLVE, EVENT_SHOW, SHOW},
+  {REVOLVE, EVENT_PASSED, START},
+  {SHOW, EVENT_TIMEOUT, RESUME},
+  {RESUME, EVENT_TIMEOUT, START},
+};
+
+// the sensors, the duration, the gait and the functions of each state
+const PathPlanning::StateDescription PathPlanning::states[] = {
+  /* START     */ {SENSOR_POSE, 0.0, true, &PathPlanning::enterStart, &PathPlanning::stepStart},
+  /* RUNNING   */ {SENSOR_POSE | SENSOR_LIDAR, 0.0, true, NULL, &PathPlanning::stepRunning},
+  // the gait manager would overwrite the raised arm, even stopped
+  /* SHOW      */ {SENSOR_NONE, GAIT_SETTLE_TIME + SHOW_TIME, false, &PathPlanning::enterShow, NULL},
+  /* OFF       */ {SENSOR_POSE, 0.0, true, &PathPlanning::enterOff, NULL},
+  /* REVOLVE   */ {SENSOR_POSE, 0.0, true, NULL, &PathPlanning::stepRevolve},
+  /* AUTO_MOVE */ {SENSOR_POSE | SENSOR_LIDAR, 0.0, true, NULL, &PathPlanning::stepAutoMove},
+  /* RESUME    */ {SENSOR_NONE, GAIT_SETTLE_TIME, true, &PathPlanning::enterResume, NULL},
+  /* IDLE      */ {SENSOR_POSE, 0.0, true, &PathPlanning::enterIdle, NULL},
+};
+
+void PathPlanning::setState(RobotStatu_e statu) {
+  robotStatu = statu;
+  state_time = controller->getTime();
+  controller->setSensors(states[statu].sensors);
+  if (states[statu].enter)
+    (this->*states[statu].enter)();
+}
+
+void PathPlanning::handleEvent(RobotEvent_e event) {
+  for (size_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++) {
+    if (transitions[i].event == event && (transitions[i].from == robotStatu || transitions[i].from == ANY_STATE)) {
+      if (transitions[i].to != transitions[i].from)
+        setState(transitions[i].to);
+      return;
+    }
+  }
+}
+
+void PathPlanning::enterStart() {
+  if (current_key != -1 && current_key != last_current_key) {
+    planRoute(current_key);
+    last_current_key = current_key;
+  }
+  current_key = -1;
+}
+
+RobotEvent_e PathPlanning::stepStart() {
+  if (current_step >= int(show_order.size()))
+    return EVENT_DONE;
+  if (!controller->mGaitManager->isWalking())
+    return EVENT_STOPPED;
+  return EVENT_NEXT;
+}
+
+RobotEvent_e PathPlanning::stepRunning() {
+  if (isAutoMove())
+    return EVENT_AUTO_MOVE;
+  const Point &target = key_points[show_order[current_step]].p;
+  if (get_distance(controller->now_position, target) < KEY_POINT_TOLERANCE)
+    return EVENT_ARRIVED;
+  controller->GoAlongPath(target);
+  return EVENT_NONE;
+}
+
+RobotEvent_e PathPlanning::stepAutoMove() {
+  return isAutoMove() ? EVENT_NONE : EVENT_MANUAL_MOVE;
+}
+
+RobotEvent_e PathPlanning::stepRevolve() {
+  const PointWithYaw &point = key_points[show_order[current_step]];
+  if (show_steps[current_step] && point.yaw != NOT_REVOLVE &&
+      fabs(remainder(controller->now_yaw - point.yaw, 2 * M_PI)) >= YAW_TOLERANCE) {
+    controller->RevolveYaw(point.yaw);
+    return EVENT_NONE;
+  }
+  if (show_steps[current_step])
+    return EVENT_SHOW;
+  current_step++;
+  return EVENT_PASSED;
+}
+
+void PathPlanning::enterShow() {
+  controller->RaiseArm();
+  current_step++;
+}
+
+void PathPlanning::enterResume() {
+  controller->mGaitManager->start();
+}
+
+void PathPlanning::enterOff() {
+  if (!show_order.empty() && current_step >= int(show_order.size()))
+    cout << "已到达" << show_order.back() << "号展品" << endl;
+  cout << "请选择目标展品" << endl;
+}
+
+void PathPlanning::enterIdle() {
+  cout << "请按G键开启导航" << endl;
+}
+
+// Each step, the sensors of the current state are read, the keys are converted to events, then the state
+// either times out or its step function chooses the gait amplitudes and may raise an event.
 void PathPlanning::showInOrder() {
   cout << "Press the space bar to start/stop walking" << endl;
-  cout << "Use the arrow keys to move the robot while walking" << endl;
+  cout << "Press G to start the navigation, S to stop it, and a digit to choose the exhibit" << endl;
 
   // First step to update sensors values
   controller->myStep();
+  if (!tour_exhibits.empty() && !key_points.empty()) {
+    controller->GetNowPosition();
+    int start;
+    waypoints.nearest(controller->now_position.x, controller->now_position.y, 1, &start);
+    planTour(start);
+  }
   // play the hello motion
   controller->mMotionManager->playPage(9);  // init position
   controller->wait(200);
-  // main loop
-  bool isWalking = true;
+  setState(robotStatu);
 
-  bool isWorking = false;
-  int current_key = -1;
-  int last_current_key = -1;
-  int current_p = 0;
+  // main loop
   while (true) {
     controller->checkIfFallen();
-    controller->GetNowPosition();
-    controller->GetDistanceSensorsValues();
-    controller->GetLidarData();
+    const int sensors = states[robotStatu].sensors;
+    if (sensors & SENSOR_POSE)
+      controller->GetNowPosition();
+    if (sensors & SENSOR_LIDAR) {
+      controller->GetLidarData();
+      controller->UpdateMap();
+    }
+    if (sensors & SENSOR_DISTANCE)
+      controller->GetDistanceSensorsValues();
     controller->mGaitManager->setXAmplitude(0.0);
     controller->mGaitManager->setAAmplitude(0.0);
 
@@ -590,190 +916,43 @@ void PathPlanning::showInOrder() {
     while ((key = controller->mKeyboard->getKey()) >= 0) {
       switch (key) {
         case ' ':  // Space bar
-          // cout << "keyboard  " << endl;
-          if (isWalking) {
+          if (controller->mGaitManager->isWalking())
             controller->mGaitManager->stop();
-            isWalking = false;
-            controller->wait(200);
-          } else {
+          else
             controller->mGaitManager->start();
-            isWalking = true;
-            controller->wait(200);
-          }
+          hold_time = controller->getTime() + GAIT_SETTLE_TIME;
           break;
         case 'G':
-          isWorking = true;
+          handleEvent(EVENT_GO);
           break;
         case 'S':
-          isWorking = false;
-          break;
-        case '0':
-          current_key = 0;
-          break;
-        case '1':
-          current_key = 1;
-          break;
-        case '2':
-          current_key = 2;
-          break;
-        case '3':
-          current_key = 3;
-          break;
-        case '4':
-          current_key = 4;
-          break;
-        case '5':
-          current_key = 5;
-          break;
-        case '6':
-          current_key = 6;
-          break;
-        // case 'T':
-        //   current_key = 10;
+          handleEvent(EVENT_STOP);
           break;
         default:
+          if (key >= '0' && key <= '9' && key - '0' < int(key_points.size())) {
+            current_key = key - '0';
+            handleEvent(EVENT_TARGET);
+          }
           break;
       }
     }
-    if (controller->mKeyboard->getKey() == -1)  //没有键盘键入
-    {
-      // cout<<"current_key: "<<current_key<<endl;
-      // cout<<"current_p: "<<current_p<<endl;
-      if (isWorking) 
-      {
-        if (current_key != last_current_key || current_key == -1) 
-        {
-          int current_point = 0;
-          float current_distance = 1000.0f;
-          for (int i = 0; i <= 6; ++i) {
-            if (get_distance(controller->now_position, key_points[i].p) < current_distance) {
-              current_point = i;
-              current_p = i;
-              current_distance = get_distance(controller->now_position, key_points[i].p);
-            }
-          }
-          vector<int> show_order = getShowOrder(current_point, current_key);
-          // controller->wait(200);
-
-          // for (int i: show_order) {
-          //   cout << i << " ";
-          // }
-          // cout << endl;
-
-          if (!show_order.empty()) 
-          {
-            PathPlanning::show_order = show_order;
-            PathPlanning::robotStatu = START;
-            current_step = 0;
-          }
-          last_current_key = current_key;
-          current_key = -1;
-        }
-        // cout << "keyboard g" << endl;
-        switch (PathPlanning::robotStatu)
-        {
-        case RobotStatu_e::START:
-          if (current_step < int(show_order.size())) {
-            PathPlanning::robotStatu = RobotStatu_e::RUNNING;
-          }
-          else {
-            PathPlanning::robotStatu = RobotStatu_e::OFF;
-          }
-          break;
-        case RobotStatu_e::RUNNING:
-          // cout << "RUNNING" << endl;
-          controller->GetNowPosition();
-          if (get_distance(controller->now_position, key_points[show_order[current_step]].p) < 0.2) {
-            PathPlanning::robotStatu = RobotStatu_e::REVOLVE;
-          }
-          else {
-            controller->Go2PointBug0(key_points[show_order[current_step]].p);
-          }
-          if (isAutoMove()) {
-            PathPlanning::robotStatu = RobotStatu_e::AUTO_MOVE;
-          }
-          break;
-
-        case RobotStatu_e::AUTO_MOVE:
-          if (!isAutoMove()) {
-            PathPlanning::robotStatu = RobotStatu_e::RUNNING;
-          }
-          break;
-
-        case RobotStatu_e::REVOLVE:
-          if ((fabs(controller->now_yaw - key_points[show_order[current_step]].yaw) < 0.1 || fabs(fabs(controller->now_yaw - key_points[show_order[current_step]].yaw) - 2*M_PI)  < 0.1 ) || key_points[show_order[current_step]].yaw == NOT_REVOLVE || current_step != show_order.size() - 1) {
-            if ((current_step == show_order.size() - 1) && show_order[current_step] != 0) {
-              PathPlanning::robotStatu = RobotStatu_e::SHOW;
-            }
-            
-            else {
-              if (show_order[current_step] != 0) {
-                current_step++;
-                PathPlanning::robotStatu = RobotStatu_e::START;
-              }
-              else {
-                current_step++;
-                PathPlanning::robotStatu = RobotStatu_e::START;
-              }       
-            }
 
-          }
-          else {
-            controller->RevolveYaw(key_points[show_order[current_step]].yaw);
-          }
-          break;
-        case RobotStatu_e::SHOW:
-            // cout << "SHOW" << endl;
-            controller->RaiseArmToShow(isWalking);
-            current_step++;
-            PathPlanning::robotStatu = RobotStatu_e::START;
-            controller->wait(1000);
-            controller->mGaitManager->start();
-            isWalking = true;
-            controller->wait(200);
-          break;
-        case RobotStatu_e::OFF:
-          break;
-        default:
-          break;
-        }
+    const double time = controller->getTime();
+    if (time >= hold_time) {
+      const StateDescription &state = states[robotStatu];
+      if (state.duration > 0.0 && time - state_time >= state.duration)
+        handleEvent(EVENT_TIMEOUT);
+      else if (state.step) {
+        const RobotEvent_e event = (this->*state.step)();
+        if (event != EVENT_NONE)
+          handleEvent(event);
       }
     }
-    controller->mGaitManager->step(controller->mTimeStep);
+    if (states[robotStatu].gait)
+      controller->mGaitManager->step(controller->mTimeStep);
 
     // step
     controller->myStep();
-    
-    if (isWorking) {
-      if (current_key != -1) {
-        if ((current_step >= show_order.size() - 1) && PathPlanning::robotStatu == RobotStatu_e::OFF) {
-          cout << "已到达" << show_order[show_order.size()-1] << "号展品"<< endl;
-        }
-        else {
-        cout << "出发坐标: (" << key_points[current_p].p.x << "," << key_points[current_p].p.y << ")" << 
-        " 目标坐标: (" << key_points[current_key].p.x << "," << key_points[current_key].p.y << ")" << endl;
-        }
-        if (show_order[show_order.size()-1] != 0) {
-          cout << "正在前往展品："<<show_order[show_order.size()-1] << "号展品" <<endl;
-        }
-        else {
-          cout << "返回0号点位"<< endl;
-        }
-      }
-      else if (current_key == -1) {
-        cout << "请选择目标展品" << endl;
-      }
-
-    }
-    else {
-      cout << "请按G键开启导航" << endl;
-    }
-
-
-
-
   }
-
-
 }
 //----------Ke's code end----------
\ No newline at end of file
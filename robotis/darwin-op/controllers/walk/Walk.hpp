@@ -22,6 +22,11 @@
 
 #include <webots/Robot.hpp>
 
+#include "Navigator.hpp"
+#include "RobotInterface.hpp"
+#include "TourOptimizer.hpp"
+#include "WaypointGraph.hpp"
+
 namespace managers {
   class RobotisOp2MotionManager;
   class RobotisOp2GaitManager;
@@ -78,36 +83,83 @@ typedef enum {
   OFF=3, //取消启动
   REVOLVE=4, //旋转时
   AUTO_MOVE=5, //自动移动
+  RESUME=6, //展示后重新启动步态
+  IDLE=7, //等待G键开启导航
 }RobotStatu_e;
 
+// 状态机的事件，状态转移表见 Walk.cpp
+typedef enum {
+  EVENT_NONE=0,
+  EVENT_GO, //G键
+  EVENT_STOP, //S键
+  EVENT_TARGET, //数字键，选择新的目标展品
+  EVENT_NEXT, //还有未到达的点位
+  EVENT_DONE, //所有点位都已到达
+  EVENT_STOPPED, //步态已停止
+  EVENT_ARRIVED, //到达点位
+  EVENT_PASSED, //点位不需要展示
+  EVENT_SHOW, //点位需要展示
+  EVENT_AUTO_MOVE, //开始自动移动
+  EVENT_MANUAL_MOVE, //结束自动移动
+  EVENT_TIMEOUT, //状态的计时结束
+}RobotEvent_e;
+
+// sensors read in a state, Walk::setSensors() enables only these devices
+typedef enum {
+  SENSOR_NONE=0,
+  SENSOR_POSE=1, // GPS and IMU, or the Lidar for the scan matcher without GPS
+  SENSOR_LIDAR=2,
+  SENSOR_DISTANCE=4,
+}SensorMask_e;
+
 
 
 
 //----------Ke's code end----------
 
-class Walk : public webots::Robot {
+class Walk : public webots::Robot, public RobotInterface {
 public:
   Walk();
   virtual ~Walk();
   void run();
   void checkIfFallen();
   void RaiseArmToShow(bool &isWalking);
+  void RaiseArm();
   void Go2Point(Point target_point);
   void RevolveYaw(fp32 target_yaw);
   void GetNowPosition();
   void GetLidarData();
+  void UpdateMap();
 
   void Go2PointBug0(Point target_point);
+  void GoAlongPath(Point target_point);
 
   void GetDistanceSensorsValues();
+  // enables the devices of the mask of SensorMask_e and disables the others
+  void setSensors(int sensors);
   int mTimeStep;
 
+  // RobotInterface
+  virtual double time() const;
+  virtual float timeStep() const;
+  virtual bool gpsPosition(float *x, float *y) const;
+  virtual bool imuYaw(float *yaw) const;
+  virtual float gyroYawRate() const;
+  virtual const float *lidarRanges() const;
+  virtual int lidarResolution() const;
+  virtual float lidarFieldOfView() const;
+  virtual float lidarMinRange() const;
+  virtual float lidarMaxRange() const;
+  virtual void setGaitAmplitudes(float xAmplitude, float aAmplitude);
+  virtual void gaitAmplitudes(float *xAmplitude, float *yAmplitude, float *aAmplitude, bool *walking) const;
+
   void myStep();
   void wait(int ms);
 
   webots::Motor *mMotors[NMOTORS];
   webots::PositionSensor *mPositionSensors[NMOTORS];
   webots::Accelerometer *mAccelerometer;
+  webots::Gyro *mGyro;
   webots::GPS *mGPS;
   webots::InertialUnit *mIMU;
   webots::Keyboard *mKeyboard;
@@ -116,21 +168,75 @@ public:
   managers::RobotisOp2MotionManager *mMotionManager;
   managers::RobotisOp2GaitManager *mGaitManager;
 
+  // filtered pose, updated once per time step by GetNowPosition()
   Point now_position;
   float now_yaw;
   const float *lidar_depths;
   float distance_sensors_values[6];
+  // SensorMask_e of the enabled devices
+  int mSensors;
+  // localization, mapping and planning
+  Navigator *mNavigator;
+  // features of the last range image, owned by mNavigator
+  const ScanProcessor *mScan;
+  // obstacles seen by the Lidar since the start, in the frame of the GPS, owned by mNavigator
+  OccupancyGrid *mMap;
+  GridPlanner *mPlanner;
 };
 
 //----------Ke's code begin----------
 
 class PathPlanning {
 private:
+  // one row per state of RobotStatu_e, in the same order
+  struct StateDescription {
+    int sensors;  // SensorMask_e, the devices read in the state
+    double duration;  // s, EVENT_TIMEOUT after this time in the state, 0 for none
+    bool gait;  // the gait manager drives the body joints, else they keep the positions set by the state
+    void (PathPlanning::*enter)();
+    RobotEvent_e (PathPlanning::*step)();
+  };
+  static const StateDescription states[];
+
   RobotStatu_e robotStatu;
   int current_step;
   Walk *controller;
+  // time when the state was entered
+  double state_time;
+  // the states wait until this time while the gait starts or stops
+  double hold_time;
+  // exhibit selected on the keyboard, -1 if none, and the last one walked to
+  int current_key;
+  int last_current_key;
+  // key point where the route to the last exhibit starts
+  int current_p;
 
   std::vector<PointWithYaw> key_points;
+  // the key points connected by the corridors of the exhibition
+  WaypointGraph waypoints;
+  // exhibits to visit after the start, in the order chosen by the tour optimizer
+  std::vector<int> tour_exhibits;
+  TourOptimizer tour_optimizer;
+  // whether the exhibit is shown at each step of show_order, the other steps are only walked through
+  std::vector<bool> show_steps;
+
+  void loadKeyPoints(const char *filename);
+  float pathCost(int from, int to);
+  void appendRoute(int from, int to);
+  void planTour(int start);
+  void planRoute(int target);
+
+  void setState(RobotStatu_e statu);
+  void handleEvent(RobotEvent_e event);
+  void enterStart();
+  RobotEvent_e stepStart();
+  RobotEvent_e stepRunning();
+  void enterShow();
+  void enterOff();
+  RobotEvent_e stepRevolve();
+  RobotEvent_e stepAutoMove();
+  void enterResume();
+  void enterIdle();
 
 public:
   PathPlanning();
@@ -0,0 +1,181 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "WaypointGraph.hpp"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+static const float cInfinity = numeric_limits<float>::infinity();
+static const unsigned char cNoWaypoint = 0xFF;
+// average number of waypoints in a bucket
+static const int cWaypointsPerBucket = 2;
+
+WaypointGraph::WaypointGraph() {
+  clear();
+}
+
+WaypointGraph::~WaypointGraph() {
+}
+
+void WaypointGraph::clear() {
+  mCount = 0;
+  mBucketMinX = 0.0f;
+  mBucketMinY = 0.0f;
+  mBucketSize = 1.0f;
+  mBucketsX = 0;
+  mBucketsY = 0;
+  mBucketStarts.clear();
+  mBucketWaypoints.clear();
+  for (int i = 0; i < MAX_WAYPOINTS * MAX_WAYPOINTS; i++) {
+    mDistances[i] = cInfinity;
+    mNext[i] = cNoWaypoint;
+  }
+}
+
+int WaypointGraph::addWaypoint(float x, float y) {
+  if (mCount >= MAX_WAYPOINTS)
+    return -1;
+  mX[mCount] = x;
+  mY[mCount] = y;
+  mDistances[mCount * MAX_WAYPOINTS + mCount] = 0.0f;
+  mNext[mCount * MAX_WAYPOINTS + mCount] = mCount;
+  return mCount++;
+}
+
+bool WaypointGraph::addEdge(int a, int b) {
+  if (a < 0 || b < 0 || a >= mCount || b >= mCount || a == b)
+    return false;
+  const float length = hypot(mX[a] - mX[b], mY[a] - mY[b]);
+  mDistances[a * MAX_WAYPOINTS + b] = length;
+  mDistances[b * MAX_WAYPOINTS + a] = length;
+  mNext[a * MAX_WAYPOINTS + b] = b;
+  mNext[b * MAX_WAYPOINTS + a] = a;
+  return true;
+}
+
+void WaypointGraph::build() {
+  // Floyd-Warshall, the next waypoint towards j through k is the next one towards k
+  for (int k = 0; k < mCount; k++) {
+    const float *rowK = &mDistances[k * MAX_WAYPOINTS];
+    for (int i = 0; i < mCount; i++) {
+      float *rowI = &mDistances[i * MAX_WAYPOINTS];
+      const float ik = rowI[k];
+      if (ik == cInfinity)
+        continue;
+      unsigned char *nextI = &mNext[i * MAX_WAYPOINTS];
+      for (int j = 0; j < mCount; j++) {
+        if (ik + rowK[j] < rowI[j]) {
+          rowI[j] = ik + rowK[j];
+          nextI[j] = nextI[k];
+        }
+      }
+    }
+  }
+
+  // square buckets over the bounding box of the waypoints
+  if (mCount == 0)
+    return;
+  float maxX = mX[0], maxY = mY[0];
+  mBucketMinX = mX[0];
+  mBucketMinY = mY[0];
+  for (int i = 1; i < mCount; i++) {
+    mBucketMinX = mX[i] < mBucketMinX ? mX[i] : mBucketMinX;
+    mBucketMinY = mY[i] < mBucketMinY ? mY[i] : mBucketMinY;
+    maxX = mX[i] > maxX ? mX[i] : maxX;
+    maxY = mY[i] > maxY ? mY[i] : maxY;
+  }
+  const float area = (maxX - mBucketMinX + 1.0f) * (maxY - mBucketMinY + 1.0f);
+  mBucketSize = sqrt(area * cWaypointsPerBucket / mCount);
+  mBucketsX = (int)((maxX - mBucketMinX) / mBucketSize) + 1;
+  mBucketsY = (int)((maxY - mBucketMinY) / mBucketSize) + 1;
+
+  // counting sort of the waypoints by bucket
+  mBucketStarts.assign(mBucketsX * mBucketsY + 1, 0);
+  mBucketWaypoints.resize(mCount);
+  int buckets[MAX_WAYPOINTS];
+  for (int i = 0; i < mCount; i++) {
+    buckets[i] = bucket((int)((mX[i] - mBucketMinX) / mBucketSize), (int)((mY[i] - mBucketMinY) / mBucketSize));
+    mBucketStarts[buckets[i] + 1]++;
+  }
+  for (int b = 0; b < mBucketsX * mBucketsY; b++)
+    mBucketStarts[b + 1] += mBucketStarts[b];
+  vector<int> positions(mBucketStarts.begin(), mBucketStarts.end() - 1);
+  for (int i = 0; i < mCount; i++)
+    mBucketWaypoints[positions[buckets[i]]++] = i;
+}
+
+int WaypointGraph::route(int from, int to, int *waypoints, int maxLength) const {
+  if (from < 0 || to < 0 || from >= mCount || to >= mCount || mNext[from * MAX_WAYPOINTS + to] == cNoWaypoint)
+    return 0;
+  int length = 0;
+  for (int i = from;; i = mNext[i * MAX_WAYPOINTS + to]) {
+    if (length >= maxLength)
+      return 0;
+    waypoints[length++] = i;
+    if (i == to)
+      return length;
+  }
+}
+
+int WaypointGraph::nearest(float x, float y, int k, int *waypoints) const {
+  if (k > mCount)
+    k = mCount;
+  if (k <= 0)
+    return 0;
+
+  // the bucket of the position, or the closest one if the position is outside of the buckets
+  int bx = (int)floor((x - mBucketMinX) / mBucketSize);
+  int by = (int)floor((y - mBucketMinY) / mBucketSize);
+  bx = bx < 0 ? 0 : bx >= mBucketsX ? mBucketsX - 1 : bx;
+  by = by < 0 ? 0 : by >= mBucketsY ? mBucketsY - 1 : by;
+
+  // rings of buckets around it, the waypoints of the ring r are at least (r - 1) buckets away
+  float distances[MAX_WAYPOINTS];
+  int found = 0;
+  const int maxRing = mBucketsX > mBucketsY ? mBucketsX : mBucketsY;
+  for (int r = 0; r <= maxRing; r++) {
+    if (found == k && (r - 1) * mBucketSize > distances[k - 1])
+      break;
+    for (int cy = by - r; cy <= by + r; cy++) {
+      if (cy < 0 || cy >= mBucketsY)
+        continue;
+      // the whole rows at the top and bottom of the ring, only the two ends of the other ones
+      const int step = (cy == by - r || cy == by + r) ? 1 : 2 * r;
+      for (int cx = bx - r; cx <= bx + r; cx += step > 0 ? step : 1) {
+        if (cx < 0 || cx >= mBucketsX)
+          continue;
+        const int b = bucket(cx, cy);
+        for (int j = mBucketStarts[b]; j < mBucketStarts[b + 1]; j++) {
+          const int w = mBucketWaypoints[j];
+          const float d = hypot(mX[w] - x, mY[w] - y);
+          if (found == k && d >= distances[k - 1])
+            continue;
+          // insertion in the sorted list of the k closest ones
+          int position = found < k ? found++ : k - 1;
+          while (position > 0 && distances[position - 1] > d) {
+            distances[position] = distances[position - 1];
+            waypoints[position] = waypoints[position - 1];
+            position--;
+          }
+          distances[position] = d;
+          waypoints[position] = w;
+        }
+      }
+    }
+  }
+  return found;
+}
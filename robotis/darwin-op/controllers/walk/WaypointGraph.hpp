@@ -0,0 +1,71 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Graph of the waypoints of the exhibition with its shortest
+//                routes precomputed
+
+#ifndef WAYPOINT_GRAPH_HPP
+#define WAYPOINT_GRAPH_HPP
+
+#include <vector>
+
+// The edges are the corridors known to be free between two waypoints, their length is the straight
+// distance. build() computes the shortest routes between all the pairs (Floyd-Warshall) into a table
+// of the next waypoint to go to, and a grid of buckets to find the waypoints close to a position.
+// The queries do not allocate memory, route() answers in the length of the route.
+class WaypointGraph {
+public:
+  enum { MAX_WAYPOINTS = 64 };
+
+  WaypointGraph();
+  virtual ~WaypointGraph();
+
+  void clear();
+  // index of the new waypoint, -1 if there are already MAX_WAYPOINTS
+  int addWaypoint(float x, float y);
+  bool addEdge(int a, int b);
+  // to be called after the last waypoint and edge were added
+  void build();
+
+  int size() const { return mCount; }
+  float x(int i) const { return mX[i]; }
+  float y(int i) const { return mY[i]; }
+  // length of the shortest route, infinite if the waypoints are not connected
+  float distance(int from, int to) const { return mDistances[from * MAX_WAYPOINTS + to]; }
+  // Writes the waypoints of the shortest route, from and to included, and returns their number,
+  // 0 if the waypoints are not connected or if the route is longer than maxLength.
+  int route(int from, int to, int *waypoints, int maxLength) const;
+  // Writes the indices of the k waypoints closest to the position, the closest first, and returns
+  // their number (less than k if there are less waypoints).
+  int nearest(float x, float y, int k, int *waypoints) const;
+
+private:
+  int bucket(int bx, int by) const { return by * mBucketsX + bx; }
+
+  int mCount;
+  float mX[MAX_WAYPOINTS];
+  float mY[MAX_WAYPOINTS];
+  float mDistances[MAX_WAYPOINTS * MAX_WAYPOINTS];
+  // next waypoint from the row to the column
+  unsigned char mNext[MAX_WAYPOINTS * MAX_WAYPOINTS];
+
+  // waypoints sorted by bucket, those of bucket b are from mBucketStarts[b] to mBucketStarts[b + 1]
+  float mBucketMinX, mBucketMinY;
+  float mBucketSize;
+  int mBucketsX, mBucketsY;
+  std::vector<int> mBucketStarts;
+  std::vector<unsigned char> mBucketWaypoints;
+};
+
+#endif
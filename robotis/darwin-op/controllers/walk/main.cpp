@@ -14,13 +14,37 @@
 
 // Description:   Manage the entree point function
 
+#include "NavigationSimulator.hpp"
 #include "Walk.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <thread>
 
 using namespace webots;
 
+// walk --simulate [episodes] [threads] evaluates the navigation without Webots, then replays the
+// episodes which revealed bugs and fails if one of them does not reach the goal
+static int simulate(int argc, char **argv) {
+  const int episodes = argc > 2 ? atoi(argv[2]) : 100;
+  const int threads = argc > 3 ? atoi(argv[3]) : std::max(1, (int)std::thread::hardware_concurrency());
+  NavigationSimulator simulator("config.ini");
+  const SimulationStatistics statistics = simulator.run(episodes, threads, 0);
+  printf("episodes: %d, successes: %d, collisions: %d, timeouts: %d\n", statistics.episodes, statistics.successes,
+         statistics.collisions, statistics.timeouts);
+  printf("mean time to goal: %.1f s, simulated: %.0f s in %.1f s (%.0f episodes/s)\n", statistics.meanTimeToGoal,
+         statistics.simulatedTime, statistics.wallTime, statistics.episodes / statistics.wallTime);
+  const std::vector<unsigned int> failures = simulator.checkRegressions(threads);
+  for (size_t i = 0; i < failures.size(); i++)
+    printf("regression: episode %u does not reach the goal\n", failures[i]);
+  return failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--simulate") == 0)
+    return simulate(argc, argv);
   PathPlanning *task = new PathPlanning({0, 1, 0, 2, 3, 4, 5, 6});
   task->showInOrder();
   delete task;
@@ -26,6 +26,7 @@
 namespace webots {
   class Robot;
   class Motor;
+  class Gyro;
 }  // namespace webots
 
 namespace Robot {
@@ -45,6 +46,11 @@ namespace managers {
     void setAAmplitude(double a) { mAAmplitude = DGM_BOUND(a, -1.0, 1.0) * 50.0; }
     void setMoveAimOn(bool q) { mMoveAimOn = q; }
     void setBalanceEnable(bool q) { mBalanceEnable = q; }
+    // last amplitudes set, in [-1, 1]
+    double xAmplitude() const { return mXAmplitude / 20.0; }
+    double yAmplitude() const { return mYAmplitude / 40.0; }
+    double aAmplitude() const { return mAAmplitude / 50.0; }
+    bool isWalking() const { return mIsWalking; }
 
     void start();
     void step(int duration);
@@ -64,8 +70,8 @@ namespace managers {
 
 #ifndef CROSSCOMPILATION
     void myStep();
-    double valueToPosition(unsigned short value);
     webots::Motor *mMotors[DGM_NMOTORS];
+    webots::Gyro *mGyro;
 #endif
   };
 }  // namespace managers
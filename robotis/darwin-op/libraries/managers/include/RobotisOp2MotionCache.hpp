@@ -0,0 +1,84 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   LRU cache of the Robotis motion pages expanded into
+//                joint trajectories (in radians) at the controller time step
+
+#ifndef ROBOTISOP2_MOTION_CACHE_HPP
+#define ROBOTISOP2_MOTION_CACHE_HPP
+
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#define DMC_NMOTORS 20
+
+namespace Robot {
+  class Action;
+}
+
+namespace managers {
+  using namespace Robot;
+
+  // One motion page expanded at a given time step.
+  // Key step j is reached in frameCounts[j] frames stored contiguously from
+  // frames[firstFrames[j] * DMC_NMOTORS], then the motion pauses during pauses[j] ms.
+  // The frames of the first key step start from the last key step of the page
+  // (this is the case when the page is repeated); on the first repetition the
+  // caller blends from the measured posture toward targets[0] instead.
+  struct RobotisOp2MotionTrajectory {
+    int pageId;
+    int timeStep;
+    int repeat;
+    int next;
+    std::vector<int> durations;
+    std::vector<int> pauses;
+    std::vector<int> frameCounts;
+    std::vector<int> firstFrames;
+    std::vector<double> targets;
+    std::vector<double> frames;
+
+    int stepCount() const { return (int)durations.size(); }
+    const double *target(int step) const { return &targets[step * DMC_NMOTORS]; }
+    const double *frame(int step, int index) const { return &frames[(firstFrames[step] + index) * DMC_NMOTORS]; }
+  };
+
+  class RobotisOp2MotionCache {
+  public:
+    RobotisOp2MotionCache(Action *action, const double *minPositions, const double *maxPositions, int capacity = 16);
+    virtual ~RobotisOp2MotionCache();
+
+    // returns NULL if the page cannot be loaded, the pointer is valid until the next call to get() or preload()
+    const RobotisOp2MotionTrajectory *get(int pageId, int timeStep);
+    bool preload(int pageId, int timeStep);
+    void clear();
+    int size() const { return (int)mEntries.size(); }
+
+  private:
+    typedef std::pair<int, int> Key;
+    typedef std::list<RobotisOp2MotionTrajectory> EntryList;
+
+    bool expand(int pageId, int timeStep, RobotisOp2MotionTrajectory *trajectory) const;
+
+    Action *mAction;
+    double mMinPositions[DMC_NMOTORS];
+    double mMaxPositions[DMC_NMOTORS];
+    int mCapacity;
+    EntryList mEntries;  // most recently used first
+    std::map<Key, EntryList::iterator> mIndex;
+  };
+}  // namespace managers
+
+#endif
@@ -34,12 +34,15 @@ namespace Robot {
 
 namespace managers {
   using namespace Robot;
+  class RobotisOp2MotionCache;
+  struct RobotisOp2MotionTrajectory;
   class RobotisOp2MotionManager {
   public:
     RobotisOp2MotionManager(webots::Robot *robot, const std::string &customMotionFile = "");
     virtual ~RobotisOp2MotionManager();
     bool isCorrectlyInitialized() { return mCorrectlyInitialized; }
     void playPage(int id, bool sync = true);
+    void preloadPage(int id);
     void step(int duration);
     bool isMotionPlaying() { return mMotionPlaying; }
 
@@ -54,6 +57,7 @@ namespace managers {
     void myStep();
     void wait(int duration);
     void achieveTarget(int timeToAchieveTarget);
+    void playFrames(const RobotisOp2MotionTrajectory *trajectory, int step);
     double valueToPosition(unsigned short value);
     void InitMotionAsync();
 
@@ -66,6 +70,7 @@ namespace managers {
     int mWait;
     int mStepNumberToAchieveTarget;
     void *mPage;
+    RobotisOp2MotionCache *mCache;
 #else
     static void *MotionThread(void *param);  // thread function
 
@@ -63,6 +63,7 @@ RobotisOp2GaitManager::RobotisOp2GaitManager(webots::Robot *robot, const std::st
 #ifndef CROSSCOMPILATION
   for (int i = 0; i < DGM_NMOTORS; i++)
     mMotors[i] = mRobot->getMotor(sotorNames[i]);
+  mGyro = mRobot->getGyro("Gyro");
 #endif
 
   minIni ini(iniFilename.c_str());
@@ -101,25 +102,27 @@ void RobotisOp2GaitManager::step(int step) {
 #ifndef CROSSCOMPILATION
   int numberOfStepToProcess = step / 8;
 
-  if (mBalanceEnable && (mRobot->getGyro("Gyro")->getSamplingPeriod() <= 0)) {
+  if (mBalanceEnable && (mGyro->getSamplingPeriod() <= 0)) {
     cerr << "The Gyro is not enabled. RobotisOp2GaitManager need the Gyro to run the balance algorithm. The Gyro will be "
             "automatically enabled."
          << endl;
-    mRobot->getGyro("Gyro")->enable(mBasicTimeStep);
+    mGyro->enable(mBasicTimeStep);
     myStep();
   }
 
   for (int i = 0; i < numberOfStepToProcess; i++) {
     if (mBalanceEnable) {
-      const double *gyro = mRobot->getGyro("Gyro")->getValues();
+      const double *gyro = mGyro->getValues();
       MotionStatus::RL_GYRO = gyro[0] - 512;  // 512 = central value, skip calibration step of the MotionManager,
       MotionStatus::FB_GYRO = gyro[1] - 512;  // because the influence of the calibration is imperceptible.
     }
     mWalking->Process();
   }
 
+  double positions[DGM_NMOTORS];
+  mWalking->m_Joint.GetRadians(positions);
   for (int i = 0; i < (DGM_NMOTORS - 2); i++)
-    mMotors[i]->setPosition(valueToPosition(mWalking->m_Joint.GetValue(i + 1)));
+    mMotors[i]->setPosition(positions[i]);
 #endif
 }
 
@@ -130,8 +133,10 @@ void RobotisOp2GaitManager::stop() {
     this->step(8);
 #ifdef CROSSCOMPILATION
   // Reset Goal Position of all motors (except Head) after walking //
+  double positions[DGM_NMOTORS];
+  mWalking->m_Joint.GetRadians(positions);
   for (int i = 0; i < (DGM_NMOTORS - 2); i++)
-    mRobot->getMotor(sotorNames[i])->setPosition(MX28::Value2Angle(mWalking->m_Joint.GetValue(i + 1)) * (M_PI / 180));
+    mRobot->getMotor(sotorNames[i])->setPosition(positions[i]);
 
   // Disable the Joints in the Gait Manager, this allow to control them again 'manualy' //
   mWalking->m_Joint.SetEnableBodyWithoutHead(false, true);
@@ -146,12 +151,6 @@ void RobotisOp2GaitManager::start() {
 }
 
 #ifndef CROSSCOMPILATION
-double RobotisOp2GaitManager::valueToPosition(unsigned short value) {
-  double degree = MX28::Value2Angle(value);
-  double position = degree / 180.0 * M_PI;
-  return position;
-}
-
 void RobotisOp2GaitManager::myStep() {
   int ret = mRobot->step(mBasicTimeStep);
   if (ret == -1)
@@ -0,0 +1,133 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RobotisOp2MotionCache.hpp"
+
+#include <Action.h>
+#include <MX28.h>
+
+#include <cmath>
+#include <cstring>
+
+using namespace Robot;
+using namespace managers;
+using namespace std;
+
+static double clamp(double value, double min, double max) {
+  if (min > max)
+    return value;
+  return value < min ? min : value > max ? max : value;
+}
+
+RobotisOp2MotionCache::RobotisOp2MotionCache(Action *action, const double *minPositions, const double *maxPositions,
+                                             int capacity) :
+  mAction(action),
+  mCapacity(capacity < 1 ? 1 : capacity) {
+  memcpy(mMinPositions, minPositions, sizeof(mMinPositions));
+  memcpy(mMaxPositions, maxPositions, sizeof(mMaxPositions));
+}
+
+RobotisOp2MotionCache::~RobotisOp2MotionCache() {
+}
+
+const RobotisOp2MotionTrajectory *RobotisOp2MotionCache::get(int pageId, int timeStep) {
+  map<Key, EntryList::iterator>::iterator it = mIndex.find(Key(pageId, timeStep));
+  if (it != mIndex.end()) {
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return &mEntries.front();
+  }
+
+  mEntries.push_front(RobotisOp2MotionTrajectory());
+  if (!expand(pageId, timeStep, &mEntries.front())) {
+    mEntries.pop_front();
+    return NULL;
+  }
+
+  if ((int)mEntries.size() > mCapacity) {
+    const RobotisOp2MotionTrajectory &oldest = mEntries.back();
+    mIndex.erase(Key(oldest.pageId, oldest.timeStep));
+    mEntries.pop_back();
+  }
+  mIndex[Key(pageId, timeStep)] = mEntries.begin();
+  return &mEntries.front();
+}
+
+bool RobotisOp2MotionCache::preload(int pageId, int timeStep) {
+  // follow the 'next' links so that a whole motion chain is ready, the bound protects against looping chains
+  for (int i = 0; i < Action::MAXNUM_PAGE && pageId != 0; i++) {
+    const RobotisOp2MotionTrajectory *trajectory = get(pageId, timeStep);
+    if (!trajectory)
+      return false;
+    pageId = trajectory->next;
+  }
+  return true;
+}
+
+void RobotisOp2MotionCache::clear() {
+  mIndex.clear();
+  mEntries.clear();
+}
+
+bool RobotisOp2MotionCache::expand(int pageId, int timeStep, RobotisOp2MotionTrajectory *trajectory) const {
+  if (!mAction || timeStep <= 0)
+    return false;
+
+  Action::PAGE page;
+  if (!mAction->LoadPage(pageId, &page))
+    return false;
+
+  const int stepCount = page.header.stepnum;
+  trajectory->pageId = pageId;
+  trajectory->timeStep = timeStep;
+  trajectory->repeat = page.header.repeat;
+  trajectory->next = page.header.next;
+  trajectory->durations.resize(stepCount);
+  trajectory->pauses.resize(stepCount);
+  trajectory->frameCounts.resize(stepCount);
+  trajectory->firstFrames.resize(stepCount);
+  trajectory->targets.resize(stepCount * DMC_NMOTORS);
+
+  int totalFrames = 0;
+  for (int j = 0; j < stepCount; j++) {
+    trajectory->durations[j] = 8 * page.step[j].time;
+    trajectory->pauses[j] = 8 * page.step[j].pause;
+    trajectory->frameCounts[j] = trajectory->durations[j] / timeStep;
+    trajectory->firstFrames[j] = totalFrames;
+    totalFrames += trajectory->frameCounts[j];
+    for (int k = 0; k < DMC_NMOTORS; k++)
+      trajectory->targets[j * DMC_NMOTORS + k] = MX28::Value2Angle(page.step[j].position[k + 1]) / 180.0 * M_PI;
+  }
+  trajectory->frames.resize(totalFrames * DMC_NMOTORS);
+  if (stepCount == 0)
+    return true;
+
+  // same interpolation as RobotisOp2MotionManager::achieveTarget(), chained from one key step to the next
+  double current[DMC_NMOTORS];
+  const double *last = trajectory->target(stepCount - 1);
+  for (int k = 0; k < DMC_NMOTORS; k++)
+    current[k] = clamp(last[k], mMinPositions[k], mMaxPositions[k]);
+
+  double *frame = trajectory->frames.empty() ? NULL : &trajectory->frames[0];
+  for (int j = 0; j < stepCount; j++) {
+    const double *target = trajectory->target(j);
+    for (int remaining = trajectory->frameCounts[j]; remaining > 0; remaining--) {
+      for (int k = 0; k < DMC_NMOTORS; k++) {
+        current[k] = clamp(current[k] + (target[k] - current[k]) / remaining, mMinPositions[k], mMaxPositions[k]);
+        frame[k] = current[k];
+      }
+      frame += DMC_NMOTORS;
+    }
+  }
+  return true;
+}
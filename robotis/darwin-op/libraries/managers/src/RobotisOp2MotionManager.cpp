@@ -15,6 +15,7 @@
 #include "RobotisOp2MotionManager.hpp"
 
 #include "RobotisOp2DirectoryManager.hpp"
+#include "RobotisOp2MotionCache.hpp"
 
 #include <Action.h>
 #include <MX28.h>
@@ -31,6 +32,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
@@ -80,6 +82,9 @@ RobotisOp2MotionManager::RobotisOp2MotionManager(webots::Robot *robot, const std
   mBasicTimeStep = mRobot->getBasicTimeStep();
   string filename;
   mMotionPlaying = false;
+#ifndef CROSSCOMPILATION
+  mCache = NULL;
+#endif
 
 #ifdef CROSSCOMPILATION
   RobotisOp2MotionTimerManager::MotionTimerInit();
@@ -131,12 +136,28 @@ RobotisOp2MotionManager::RobotisOp2MotionManager(webots::Robot *robot, const std
 
 #ifdef CROSSCOMPILATION
   MotionManager::GetInstance()->AddModule((MotionModule *)mAction);
+#else
+  mCache = new RobotisOp2MotionCache(mAction, minMotorPositions, maxMotorPositions);
 #endif
 }
 
 RobotisOp2MotionManager::~RobotisOp2MotionManager() {
   if (mAction && mAction->IsRunning())
     mAction->Stop();
+#ifndef CROSSCOMPILATION
+  delete mCache;
+#endif
+}
+
+void RobotisOp2MotionManager::preloadPage(int id) {
+  if (!mCorrectlyInitialized)
+    return;
+
+#ifndef CROSSCOMPILATION
+  // on the real robot the pages are interpolated by the Action module of the framework
+  if (!mCache->preload(id, mBasicTimeStep))
+    cerr << "Cannot load the page" << endl;
+#endif
 }
 
 void RobotisOp2MotionManager::playPage(int id, bool sync) {
@@ -154,9 +175,10 @@ void RobotisOp2MotionManager::playPage(int id, bool sync) {
       usleep(mBasicTimeStep * 1000);
 
     // Reset Goal Position of all motors after a motion //
-    int i;
-    for (i = 0; i < DMM_NMOTORS; i++)
-      mRobot->getMotor(motorNames[i])->setPosition(MX28::Value2Angle(mAction->m_Joint.GetValue(i + 1)) * (M_PI / 180));
+    double positions[DMM_NMOTORS];
+    mAction->m_Joint.GetRadians(positions);
+    for (int i = 0; i < DMM_NMOTORS; i++)
+      mRobot->getMotor(motorNames[i])->setPosition(positions[i]);
 
     // Disable the Joints in the Gait Manager, this allow to control them again 'manualy' //
     mAction->m_Joint.SetEnableBody(false, true);
@@ -169,19 +191,22 @@ void RobotisOp2MotionManager::playPage(int id, bool sync) {
   }
 #else
   if (sync) {
-    Action::PAGE page;
-    if (mAction->LoadPage(id, &page)) {
-      // cout << "Play motion " << setw(2) << id << ": " << page.header.name << endl;
-      for (int i = 0; i < page.header.repeat; i++) {
-        for (int j = 0; j < page.header.stepnum; j++) {
-          for (int k = 0; k < DMM_NMOTORS; k++)
-            mTargetPositions[k] = valueToPosition(page.step[j].position[k + 1]);
-          achieveTarget(8 * page.step[j].time);
-          wait(8 * page.step[j].pause);
+    const RobotisOp2MotionTrajectory *trajectory = mCache->get(id, mBasicTimeStep);
+    if (trajectory) {
+      // the first key step starts from the measured posture, the rest of the page is replayed from the cache
+      const int next = trajectory->next;
+      for (int i = 0; i < trajectory->repeat; i++) {
+        for (int j = 0; j < trajectory->stepCount(); j++) {
+          if (i == 0 && j == 0) {
+            memcpy(mTargetPositions, trajectory->target(0), sizeof(mTargetPositions));
+            achieveTarget(trajectory->durations[0]);
+          } else
+            playFrames(trajectory, j);
+          wait(trajectory->pauses[j]);
         }
       }
-      if (page.header.next != 0)
-        playPage(page.header.next);
+      if (next != 0)
+        playPage(next);
     } else
       cerr << "Cannot load the page" << endl;
   } else {
@@ -238,6 +263,15 @@ void RobotisOp2MotionManager::achieveTarget(int timeToAchieveTarget) {
   }
 }
 
+void RobotisOp2MotionManager::playFrames(const RobotisOp2MotionTrajectory *trajectory, int step) {
+  for (int f = 0; f < trajectory->frameCounts[step]; f++) {
+    memcpy(mCurrentPositions, trajectory->frame(step, f), sizeof(mCurrentPositions));
+    for (int i = 0; i < DMM_NMOTORS; i++)
+      mMotors[i]->setPosition(mCurrentPositions[i]);
+    myStep();
+  }
+}
+
 double RobotisOp2MotionManager::valueToPosition(unsigned short value) {
   double degree = MX28::Value2Angle(value);
   double position = degree / 180.0 * M_PI;
@@ -306,9 +340,10 @@ void *RobotisOp2MotionManager::MotionThread(void *param) {
     usleep(instance->mBasicTimeStep * 1000);
 
   // Reset Goal Position of all motors after a motion //
+  double positions[DMM_NMOTORS];
+  instance->mAction->m_Joint.GetRadians(positions);
   for (int i = 0; i < DMM_NMOTORS; i++)
-    instance->mRobot->getMotor(motorNames[i])
-      ->setPosition(MX28::Value2Angle(instance->mAction->m_Joint.GetValue(i + 1)) * (M_PI / 180));
+    instance->mRobot->getMotor(motorNames[i])->setPosition(positions[i]);
 
   // Disable the Joints in the Gait Manager, this allow to control them again 'manualy' //
   instance->mAction->m_Joint.SetEnableBody(false, true);
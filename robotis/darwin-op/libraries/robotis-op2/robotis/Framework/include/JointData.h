@@ -94,6 +94,20 @@ namespace Robot
 		void SetRadian(int id, double radian);
 		double GetRadian(int id);
 
+		/*bulk accessors over the joints ID 1..NUMBER_OF_JOINTS-1, the arrays are indexed by (id - 1)*/
+		void SetValues(const int *values);
+		void GetValues(int *values) const;
+		void SetRadians(const double *radians);
+		void GetRadians(double *radians) const;
+		void GetEnables(bool *enables) const;
+
+		/*copy value and gains of the joints enabled in the source*/
+		void MergeEnabled(const JointData &source);
+
+		/*MX28 value <-> radian conversion of a whole posture*/
+		static void ValuesToRadians(const int *values, double *radians, int count);
+		static void RadiansToValues(const double *radians, int *values, int count);
+
 		void SetPGain(int id, int pgain) { m_PGain[id] = pgain; }
 		int  GetPGain(int id)            { return m_PGain[id]; }
 		void SetIGain(int id, int igain) { m_IGain[id] = igain; }
@@ -199,3 +199,72 @@ double JointData::GetRadian(int id)
     return GetAngle(id) * (180.0 / 3.141592);
 }
 
+void JointData::SetValues(const int *values)
+{
+    for(int id = 1; id < NUMBER_OF_JOINTS; id++)
+    {
+        int value = values[id - 1];
+        if(value < MX28::MIN_VALUE)
+            value = MX28::MIN_VALUE;
+        else if(value >= MX28::MAX_VALUE)
+            value = MX28::MAX_VALUE;
+
+        m_Value[id] = value;
+        m_Angle[id] = MX28::Value2Angle(value);
+    }
+}
+
+void JointData::GetValues(int *values) const
+{
+    for(int id = 1; id < NUMBER_OF_JOINTS; id++)
+        values[id - 1] = m_Value[id];
+}
+
+void JointData::SetRadians(const double *radians)
+{
+    int values[NUMBER_OF_JOINTS - 1];
+    RadiansToValues(radians, values, NUMBER_OF_JOINTS - 1);
+    SetValues(values);
+}
+
+void JointData::GetRadians(double *radians) const
+{
+    ValuesToRadians(&m_Value[1], radians, NUMBER_OF_JOINTS - 1);
+}
+
+void JointData::GetEnables(bool *enables) const
+{
+    for(int id = 1; id < NUMBER_OF_JOINTS; id++)
+        enables[id - 1] = m_Enable[id];
+}
+
+void JointData::MergeEnabled(const JointData &source)
+{
+    for(int id = 1; id < NUMBER_OF_JOINTS; id++)
+    {
+        if(source.m_Enable[id] == true)
+        {
+            m_Value[id] = source.m_Value[id];
+            m_Angle[id] = MX28::Value2Angle(source.m_Value[id]);
+            m_PGain[id] = source.m_PGain[id];
+            m_IGain[id] = source.m_IGain[id];
+            m_DGain[id] = source.m_DGain[id];
+        }
+    }
+}
+
+void JointData::ValuesToRadians(const int *values, double *radians, int count)
+{
+    const double ratio = MX28::RATIO_VALUE2ANGLE * (3.14159265358979323846 / 180.0);
+    const int center = MX28::CENTER_VALUE;
+    for(int i = 0; i < count; i++)
+        radians[i] = (values[i] - center) * ratio;
+}
+
+void JointData::RadiansToValues(const double *radians, int *values, int count)
+{
+    const double ratio = MX28::RATIO_ANGLE2VALUE * (180.0 / 3.14159265358979323846);
+    const int center = MX28::CENTER_VALUE;
+    for(int i = 0; i < count; i++)
+        values[i] = (int)(radians[i] * ratio) + center;
+}
@@ -268,17 +268,7 @@ void MotionManager::Process()
             for(std::list<MotionModule*>::iterator i = m_Modules.begin(); i != m_Modules.end(); i++)
             {
                 (*i)->Process();
-                for(int id=JointData::ID_R_SHOULDER_PITCH; id<JointData::NUMBER_OF_JOINTS; id++)
-                {
-                    if((*i)->m_Joint.GetEnable(id) == true)
-                    {
-                        MotionStatus::m_CurrentJoints.SetValue(id, (*i)->m_Joint.GetValue(id));
-
-                        MotionStatus::m_CurrentJoints.SetPGain(id, (*i)->m_Joint.GetPGain(id));
-                        MotionStatus::m_CurrentJoints.SetIGain(id, (*i)->m_Joint.GetIGain(id));
-                        MotionStatus::m_CurrentJoints.SetDGain(id, (*i)->m_Joint.GetDGain(id));
-                    }
-                }
+                MotionStatus::m_CurrentJoints.MergeEnabled((*i)->m_Joint);
             }
         }
 
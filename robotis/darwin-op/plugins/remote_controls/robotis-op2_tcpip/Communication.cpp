@@ -16,6 +16,8 @@
 #include "Packet.hpp"
 #include "Time.hpp"
 
+#include <remote_protocol.hpp>
+
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -29,6 +31,8 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -36,7 +40,7 @@
 
 using namespace std;
 
-Communication::Communication() : mSocket(-1) {
+Communication::Communication() : mSocket(-1), mBytesSent(0), mBytesReceived(0) {
 #ifdef _WIN32
   // initialize the socket API
   WSADATA info;
@@ -55,6 +59,8 @@ Communication::~Communication() {
 
 bool Communication::initialize(const char *ip, int port) {
   close();
+  mBytesSent = 0;
+  mBytesReceived = 0;
   mSocket = socket(AF_INET, SOCK_STREAM, 0);
   if (mSocket == -1) {
     cerr << "Cannot create socket" << endl;
@@ -77,6 +83,9 @@ bool Communication::initialize(const char *ip, int port) {
     close();
     return false;
   }
+  // the requests are small and pipelined, they should not be delayed by the Nagle algorithm
+  int noDelay = 1;
+  setsockopt(mSocket, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(int));
   return true;
 }
 
@@ -91,6 +100,36 @@ void Communication::close() {
   mSocket = -1;
 }
 
+bool Communication::isPeerLocal() const {
+#ifdef _WIN32
+  // the server runs on Linux
+  return false;
+#else
+  if (mSocket == -1)
+    return false;
+  // connected to one of the addresses of this machine
+  struct sockaddr_in local, peer;
+  socklen_t localSize = sizeof(local);
+  socklen_t peerSize = sizeof(peer);
+  if (getsockname(mSocket, (struct sockaddr *)&local, &localSize) == -1 ||
+      getpeername(mSocket, (struct sockaddr *)&peer, &peerSize) == -1)
+    return false;
+  return local.sin_addr.s_addr == peer.sin_addr.s_addr;
+#endif
+}
+
+bool Communication::isDataAvailable() const {
+  if (mSocket == -1)
+    return false;
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET(mSocket, &readSet);
+  struct timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 0;
+  return select(mSocket + 1, &readSet, NULL, NULL, &timeout) > 0;
+}
+
 bool Communication::sendPacket(const Packet *packet) {
   if (mSocket == -1) {
     cerr << "Socket not initialized" << endl;
@@ -106,26 +145,24 @@ bool Communication::sendPacket(const Packet *packet) {
     }
     n += s;
   } while (n < size);
+  mBytesSent += size;
   return true;
 }
 
 bool Communication::receivePacket(Packet *packet) {
+  // the layout of the packet is described in remote_protocol.hpp
   unsigned char buffer[5];
   int n = 0;
-  do {  // read until the initial 'W' message
-    n = recv(mSocket, (char *)buffer, 1, 0);
-    if (n == -1) {
-      cerr << "Error received packet" << endl;
-      return false;
-    }
-  } while (buffer[0] != 'W');
-  do {  // read the message size (int)
+  do {  // read the magic byte and the message size (int)
     int r = recv(mSocket, (char *)&buffer[n], 5 - n, 0);
-    if (r == -1) {
+    if (r <= 0) {
       cerr << "Error received packet" << endl;
       return false;
     }
     n += r;
+    // resynchronize on the magic byte (older servers send an extra 0 after each reply)
+    while (n > 0 && !remote_protocol::isMagic(buffer[0]))
+      memmove(buffer, buffer + 1, --n);
   } while (n < 5);
   packet->clear();
   packet->append(buffer, 5);
@@ -134,7 +171,8 @@ bool Communication::receivePacket(Packet *packet) {
     cerr << "Too big packet about to be received" << endl;
     return false;
   }
+  mBytesReceived += packet_size;
   if (packet_size > 5)
-    packet->readFromSocket(mSocket, packet_size - 5);
+    return packet->readFromSocket(mSocket, packet_size - 5);
   return true;
 }
@@ -32,12 +32,21 @@ public:
   void close();
 
   bool isInitialized() const { return mSocket != -1; }
+  bool isDataAvailable() const;
+  // whether the server runs on this machine and may share its memory
+  bool isPeerLocal() const;
 
   bool sendPacket(const Packet *packet);
   bool receivePacket(Packet *packet);
 
+  // traffic since the connection was initialized
+  long long bytesSent() const { return mBytesSent; }
+  long long bytesReceived() const { return mBytesReceived; }
+
 private:
   int mSocket;
+  long long mBytesSent;
+  long long mBytesReceived;
 };
 
 #endif
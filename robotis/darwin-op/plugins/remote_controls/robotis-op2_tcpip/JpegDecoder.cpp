@@ -0,0 +1,145 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "JpegDecoder.hpp"
+
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JPEG_DECODER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define JPEG_DECODER_NEON
+#define STBI_NEON
+#endif
+
+#define STBI_ONLY_JPEG
+#define STBI_MALLOC(size) JpegDecoder::allocate(size)
+#define STBI_REALLOC(pointer, size) NULL  // not used by the JPEG decoder
+#define STBI_FREE(pointer) ((void)(pointer))
+#define STB_IMAGE_IMPLEMENTATION
+// some generic helpers of stb_image are not used by the JPEG decoder
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include <stb_image.h>
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+using namespace std;
+
+// alignment of the arena allocations, required by the SIMD code of stb_image
+static const size_t cAlignment = 16;
+
+JpegDecoder *JpegDecoder::cCurrent = NULL;
+
+// stb_image decodes in RGBA (with a SIMD color conversion), swap the red and blue channels in place
+static void convertRGBAToBGRA(unsigned char *image, int pixels) {
+  int i = 0;
+#if defined(JPEG_DECODER_SSE2)
+  const __m128i greenAndAlpha = _mm_set1_epi32((int)0xFF00FF00);
+  const __m128i firstByte = _mm_set1_epi32(0xFF);
+  for (; i + 4 <= pixels; i += 4) {
+    __m128i *p = (__m128i *)(image + 4 * i);
+    __m128i rgba = _mm_loadu_si128(p);
+    __m128i red = _mm_slli_epi32(_mm_and_si128(rgba, firstByte), 16);
+    __m128i blue = _mm_and_si128(_mm_srli_epi32(rgba, 16), firstByte);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(rgba, greenAndAlpha), _mm_or_si128(red, blue)));
+  }
+#elif defined(JPEG_DECODER_NEON)
+  for (; i + 16 <= pixels; i += 16) {
+    uint8x16x4_t rgba = vld4q_u8(image + 4 * i);
+    uint8x16_t red = rgba.val[0];
+    rgba.val[0] = rgba.val[2];
+    rgba.val[2] = red;
+    vst4q_u8(image + 4 * i, rgba);
+  }
+#endif
+  for (; i < pixels; i++) {
+    unsigned char red = image[4 * i];
+    image[4 * i] = image[4 * i + 2];
+    image[4 * i + 2] = red;
+  }
+}
+
+JpegDecoder::JpegDecoder() : mArena(NULL), mArenaSize(0), mArenaUsed(0), mRequiredSize(0) {
+}
+
+JpegDecoder::~JpegDecoder() {
+  mRequiredSize = 0;
+  resetArena();
+  free(mArena);
+}
+
+const unsigned char *JpegDecoder::decodeBGRA(const unsigned char *data, int length, int width, int height, int downscale) {
+  if (downscale < 1 || width % downscale != 0 || height % downscale != 0)
+    return NULL;
+  resetArena();
+  cCurrent = this;
+  int imageWidth, imageHeight, numberOfComponents;
+  unsigned char *image = stbi_load_from_memory(data, length, &imageWidth, &imageHeight, &numberOfComponents, STBI_rgb_alpha);
+  cCurrent = NULL;
+  if (!image || imageWidth != width / downscale || imageHeight != height / downscale)
+    return NULL;
+  convertRGBAToBGRA(image, imageWidth * imageHeight);
+  return downscale > 1 ? upscale(image, width, height, downscale) : image;
+}
+
+const unsigned char *JpegDecoder::upscale(const unsigned char *image, int width, int height, int downscale) {
+  mUpscaled.resize(4 * width * height);
+  const unsigned int *input = (const unsigned int *)image;
+  unsigned int *output = (unsigned int *)&mUpscaled[0];
+  const int inputWidth = width / downscale;
+  for (int y = 0; y < height; y++) {
+    const unsigned int *row = input + (y / downscale) * inputWidth;
+    for (int x = 0; x < width; x++)
+      *output++ = row[x / downscale];
+  }
+  return &mUpscaled[0];
+}
+
+void *JpegDecoder::allocate(size_t size) {
+  return cCurrent ? cCurrent->allocateFromArena(size) : NULL;
+}
+
+void JpegDecoder::resetArena() {
+  // the previous image may be in one of the overflow blocks, they are released only now
+  for (size_t i = 0; i < mOverflowBlocks.size(); i++)
+    free(mOverflowBlocks[i]);
+  mOverflowBlocks.clear();
+  if (mRequiredSize > mArenaSize) {
+    free(mArena);
+    mArena = (unsigned char *)malloc(mRequiredSize);
+    mArenaSize = mArena ? mRequiredSize : 0;
+  }
+  mArenaUsed = 0;
+  mRequiredSize = 0;
+}
+
+void *JpegDecoder::allocateFromArena(size_t size) {
+  size = (size + cAlignment - 1) & ~(cAlignment - 1);
+  mRequiredSize += size;
+  if (mArenaUsed + size <= mArenaSize) {
+    void *pointer = mArena + mArenaUsed;
+    mArenaUsed += size;
+    return pointer;
+  }
+  void *pointer = malloc(size);
+  if (pointer)
+    mOverflowBlocks.push_back(pointer);
+  return pointer;
+}
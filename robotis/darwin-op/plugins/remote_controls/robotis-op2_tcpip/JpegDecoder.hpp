@@ -0,0 +1,59 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Description:  Decodes the JPEG images received from the ROBOTIS OP2 into BGRA images
+ */
+
+#ifndef JPEG_DECODER_HPP
+#define JPEG_DECODER_HPP
+
+#include <cstddef>
+#include <vector>
+
+class JpegDecoder {
+public:
+  JpegDecoder();
+  virtual ~JpegDecoder();
+
+  // returns NULL if the image cannot be decoded or does not have the expected size,
+  // the returned image is valid until the next call
+  // a downscaled image is (width / downscale) x (height / downscale) and is enlarged to width x height
+  const unsigned char *decodeBGRA(const unsigned char *data, int length, int width, int height, int downscale = 1);
+
+  // memory allocation of stb_image, served from the arena of the decoder in use
+  static void *allocate(size_t size);
+
+private:
+  JpegDecoder(const JpegDecoder &);             // non constructor-copyable
+  JpegDecoder &operator=(const JpegDecoder &);  // non copyable
+
+  const unsigned char *upscale(const unsigned char *image, int width, int height, int downscale);
+  void resetArena();
+  void *allocateFromArena(size_t size);
+
+  static JpegDecoder *cCurrent;
+
+  // every allocation of a decoding is served from mArena, when it is too small the missing
+  // memory is allocated on the heap and the arena is enlarged before the next decoding
+  unsigned char *mArena;
+  size_t mArenaSize;
+  size_t mArenaUsed;
+  size_t mRequiredSize;
+  std::vector<void *> mOverflowBlocks;
+
+  std::vector<unsigned char> mUpscaled;
+};
+
+#endif
@@ -22,6 +22,8 @@
 #include "Device.hpp"
 #include "SingleValueSensor.hpp"
 
+#include <remote_protocol.hpp>
+
 class MotorR : public SingleValueSensor {
 public:
   // Device Manager is responsible to create/destroy devices
@@ -41,7 +43,12 @@ public:
     mAccelerationRequested(false),
     mMotorAvailableTorqueRequested(false),
     mControlPIDRequested(false),
-    mTorqueRequested(false) {}
+    mTorqueRequested(false),
+    mLastPosition(0.0),
+    mLastVelocity(0.0),
+    mHasLastPosition(false),
+    mTrajectoryNext(0),
+    mTrajectoryCount(0) {}
   virtual ~MotorR() {}
 
   bool isMotorRequested() const { return mMotorRequested; }
@@ -93,6 +100,39 @@ public:
   void resetTorqueRequested() { mTorqueRequested = false; }
   void setTorqueRequested() { mTorqueRequested = true; }
 
+  // Setpoints of the next steps already sent to the robot, in the units of the wire format. The robot
+  // plays one of them at each step unless a new position is sent (see remote_protocol.hpp).
+  void resetTrajectory() {
+    mHasLastPosition = false;
+    mLastVelocity = 0.0;
+    mTrajectoryNext = 0;
+    mTrajectoryCount = 0;
+  }
+  void setTrajectory(const int *setpoints, int count) {
+    mTrajectoryNext = 0;
+    mTrajectoryCount = count < remote_protocol::MAX_TRAJECTORY_LENGTH ? count : remote_protocol::MAX_TRAJECTORY_LENGTH;
+    for (int i = 0; i < mTrajectoryCount; i++)
+      mTrajectory[i] = setpoints[i];
+  }
+  // the setpoint played by the robot at this step if no position is sent
+  bool nextTrajectorySetpoint(int *setpoint) {
+    if (mTrajectoryNext >= mTrajectoryCount)
+      return false;
+    *setpoint = mTrajectory[mTrajectoryNext++];
+    return true;
+  }
+  int remainingTrajectorySetpoints() const { return mTrajectoryCount - mTrajectoryNext; }
+
+  // position of the previous step and its difference with the step before, whether it was sent or not
+  bool hasLastPosition() const { return mHasLastPosition; }
+  double lastPosition() const { return mLastPosition; }
+  double lastVelocity() const { return mLastVelocity; }
+  void setLastPosition(double position) {
+    mLastVelocity = mHasLastPosition ? position - mLastPosition : 0.0;
+    mLastPosition = position;
+    mHasLastPosition = true;
+  }
+
 private:
   bool mMotorRequested;
 
@@ -110,6 +150,13 @@ private:
   bool mMotorAvailableTorqueRequested;
   bool mControlPIDRequested;
   bool mTorqueRequested;
+
+  double mLastPosition;
+  double mLastVelocity;
+  bool mHasLastPosition;
+  int mTrajectory[remote_protocol::MAX_TRAJECTORY_LENGTH];
+  int mTrajectoryNext;
+  int mTrajectoryCount;
 };
 
 #endif
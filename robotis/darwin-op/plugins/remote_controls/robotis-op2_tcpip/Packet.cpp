@@ -14,6 +14,8 @@
 
 #include "Packet.hpp"
 
+#include <remote_protocol.hpp>
+
 #include <sys/types.h>
 #include <cassert>
 #include <cstring>
@@ -41,23 +43,20 @@ void Packet::append(const unsigned char *data, int size) {
   mSize += size;
 }
 
+void Packet::appendByte(int value) {
+  unsigned char c = value & 0xff;
+  append(&c, 1);
+}
+
 void Packet::appendInt(int value) {
   unsigned char array[4];
-  array[0] = (value >> 24) & 0xff;
-  array[1] = (value >> 16) & 0xff;
-  array[2] = (value >> 8) & 0xff;
-  array[3] = value & 0xff;
+  remote_protocol::writeInt(array, value);
   append(array, 4);
 }
 
 int Packet::readIntAt(int pos) const {
   assert(pos + 3 < mSize);
-  unsigned char c1 = mData[pos + 3];
-  unsigned char c2 = mData[pos + 2];
-  unsigned char c3 = mData[pos + 1];
-  unsigned char c4 = mData[pos];
-  int r = c1 + (c2 << 8) + (c3 << 16) + (c4 << 24);
-  return r;
+  return remote_protocol::readInt(&mData[pos]);
 }
 
 const unsigned char *Packet::getBufferFromPos(int pos) const {
@@ -70,10 +69,10 @@ bool Packet::readFromSocket(int socket, int n) {
   assert(n <= mMaxSize);
   do {
     int r = recv(socket, (char *)&mData[mIndex], n - mIndex, 0);
-    if (r == -1)
+    if (r <= 0)
       return false;
     mIndex += r;
   } while (mIndex < n);
-  mSize += n;
+  mSize = n;
   return true;
 }
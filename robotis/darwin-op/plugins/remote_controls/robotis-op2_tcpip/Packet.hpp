@@ -25,11 +25,15 @@ public:
   virtual ~Packet();
 
   const unsigned char *data() const { return mData; }
-  virtual void clear() { mIndex = 0; }
+  virtual void clear() {
+    mIndex = 0;
+    mSize = 0;
+  }
   int size() const { return mSize; }
   int maxSize() const { return mMaxSize; }
   void append(const unsigned char *data, int size);
   void append(const char *data, int size) { append((const unsigned char *)data, size); }
+  void appendByte(int value);
   void appendInt(int value);
   int readIntAt(int pos) const;
   const unsigned char *getBufferFromPos(int pos) const;
@@ -25,100 +25,181 @@
 
 #include <webots/remote_control.h>
 
+#include <remote_protocol.hpp>
+
 #include <cassert>
-#include <cstdlib>
 #include <iostream>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
 using namespace std;
 
-RobotisOp2InputPacket::RobotisOp2InputPacket() : Packet(300000) {
+RobotisOp2InputPacket::RobotisOp2InputPacket() :
+  Packet(remote_protocol::maxReplySize(DeviceManager::instance()->camera()->width(),
+                                       DeviceManager::instance()->camera()->height())) {
   CameraR *camera = DeviceManager::instance()->camera();
   mCameraWidth = camera->width();
   mCameraHeight = camera->height();
+  mSharedImage.resize(4 * mCameraWidth * mCameraHeight);
+  resetLastSensorValues();
 }
 
 RobotisOp2InputPacket::~RobotisOp2InputPacket() {
 }
 
+int RobotisOp2InputPacket::sequence() const {
+  // replies to pipelined requests start with 'P', the size and the sequence number of the request
+  return mData[0] == remote_protocol::PIPELINED ? readIntAt(5) : -1;
+}
+
+void RobotisOp2InputPacket::resetLastSensorValues() {
+  for (int i = 0; i < remote_protocol::NUMBER_OF_SENSOR_SLOTS; i++)
+    mLastSensorValues[i] = 0;
+}
+
 void RobotisOp2InputPacket::decode(int simulationTime, const RobotisOp2OutputPacket &outputPacket) {
   // the order of the sensors should match with RobotisOp2OutputPacket::apply()
 
-  int currentPos = 5;
+  // the layout of the packet is described in remote_protocol.hpp
+  remote_protocol::PacketReader reader(mData, mSize);
+  reader.skip(remote_protocol::replyHeaderSize(mData[0]));
+
+  // the sensor values are either sent in place or in a sensor block at the end of the packet
+  const bool deltaSensors = outputPacket.isDeltaSensorsRequested();
+  int slots[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  int values[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  int count = 0;
+
+  // with shared memory, the sensor values and the raw camera image are read from the slot given in the reply
+  bool shared = false;
+  bool sharedRead = false;
+  if (outputPacket.sharedMemoryRequest() != RobotisOp2OutputPacket::NO_SHARED_MEMORY) {
+    if (outputPacket.sharedMemoryRequest() == RobotisOp2OutputPacket::SHARED_MEMORY_HANDSHAKE) {
+      const int length = reader.readByte();
+      char name[remote_protocol::SHARED_MEMORY_NAME_SIZE];
+      for (int i = 0; i < length; i++) {
+        const char c = reader.readByte();
+        if (i < remote_protocol::SHARED_MEMORY_NAME_SIZE - 1)
+          name[i] = c;
+      }
+      name[length < remote_protocol::SHARED_MEMORY_NAME_SIZE ? length : remote_protocol::SHARED_MEMORY_NAME_SIZE - 1] = '\0';
+      if (length > 0 && !reader.overflow())
+        mSharedMemory.open(name);
+    }
+    const int slot = reader.readByte();
+    const int generation = reader.readInt();
+    shared = slot != remote_protocol::NO_SHARED_SLOT;
+    if (shared) {
+      unsigned char *image = outputPacket.isCameraRequested() ? &mSharedImage[0] : NULL;
+      sharedRead = !reader.overflow() &&
+                   mSharedMemory.read(slot, generation, mSharedSensorValues, image, mCameraWidth, mCameraHeight);
+      if (!sharedRead)
+        cerr << "Failed to read the snapshot shared by ROBOTIS OP2" << endl;
+    }
+  }
+
   // Accelerometer
   if (outputPacket.isAccelerometerRequested()) {
-    double values[3];
-    for (int i = 0; i < 3; i++) {
-      values[i] = (double)readIntAt(currentPos);
-      currentPos += 4;
-    }
-    TripleValuesSensor *accelerometer = DeviceManager::instance()->accelerometer();
-    wbr_accelerometer_set_values(accelerometer->tag(), values);
-    accelerometer->resetSensorRequested();
+    for (int i = 0; i < 3; i++)
+      slots[count++] = remote_protocol::ACCELEROMETER_SLOT + i;
   }
 
   // Gyro
   if (outputPacket.isGyroRequested()) {
-    double values[3];
-    for (int i = 0; i < 3; i++) {
-      values[i] = (double)readIntAt(currentPos);
-      currentPos += 4;
-    }
-    TripleValuesSensor *gyro = DeviceManager::instance()->gyro();
-    wbr_gyro_set_values(gyro->tag(), values);
-    gyro->resetSensorRequested();
+    for (int i = 0; i < 3; i++)
+      slots[count++] = remote_protocol::GYRO_SLOT + i;
   }
 
+  for (int i = 0; !deltaSensors && !shared && i < count; i++)
+    values[i] = reader.readInt();
+
   // Camera
-  if (outputPacket.isCameraRequested()) {
-    int image_length = readIntAt(currentPos);
-    currentPos += 4;
-
-    CameraR *camera = DeviceManager::instance()->camera();
-    unsigned char *image = readJpegImage(getBufferFromPos(currentPos), image_length);
-    // Convert RGB buffer to BGRA buffer
-    static unsigned char imageBGRA[320 * 240 * 4];
-    for (int i = 0; i < mCameraHeight; i++) {
-      for (int j = 0; j < mCameraWidth; j++) {
-        imageBGRA[i * 4 * mCameraWidth + j * 4 + 0] = image[i * 3 * mCameraWidth + j * 3 + 2];
-        imageBGRA[i * 4 * mCameraWidth + j * 4 + 1] = image[i * 3 * mCameraWidth + j * 3 + 1];
-        imageBGRA[i * 4 * mCameraWidth + j * 4 + 2] = image[i * 3 * mCameraWidth + j * 3 + 0];
-        imageBGRA[i * 4 * mCameraWidth + j * 4 + 3] = 255;
-      }
+  if (outputPacket.isCameraRequested() && shared) {
+    if (sharedRead)
+      wbr_camera_set_image(DeviceManager::instance()->camera()->tag(), &mSharedImage[0]);
+  } else if (outputPacket.isCameraRequested()) {
+    int image_length = reader.readInt();
+    // the robot may downscale or skip the images when it or the link is overloaded
+    int downscale = 1;
+    int flags = 0;
+    if (mData[0] == remote_protocol::PIPELINED) {
+      reader.skip(1);  // JPEG quality
+      downscale = reader.readByte();
+      flags = reader.readByte();
     }
-    free(image);
-    wbr_camera_set_image(camera->tag(), (const unsigned char *)imageBGRA);
-    camera->resetSensorRequested();
-    currentPos += image_length;
+    const unsigned char *jpeg = reader.current();
+    reader.skip(image_length);
+
+    if (!(flags & remote_protocol::IMAGE_SKIPPED)) {  // a skipped image keeps the previous one
+      CameraR *camera = DeviceManager::instance()->camera();
+      const unsigned char *image =
+        reader.overflow() ? NULL : mJpegDecoder.decodeBGRA(jpeg, image_length, mCameraWidth, mCameraHeight, downscale);
+      if (image)
+        wbr_camera_set_image(camera->tag(), image);
+      else
+        cerr << "Failed to decode the camera image received from ROBOTIS OP2" << endl;
+    }
+  }
+
+  // PositionSensor and motor torque feedback
+  const int first = count;
+  for (int i = 0; i < 20; i++) {
+    if (outputPacket.isPositionSensorRequested(i))
+      slots[count++] = remote_protocol::POSITION_SENSOR_SLOT + i;
+  }
+  for (int i = 0; i < 20; i++) {
+    if (outputPacket.isMotorForceFeedback(i))
+      slots[count++] = remote_protocol::TORQUE_FEEDBACK_SLOT + i;
+  }
+
+  // with shared memory, the sensor block is empty
+  if (deltaSensors)
+    remote_protocol::readSensorBlock(&reader, mLastSensorValues, slots, values, shared ? 0 : count);
+  else if (!shared) {
+    for (int i = first; i < count; i++)
+      values[i] = reader.readInt();
+  }
+
+  if (reader.overflow()) {
+    cerr << "Truncated packet received from ROBOTIS OP2" << endl;
+    return;
+  }
+  if (shared) {
+    if (!sharedRead)
+      return;
+    for (int i = 0; i < count; i++)
+      values[i] = mSharedSensorValues[slots[i]];
+  }
+
+  // apply the sensor values in the order of the slots
+  int index = 0;
+  if (outputPacket.isAccelerometerRequested()) {
+    double accelerometerValues[3];
+    for (int i = 0; i < 3; i++)
+      accelerometerValues[i] = (double)values[index++];
+    TripleValuesSensor *accelerometer = DeviceManager::instance()->accelerometer();
+    wbr_accelerometer_set_values(accelerometer->tag(), accelerometerValues);
+  }
+
+  if (outputPacket.isGyroRequested()) {
+    double gyroValues[3];
+    for (int i = 0; i < 3; i++)
+      gyroValues[i] = (double)values[index++];
+    TripleValuesSensor *gyro = DeviceManager::instance()->gyro();
+    wbr_gyro_set_values(gyro->tag(), gyroValues);
   }
 
-  // PositionSensor
   for (int i = 0; i < 20; i++) {
     if (outputPacket.isPositionSensorRequested(i)) {
-      double value = (double)readIntAt(currentPos) / 10000;
-      currentPos += 4;
+      double value = (double)values[index++] / 10000;
       SingleValueSensor *positionSensor = DeviceManager::instance()->positionSensor(i);
       wbr_position_sensor_set_value(positionSensor->tag(), value);
-      positionSensor->resetSensorRequested();
     }
   }
 
-  // Motor torque feedback
   for (int i = 0; i < 20; i++) {
     if (outputPacket.isMotorForceFeedback(i)) {
-      double value = (double)readIntAt(currentPos) / 10000;
-      currentPos += 4;
+      double value = (double)values[index++] / 10000;
       MotorR *motor = DeviceManager::instance()->motor(i);
       wbr_motor_set_torque_feedback(motor->tag(), value);
-      motor->resetSensorRequested();
     }
   }
 }
-
-//================================
-unsigned char *RobotisOp2InputPacket::readJpegImage(const unsigned char *data, unsigned int length) {
-  int width, height, number_of_components;
-  return stbi_load_from_memory(data, length, &width, &height, &number_of_components, STBI_rgb);
-}
@@ -19,7 +19,13 @@
 #ifndef ROBOTISOP2_INPUT_PACKET_HPP
 #define ROBOTISOP2_INPUT_PACKET_HPP
 
+#include "JpegDecoder.hpp"
 #include "Packet.hpp"
+#include "SharedMemory.hpp"
+
+#include <remote_protocol.hpp>
+
+#include <vector>
 
 class RobotisOp2OutputPacket;
 
@@ -28,12 +34,22 @@ public:
   RobotisOp2InputPacket();
   virtual ~RobotisOp2InputPacket();
 
+  int sequence() const;
+  // forgets the sensor values received in delta mode, when a new connection starts
+  void resetLastSensorValues();
+  // the shared memory is opened during the handshake (see RobotisOp2OutputPacket::apply())
+  bool isSharedMemoryOpen() const { return mSharedMemory.isOpen(); }
+  void closeSharedMemory() { mSharedMemory.close(); }
   void decode(int simulationTime, const RobotisOp2OutputPacket &outputPacket);
 
 private:
-  unsigned char *readJpegImage(const unsigned char *data, unsigned int length);
+  JpegDecoder mJpegDecoder;
   int mCameraWidth;
   int mCameraHeight;
+  int mLastSensorValues[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  SharedMemory mSharedMemory;
+  int mSharedSensorValues[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  std::vector<unsigned char> mSharedImage;
 };
 
 #endif
@@ -25,15 +25,28 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
 #include <webots/camera.h>
 
+#include <remote_protocol.hpp>
+
 using namespace std;
 
+// number of steps of the trajectories sent ahead to the robot
+static const int cTrajectoryHorizon = 8;
+// difference (in the units of the wire format, 0.088 degree) below which the trajectory is followed
+static const int cTrajectoryTolerance = 1;
+// the MX-28 motors do not turn faster than 55 rpm, that is about 4 units per millisecond
+static const int cMaxTrajectorySpeed = 4;
+
 RobotisOp2OutputPacket::RobotisOp2OutputPacket() :
-  Packet(50000),
+  Packet(remote_protocol::MAX_REQUEST_SIZE),
+  mSimulationTime(0),
+  mSharedMemoryRequest(NO_SHARED_MEMORY),
+  mDeltaSensorsRequested(false),
   mAccelerometerRequested(false),
   mGyroRequested(false),
   mCameraRequested(false) {
@@ -48,6 +61,8 @@ RobotisOp2OutputPacket::~RobotisOp2OutputPacket() {
 
 void RobotisOp2OutputPacket::clear() {
   Packet::clear();
+  mSharedMemoryRequest = NO_SHARED_MEMORY;
+  mDeltaSensorsRequested = false;
   mAccelerometerRequested = false;
   mGyroRequested = false;
   mCameraRequested = false;
@@ -57,28 +72,48 @@ void RobotisOp2OutputPacket::clear() {
   }
 }
 
-void RobotisOp2OutputPacket::apply(int simulationTime) {
-  append("W", 1);
+void RobotisOp2OutputPacket::apply(int simulationTime, int step, int sequence, SharedMemoryRequest sharedMemory) {
+  mSimulationTime = simulationTime;
+  // the layout of the packet is described in remote_protocol.hpp
+  appendByte(remote_protocol::PIPELINED);
   short int s = 0;
   append((char *)&s, 2);  // the total size of the packet will be stored here
+  appendInt(sequence);    // sent back by the robot in its reply
+
+  // the sensor values are sent as differences, the first request after the connection asks for a keyframe
+  mDeltaSensorsRequested = true;
+  appendByte(remote_protocol::DELTA_SENSORS);
+  appendByte(sequence == 0 ? 1 : 0);
+
+  // a server on the same machine publishes the sensor values and the raw camera image in shared memory
+  mSharedMemoryRequest = sharedMemory;
+  if (sharedMemory != NO_SHARED_MEMORY) {
+    appendByte(remote_protocol::SHARED_MEMORY);
+    appendByte(sharedMemory == SHARED_MEMORY_HANDSHAKE ? 1 : 0);
+  }
+
   // ---
   // Sensors
   // ---
 
   // the order of the sensors should match with RobotisOp2InputPacket::decode()
+  // the sensor requests are reset as soon as they are sent so that they are not
+  // requested again while their reply is still in flight
 
   // accelerometer management
   TripleValuesSensor *accelerometer = DeviceManager::instance()->accelerometer();
   if (accelerometer->isSensorRequested()) {
     mAccelerometerRequested = true;
-    append("A", 1);
+    appendByte(remote_protocol::ACCELEROMETER);
+    accelerometer->resetSensorRequested();
   }
 
   // gyro management
   TripleValuesSensor *gyro = DeviceManager::instance()->gyro();
   if (gyro->isSensorRequested()) {
     mGyroRequested = true;
-    append("G", 1);
+    appendByte(remote_protocol::GYRO);
+    gyro->resetSensorRequested();
   }
 
   // camera management
@@ -87,26 +122,22 @@ void RobotisOp2OutputPacket::apply(int simulationTime) {
   CameraR *camera = DeviceManager::instance()->camera();
   if (camera->isSensorRequested()) {
     mCameraRequested = true;
-    append("C", 1);
+    appendByte(remote_protocol::CAMERA);
+    camera->resetSensorRequested();
   }
 
   // ---
   // Actuators
   // ---
-  unsigned char c;
   // send the led commands if required
   for (int i = 0; i < 5; i++) {
     Led *led = DeviceManager::instance()->led(i);
     if (led->isLedRequested()) {
-      append("L", 1);
-      c = (led->index()) & 0xFF;
-      append(&c, 1);
-      c = ((led->state()) >> 16) & 0xFF;
-      append(&c, 1);
-      c = ((led->state()) >> 8) & 0xFF;
-      append(&c, 1);
-      c = (led->state()) & 0xFF;
-      append(&c, 1);
+      appendByte(remote_protocol::LED);
+      appendByte(led->index());
+      appendByte(led->state() >> 16);
+      appendByte(led->state() >> 8);
+      appendByte(led->state());
       led->resetLedRequested();
     }
   }
@@ -114,42 +145,51 @@ void RobotisOp2OutputPacket::apply(int simulationTime) {
   // Motors management
   for (int i = 0; i < 20; i++) {
     MotorR *motor = DeviceManager::instance()->motor(i);
-    if (motor->isMotorRequested()) {
-      append("S", 1);
-      c = (motor->index()) & 0xFF;
-      append(&c, 1);
+    const int setpoint = (int)((motor->position() * 2048) / M_PI);
+    // the robot plays the next setpoint of the trajectory it already has unless a new position is sent,
+    // which is needed only when the motor leaves the trajectory or when the trajectory is running out
+    bool sendPosition = motor->isPositionRequested();
+    int played;
+    if (motor->nextTrajectorySetpoint(&played))
+      sendPosition = abs(setpoint - played) > cTrajectoryTolerance ||
+                     motor->remainingTrajectorySetpoints() < cTrajectoryHorizon / 2;
+    const bool otherFieldRequested = motor->isVelocityRequested() || motor->isAccelerationRequested() ||
+                                     motor->isMotorForceRequested() || motor->isControlPIDRequested() ||
+                                     motor->isForceRequested();
+    if (sendPosition || otherFieldRequested) {
+      appendByte(remote_protocol::MOTOR);
+      appendByte(motor->index());
 
       // Position
-      if (motor->isPositionRequested()) {
-        append("p", 1);
-        int value = (int)((motor->position() * 2048) / M_PI);
-        appendInt(value);
-        motor->resetPositionRequested();
+      if (sendPosition) {
+        appendByte(remote_protocol::MOTOR_POSITION);
+        appendInt(setpoint);
+        appendTrajectory(motor, setpoint, step);
       }
       // Velocity
       if (motor->isVelocityRequested()) {
-        append("v", 1);
+        appendByte(remote_protocol::MOTOR_VELOCITY);
         int value = (int)((motor->velocity() * 30) / (0.114 * M_PI));
         appendInt(value);
         motor->resetVelocityRequested();
       }
       // Acceleration
       if (motor->isAccelerationRequested()) {
-        append("a", 1);
+        appendByte(remote_protocol::MOTOR_ACCELERATION);
         int value = (int)(motor->acceleration() * 100000);
         appendInt(value);
         motor->resetAccelerationRequested();
       }
       // MotorForce
       if (motor->isMotorForceRequested()) {
-        append("m", 1);
+        appendByte(remote_protocol::MOTOR_AVAILABLE_TORQUE);
         int value = (int)((motor->motorForce() * 1023) / 2.5);
         appendInt(value);
         motor->resetAvailableTorqueRequested();
       }
       // ControlPID
       if (motor->isControlPIDRequested()) {
-        append("c", 1);
+        appendByte(remote_protocol::MOTOR_CONTROL_PID);
         int pValue = (int)(motor->controlP() * 1000);
         int iValue = (int)(motor->controlI() * 1000);
         int dValue = (int)(motor->controlD() * 1000);
@@ -162,22 +202,24 @@ void RobotisOp2OutputPacket::apply(int simulationTime) {
       }
       // Force
       if (motor->isForceRequested()) {
-        append("f", 1);
+        appendByte(remote_protocol::MOTOR_TORQUE);
         int value = (int)((motor->torque() * 1023) / 2.5);
         appendInt(value);
         motor->resetTorqueRequested();
       }
-      motor->resetMotorRequested();
     }
+    motor->resetPositionRequested();
+    motor->resetMotorRequested();
+    motor->setLastPosition(motor->position());
   }
 
   for (int i = 0; i < 20; i++) {
     SingleValueSensor *positionSensor = DeviceManager::instance()->positionSensor(i);
     if (positionSensor->isSensorRequested()) {
       mPositionSensorRequested[i] = true;
-      append("P", 1);
-      c = (positionSensor->index()) & 0xFF;
-      append(&c, 1);
+      appendByte(remote_protocol::POSITION_SENSOR);
+      appendByte(positionSensor->index());
+      positionSensor->resetSensorRequested();
     }
   }
 
@@ -185,14 +227,14 @@ void RobotisOp2OutputPacket::apply(int simulationTime) {
     MotorR *motor = DeviceManager::instance()->motor(i);
     if (motor->isSensorRequested()) {
       mMotorTorqueFeedback[i] = true;
-      append("F", 1);
-      c = (motor->index()) & 0xFF;
-      append(&c, 1);
+      appendByte(remote_protocol::TORQUE_FEEDBACK);
+      appendByte(motor->index());
+      motor->resetSensorRequested();
     }
   }
   // This is required to end the packet
   // even if the size is correct
-  append("", 1);
+  appendByte(0);
   s = size();
   char sc[2];
   sc[0] = (unsigned char)(s % 256);
@@ -200,3 +242,34 @@ void RobotisOp2OutputPacket::apply(int simulationTime) {
   mData[1] = sc[0];  // write the size
   mData[2] = sc[1];  // of the packet
 }
+
+void RobotisOp2OutputPacket::appendTrajectory(MotorR *motor, int setpoint, int step) {
+  // a motor moved at a steady speed by the controller is expected to go on, a motor sent to a new
+  // target or stopped holds its position (the 'p' field alone clears the trajectory of the robot)
+  // the speed is estimated in radians, the rounded setpoints of a steady motion do not move steadily
+  const double velocity = motor->hasLastPosition() ? motor->position() - motor->lastPosition() : 0.0;
+  const double lastVelocity = motor->lastVelocity();
+  const bool steady = velocity != 0.0 && lastVelocity != 0.0 && (velocity > 0.0) == (lastVelocity > 0.0);
+  if (!steady || step <= 0 || step > 0xFFFF || fabs((velocity * 2048) / M_PI) > cMaxTrajectorySpeed * step) {
+    motor->setTrajectory(NULL, 0);
+    return;
+  }
+
+  int setpoints[cTrajectoryHorizon];
+  appendByte(remote_protocol::MOTOR_TRAJECTORY);
+  appendByte(cTrajectoryHorizon);
+  appendByte(step >> 8);
+  appendByte(step);
+  int previous = setpoint;
+  for (int i = 0; i < cTrajectoryHorizon; i++) {
+    setpoints[i] = (int)(((motor->position() + (i + 1) * velocity) * 2048) / M_PI);
+    // the differences between the setpoints are sent as varints, see remote_protocol.hpp
+    for (unsigned int value = remote_protocol::zigzag(setpoints[i] - previous);; value >>= 7) {
+      appendByte(value >= 0x80 ? (value & 0x7F) | 0x80 : value);
+      if (value < 0x80)
+        break;
+    }
+    previous = setpoints[i];
+  }
+  motor->setTrajectory(setpoints, cTrajectoryHorizon);
+}
@@ -22,13 +22,20 @@
 #include "Packet.hpp"
 
 class Device;
+class MotorR;
 
 class RobotisOp2OutputPacket : public Packet {
 public:
+  // use of the memory shared by a server running on the same machine
+  enum SharedMemoryRequest { NO_SHARED_MEMORY, SHARED_MEMORY, SHARED_MEMORY_HANDSHAKE };
+
   RobotisOp2OutputPacket();
   virtual ~RobotisOp2OutputPacket();
   virtual void clear();
-  void apply(int simulationTime);
+  void apply(int simulationTime, int step, int sequence, SharedMemoryRequest sharedMemory);
+  int simulationTime() const { return mSimulationTime; }
+  SharedMemoryRequest sharedMemoryRequest() const { return mSharedMemoryRequest; }
+  bool isDeltaSensorsRequested() const { return mDeltaSensorsRequested; }
   bool isAccelerometerRequested() const { return mAccelerometerRequested; }
   bool isGyroRequested() const { return mGyroRequested; }
   bool isCameraRequested() const { return mCameraRequested; }
@@ -36,6 +43,11 @@ public:
   bool isMotorForceFeedback(int at) const { return mMotorTorqueFeedback[at]; }
 
 private:
+  void appendTrajectory(MotorR *motor, int setpoint, int step);
+
+  int mSimulationTime;
+  SharedMemoryRequest mSharedMemoryRequest;
+  bool mDeltaSensorsRequested;
   bool mAccelerometerRequested;
   bool mGyroRequested;
   bool mCameraRequested;
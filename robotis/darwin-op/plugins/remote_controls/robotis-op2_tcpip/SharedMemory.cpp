@@ -0,0 +1,74 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SharedMemory.hpp"
+
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+SharedMemory::SharedMemory() : mRegion(0) {
+}
+
+SharedMemory::~SharedMemory() {
+  close();
+}
+
+bool SharedMemory::open(const char *name) {
+  close();
+#ifdef _WIN32
+  return false;
+#else
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if (fd == -1) {
+    cerr << "Cannot open the shared memory " << name << " of ROBOTIS OP2" << endl;
+    return false;
+  }
+  void *region = mmap(NULL, sizeof(remote_protocol::SharedRegion), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (region == MAP_FAILED) {
+    cerr << "Cannot map the shared memory " << name << " of ROBOTIS OP2" << endl;
+    return false;
+  }
+  mRegion = static_cast<const remote_protocol::SharedRegion *>(region);
+  if (mRegion->magic != remote_protocol::SHARED_REGION_MAGIC ||
+      mRegion->slotCount != remote_protocol::SHARED_SNAPSHOT_SLOTS) {
+    cerr << "Incompatible shared memory " << name << " of ROBOTIS OP2" << endl;
+    close();
+    return false;
+  }
+  return true;
+#endif
+}
+
+void SharedMemory::close() {
+#ifndef _WIN32
+  if (mRegion)
+    munmap(const_cast<remote_protocol::SharedRegion *>(mRegion), sizeof(remote_protocol::SharedRegion));
+#endif
+  mRegion = 0;
+}
+
+bool SharedMemory::read(int slot, int generation, int *sensorValues, unsigned char *image, int width,
+                        int height) const {
+  if (!mRegion || slot < 0 || slot >= remote_protocol::SHARED_SNAPSHOT_SLOTS)
+    return false;
+  return remote_protocol::readSharedSnapshot(&mRegion->slots[slot], generation, sensorValues, image, width, height);
+}
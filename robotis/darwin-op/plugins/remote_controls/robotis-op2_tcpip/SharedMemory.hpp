@@ -0,0 +1,41 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Description:  Read access to the snapshots shared by a remote_control server
+ *               running on the same machine (not available on Windows)
+ */
+
+#ifndef SHARED_MEMORY_HPP
+#define SHARED_MEMORY_HPP
+
+#include <shared_snapshot.hpp>
+
+class SharedMemory {
+public:
+  SharedMemory();
+  virtual ~SharedMemory();
+
+  bool open(const char *name);
+  void close();
+  bool isOpen() const { return mRegion != 0; }
+
+  // copies the sensor values and, if image is not NULL, the camera image of the given generation
+  bool read(int slot, int generation, int *sensorValues, unsigned char *image, int width, int height) const;
+
+private:
+  const remote_protocol::SharedRegion *mRegion;
+};
+
+#endif
@@ -0,0 +1,110 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StepPacer.hpp"
+
+#include "Time.hpp"
+
+#include <cmath>
+
+// a schedule late by more than this number of steps is restarted instead of caught up
+#define MAX_LATE_STEPS 10
+// a step longer than this duration (in microseconds) means that the simulation was paused
+#define PAUSE_DURATION 1000000
+// duration of the measurement windows in microseconds
+#define WINDOW_DURATION 1000000
+
+StepPacer::StepPacer() {
+  reset();
+}
+
+StepPacer::~StepPacer() {
+}
+
+void StepPacer::reset() {
+  mDeadline = 0;
+  mLastStepEnd = 0;
+  mWindowStart = 0;
+  mWindowSimulatedTime = 0;
+  mWindowSquaredError = 0.0;
+  mWindowSteps = 0;
+  mRealTimeFactor = 1.0;
+  mJitter = 0.0;
+  mTotalWallTime = 0;
+  mTotalSimulatedTime = 0;
+}
+
+int StepPacer::pace(int step) {
+  // a null step (actuators flushed when stopping for example) does not advance the schedule
+  if (step <= 0)
+    return 0;
+
+  long long now = Time::currentTime();
+  if (mDeadline == 0) {
+    mDeadline = now;
+    mLastStepEnd = now;
+    mWindowStart = now;
+  }
+  mDeadline += 1000LL * step;
+
+  int delay = 0;
+  if (now < mDeadline) {
+    Time::waitUntil(mDeadline);
+    now = Time::currentTime();
+  } else {
+    delay = (int)((now - mDeadline) / 1000);
+    if (now - mDeadline > 1000LL * MAX_LATE_STEPS * step)
+      mDeadline = now;
+    if (now - mLastStepEnd > PAUSE_DURATION) {
+      // the simulation was paused, this is not accounted in the measurements
+      mLastStepEnd = now;
+      mWindowStart = now;
+      mWindowSimulatedTime = 0;
+      mWindowSquaredError = 0.0;
+      mWindowSteps = 0;
+      return delay;
+    }
+  }
+
+  measure(now, step);
+  return delay;
+}
+
+double StepPacer::averageRealTimeFactor() const {
+  // including the current window
+  const long long wallTime = mTotalWallTime + (mLastStepEnd - mWindowStart);
+  return wallTime > 0 ? (double)(mTotalSimulatedTime + mWindowSimulatedTime) / wallTime : 1.0;
+}
+
+void StepPacer::measure(long long now, int step) {
+  const long long duration = now - mLastStepEnd;
+  mLastStepEnd = now;
+
+  const double error = (duration - 1000.0 * step) / 1000.0;
+  mWindowSquaredError += error * error;
+  mWindowSimulatedTime += 1000LL * step;
+  mWindowSteps++;
+
+  const long long windowDuration = now - mWindowStart;
+  if (windowDuration >= WINDOW_DURATION) {
+    mRealTimeFactor = (double)mWindowSimulatedTime / windowDuration;
+    mJitter = sqrt(mWindowSquaredError / mWindowSteps);
+    mTotalWallTime += windowDuration;
+    mTotalSimulatedTime += mWindowSimulatedTime;
+    mWindowStart = now;
+    mWindowSimulatedTime = 0;
+    mWindowSquaredError = 0.0;
+    mWindowSteps = 0;
+  }
+}
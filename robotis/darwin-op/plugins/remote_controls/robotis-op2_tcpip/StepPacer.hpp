@@ -0,0 +1,59 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Description:  Keeps the remote-controlled steps at 1.0x real time and measures
+ *               the real time factor and the jitter actually achieved
+ */
+
+#ifndef STEP_PACER_HPP
+#define STEP_PACER_HPP
+
+class StepPacer {
+public:
+  StepPacer();
+  virtual ~StepPacer();
+
+  void reset();
+
+  // Waits until the end of a step of the given duration (in milliseconds).
+  // The steps end on absolute deadlines, so a late step is caught up by the
+  // next ones; returns the delay in milliseconds when the deadline is missed.
+  int pace(int step);
+
+  // measured over the last completed window (about one second)
+  double realTimeFactor() const { return mRealTimeFactor; }
+  double jitter() const { return mJitter; }  // RMS deviation of the step durations from the steps, in milliseconds
+
+  // measured since the last reset, without the pauses
+  double averageRealTimeFactor() const;
+
+private:
+  void measure(long long now, int step);
+
+  long long mDeadline;  // microseconds, 0 until the first step
+  long long mLastStepEnd;
+
+  long long mWindowStart;
+  long long mWindowSimulatedTime;
+  double mWindowSquaredError;
+  int mWindowSteps;
+  double mRealTimeFactor;
+  double mJitter;
+
+  long long mTotalWallTime;
+  long long mTotalSimulatedTime;
+};
+
+#endif
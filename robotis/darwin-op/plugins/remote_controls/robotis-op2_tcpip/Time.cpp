@@ -17,10 +17,13 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
-#include <sys/time.h>
-#include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #endif
 
+// below this duration, Sleep() is not accurate enough and the processor is yielded instead
+#define WINDOWS_SPIN_DURATION 2000
+
 Time::Time() {
   mInitTime = currentTime();
 }
@@ -29,31 +32,60 @@ Time::~Time() {
 }
 
 int Time::currentSimulationTime() const {
-  return (int)(currentTime() - mInitTime);
+  return (int)(elapsedTime() / 1000);
+}
+
+long long Time::elapsedTime() const {
+  return currentTime() - mInitTime;
 }
 
-unsigned int Time::currentTime() {
+long long Time::currentTime() {
 #ifdef _WIN32
-  SYSTEMTIME tim;
-  GetSystemTime(&tim);
-  return (((tim.wHour * 60 + tim.wMinute) * 60 + tim.wSecond) * 1000 + tim.wMilliseconds) + 0.5;
+  static LARGE_INTEGER frequency = {0};
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  // split the conversion to avoid overflowing after a few days of uptime
+  const long long seconds = counter.QuadPart / frequency.QuadPart;
+  const long long rest = counter.QuadPart % frequency.QuadPart;
+  return seconds * 1000000 + rest * 1000000 / frequency.QuadPart;
 #else
-  timeval tim;
-  gettimeofday(&tim, NULL);
-  return ((tim.tv_sec) * 1000 + tim.tv_usec / 1000.0) + 0.5;
+  timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return (long long)tim.tv_sec * 1000000 + tim.tv_nsec / 1000;
 #endif
 }
 
 void Time::wait(int duration) {
+  waitUntil(currentTime() + 1000LL * duration);
+}
+
+void Time::waitUntil(long long deadline) {
 #ifdef _WIN32
-  Sleep(duration);
+  while (true) {
+    const long long remaining = deadline - currentTime();
+    if (remaining <= 0)
+      return;
+    Sleep(remaining > WINDOWS_SPIN_DURATION ? 1 : 0);
+  }
+#elif defined(__APPLE__)
+  // macOS has no clock_nanosleep(), the remaining time is computed again after each interruption
+  while (true) {
+    const long long remaining = deadline - currentTime();
+    if (remaining <= 0)
+      return;
+    timespec duration;
+    duration.tv_sec = remaining / 1000000;
+    duration.tv_nsec = (remaining % 1000000) * 1000;
+    nanosleep(&duration, NULL);
+  }
 #else
-  // because usleep cannot handle values
-  // bigger than 1 second (1'000'000 nanoseconds)
-  int seconds = duration / 1000;
-  int milliSeconds = duration - 1000 * seconds;
-  for (int i = 0; i < seconds; i++)
-    usleep(1000000);
-  usleep(1000 * milliSeconds);
+  // sleeping until an absolute time does not accumulate the wake up latencies
+  timespec tim;
+  tim.tv_sec = deadline / 1000000;
+  tim.tv_nsec = (deadline % 1000000) * 1000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tim, NULL) == EINTR) {
+  }
 #endif
 }
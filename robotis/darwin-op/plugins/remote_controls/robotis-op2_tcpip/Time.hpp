@@ -13,7 +13,8 @@
 // limitations under the License.
 
 /*
- * Description:  Helper function to return real time
+ * Description:  Helper function to return real time, measured on a monotonic clock
+ *               with a microsecond resolution
  */
 
 #ifndef TIME_HPP
@@ -25,12 +26,15 @@ public:
   virtual ~Time();
 
   int currentSimulationTime() const;  // returns milliseconds
+  long long elapsedTime() const;      // returns microseconds
 
-  static void wait(int duration);  // duration in milliseconds
+  // microseconds since an arbitrary origin, not affected by changes of the time of day
+  static long long currentTime();
+  static void wait(int duration);            // duration in milliseconds
+  static void waitUntil(long long deadline);  // deadline in microseconds of currentTime()
 
 private:
-  static unsigned int currentTime();
-  unsigned int mInitTime;
+  long long mInitTime;
 };
 
 #endif
@@ -23,6 +23,7 @@
 #include "RobotisOp2InputPacket.hpp"
 #include "RobotisOp2OutputPacket.hpp"
 #include "Sensor.hpp"
+#include "StepPacer.hpp"
 #include "Time.hpp"
 
 #include <webots/robot.h>
@@ -39,17 +40,33 @@ using namespace std;
 
 Communication *Wrapper::cCommunication = NULL;
 Time *Wrapper::cTime = NULL;
+StepPacer *Wrapper::cStepPacer = NULL;
 bool Wrapper::cSuccess = true;
+RobotisOp2InputPacket *Wrapper::cInputPacket = NULL;
+RobotisOp2OutputPacket *Wrapper::cOutputPackets[PIPELINE_DEPTH];
+int Wrapper::cSequence = 0;
+int Wrapper::cInFlight = 0;
+long long Wrapper::cRequestTimes[PIPELINE_DEPTH];
+Wrapper::ReplyHook Wrapper::cReplyHook = NULL;
+Wrapper::SharedMemoryState Wrapper::cSharedMemoryState = SHARED_MEMORY_OFF;
 
 void Wrapper::init() {
   DeviceManager::instance();
 
   cCommunication = new Communication;
+  cStepPacer = new StepPacer;
+  cInputPacket = new RobotisOp2InputPacket;
+  for (int i = 0; i < PIPELINE_DEPTH; i++)
+    cOutputPackets[i] = new RobotisOp2OutputPacket;
 }
 
 void Wrapper::cleanup() {
   delete cCommunication;
   delete cTime;
+  delete cStepPacer;
+  delete cInputPacket;
+  for (int i = 0; i < PIPELINE_DEPTH; i++)
+    delete cOutputPackets[i];
 
   DeviceManager::cleanup();
 }
@@ -71,6 +88,17 @@ bool Wrapper::start(const char *ip) {
     cout << "Retry to connect to " << ip << ":" << PORT << endl;
   }
 
+  cSequence = 0;
+  cInFlight = 0;
+  cInputPacket->resetLastSensorValues();
+  // the new server has no trajectory yet
+  for (int i = 0; i < 20; i++)
+    DeviceManager::instance()->motor(i)->resetTrajectory();
+  cStepPacer->reset();
+  // the JPEG round trip is avoided when the server runs on this machine
+  cInputPacket->closeSharedMemory();
+  cSharedMemoryState = cSuccess && cCommunication->isPeerLocal() ? SHARED_MEMORY_HANDSHAKE : SHARED_MEMORY_OFF;
+
   if (cSuccess)
     cTime = new Time();
   else {
@@ -86,8 +114,12 @@ void Wrapper::stop() {
     stopActuators();
 
   cCommunication->close();
+  cInputPacket->closeSharedMemory();
+  cSharedMemoryState = SHARED_MEMORY_OFF;
 
   if (cTime) {
+    cout << "Remote control achieved " << cStepPacer->averageRealTimeFactor()
+         << "x real time (step jitter over the last second: " << cStepPacer->jitter() << " ms)" << endl;
     delete cTime;
     cTime = NULL;
   }
@@ -97,64 +129,40 @@ int Wrapper::robotStep(int step) {
   // get simulation time at the beginning of this step
   int beginStepTime = cTime->currentSimulationTime();
 
-  // apply to sensors
-  DeviceManager::instance()->apply(beginStepTime);
-
-  // setup the output packet
-  RobotisOp2OutputPacket outputPacket;
-  outputPacket.apply(beginStepTime);
-
-  // 3 trials before giving up
-  for (int i = 0; i < 3; i++) {
-    // send the output packet
-    cSuccess = cCommunication->sendPacket(&outputPacket);
-    if (!cSuccess) {
-      cerr << "Failed to send packet to ROBOTIS OP2. Retry (" << (i + 1) << ")..." << endl;
-      continue;
-    }
-
-    // setup and receive the input packet
-    RobotisOp2InputPacket inputPacket;
-    cSuccess = cCommunication->receivePacket(&inputPacket);
-    if (!cSuccess) {
-      cerr << "Failed to receive packet from ROBOTIS OP2. Retry (" << (i + 1) << ")..." << endl;
-      continue;
-    }
-    inputPacket.decode(beginStepTime, outputPacket);
-    break;
-  }
+  // apply the replies which have already arrived without blocking the controller
+  while (cSuccess && cInFlight > 0 && cCommunication->isDataAvailable())
+    cSuccess = receiveReply();
+  // the pipeline is full, the oldest reply has to be received before sending a new request
+  while (cSuccess && cInFlight >= PIPELINE_DEPTH)
+    cSuccess = receiveReply();
   if (!cSuccess)
     return 0;
 
-  // Time management -> in order to be always as close as possible to 1.0x
-  int newTime = cTime->currentSimulationTime();
-
-  int static oldTime = 0;
-  double static timeStep = step;
-
-  if (newTime < oldTime)
-    oldTime = newTime;
-
-  // calculate difference between this time step and the previous one
-  int difference = (newTime - oldTime);
-  if (difference > 10 * step)  // if time difference is too big (simulation was stopped for example)
-    difference = 10 * step;    // set the difference to 10 * TimeStep
-
-  // Recalculate time actual time step
-  // The time step is not calculate only on one step,
-  // but it take also in count the previous time step
-  // with a bigger importance to the most recent
-  timeStep = timeStep * 9 + difference;
-  timeStep = timeStep / 10;
+  // apply to sensors
+  DeviceManager::instance()->apply(beginStepTime);
 
-  if ((int)timeStep < step) {  // the packet is sent at time
-    Time::wait((step - timeStep) + 0.5);
-    oldTime = cTime->currentSimulationTime();
+  // setup and send the output packet, its reply is received during one of the next steps
+  RobotisOp2OutputPacket *outputPacket = cOutputPackets[cSequence % PIPELINE_DEPTH];
+  outputPacket->clear();
+  RobotisOp2OutputPacket::SharedMemoryRequest sharedMemory = RobotisOp2OutputPacket::NO_SHARED_MEMORY;
+  if (cSharedMemoryState == SHARED_MEMORY_HANDSHAKE) {
+    // no other request uses the shared memory until the handshake reply is received
+    sharedMemory = RobotisOp2OutputPacket::SHARED_MEMORY_HANDSHAKE;
+    cSharedMemoryState = SHARED_MEMORY_PENDING;
+  } else if (cSharedMemoryState == SHARED_MEMORY_ON)
+    sharedMemory = RobotisOp2OutputPacket::SHARED_MEMORY;
+  outputPacket->apply(beginStepTime, step, cSequence, sharedMemory);
+  cRequestTimes[cSequence % PIPELINE_DEPTH] = Time::currentTime();
+  cSuccess = cCommunication->sendPacket(outputPacket);
+  if (!cSuccess) {
+    cerr << "Failed to send packet to ROBOTIS OP2." << endl;
     return 0;
-  } else {  // the delay asked is not fulfilled
-    oldTime = newTime;
-    return timeStep - step;
   }
+  cSequence++;
+  cInFlight++;
+
+  // Time management -> in order to be always as close as possible to 1.0x
+  return cStepPacer->pace(step);
 }
 
 void Wrapper::stopActuators() {
@@ -173,8 +181,39 @@ void Wrapper::stopActuators() {
       s->resetSensorRequested();
   }
 
-  // send the packet
+  // send the packet and wait until the robot has executed all the pending requests
   robotStep(0);
+  flush();
+}
+
+bool Wrapper::receiveReply() {
+  // the robot handles the requests in order, so the reply matches the oldest request in flight
+  const int sequence = cSequence - cInFlight;
+  const RobotisOp2OutputPacket *outputPacket = cOutputPackets[sequence % PIPELINE_DEPTH];
+  if (!cCommunication->receivePacket(cInputPacket)) {
+    cerr << "Failed to receive packet from ROBOTIS OP2." << endl;
+    return false;
+  }
+  if (cInputPacket->sequence() != sequence) {
+    cerr << "Unexpected packet received from ROBOTIS OP2 (sequence " << cInputPacket->sequence() << " instead of "
+         << sequence << ")." << endl;
+    return false;
+  }
+  if (cReplyHook)
+    cReplyHook(sequence, Time::currentTime() - cRequestTimes[sequence % PIPELINE_DEPTH]);
+  cInputPacket->decode(outputPacket->simulationTime(), *outputPacket);
+  cInFlight--;
+  if (outputPacket->sharedMemoryRequest() == RobotisOp2OutputPacket::SHARED_MEMORY_HANDSHAKE) {
+    cSharedMemoryState = cInputPacket->isSharedMemoryOpen() ? SHARED_MEMORY_ON : SHARED_MEMORY_OFF;
+    if (cSharedMemoryState == SHARED_MEMORY_ON)
+      cout << "Sharing memory with the ROBOTIS OP2 server running on this machine" << endl;
+  }
+  return true;
+}
+
+void Wrapper::flush() {
+  while (cSuccess && cInFlight > 0)
+    cSuccess = receiveReply();
 }
 
 void Wrapper::setSamplingPeriod(WbDeviceTag tag, int samplingPeriod) {
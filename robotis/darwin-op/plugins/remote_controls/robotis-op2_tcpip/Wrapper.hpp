@@ -21,7 +21,13 @@
 
 #include <webots/types.h>
 
+// number of requests sent to the ROBOTIS OP2 before waiting for the reply of the oldest one
+#define PIPELINE_DEPTH 2
+
 class Communication;
+class RobotisOp2InputPacket;
+class RobotisOp2OutputPacket;
+class StepPacer;
 class Time;
 
 class Wrapper {
@@ -50,13 +56,34 @@ public:
   // unimplemented required functions
   static void cameraSetFOV(WbDeviceTag tag, double fov) {}
 
+  // measurements, used by the benchmark
+  typedef void (*ReplyHook)(int sequence, long long roundTripTime);  // round trip time in microseconds
+  static void setReplyHook(ReplyHook hook) { cReplyHook = hook; }
+  static const Communication *communication() { return cCommunication; }
+
 private:
   Wrapper() {}
   ~Wrapper() {}
 
+  // shared memory with a server running on the same machine
+  enum SharedMemoryState { SHARED_MEMORY_OFF, SHARED_MEMORY_HANDSHAKE, SHARED_MEMORY_PENDING, SHARED_MEMORY_ON };
+
+  static bool receiveReply();
+  static void flush();
+
   static Communication *cCommunication;
   static Time *cTime;
+  static StepPacer *cStepPacer;
   static bool cSuccess;
+
+  // requests in flight have the sequence numbers [cSequence - cInFlight, cSequence[
+  static RobotisOp2InputPacket *cInputPacket;
+  static RobotisOp2OutputPacket *cOutputPackets[PIPELINE_DEPTH];
+  static int cSequence;
+  static int cInFlight;
+  static long long cRequestTimes[PIPELINE_DEPTH];  // microseconds, see Time::currentTime()
+  static ReplyHook cReplyHook;
+  static SharedMemoryState cSharedMemoryState;
 };
 
 #endif
@@ -0,0 +1,142 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Description:  Drives Wrapper::robotStep against a remote-control server (the
+ *               robot or remote_control/emulator) and reports the throughput,
+ *               the round trip times and the traffic of the protocol
+ */
+
+#include "webots_stub.hpp"
+
+#include "../Communication.hpp"
+#include "../Time.hpp"
+#include "../Wrapper.hpp"
+
+#include <webots/robot.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#define NMOTORS 20
+
+using namespace std;
+
+static const char *motorNames[NMOTORS] = {"ShoulderR", "ShoulderL", "ArmUpperR", "ArmUpperL", "ArmLowerR",
+                                          "ArmLowerL", "PelvYR",    "PelvYL",    "PelvR",     "PelvL",
+                                          "LegUpperR", "LegUpperL", "LegLowerR", "LegLowerL", "AnkleR",
+                                          "AnkleL",    "FootR",     "FootL",     "Neck",      "Head"};
+
+static vector<long long> gRoundTripTimes;
+
+static void recordReply(int sequence, long long roundTripTime) {
+  gRoundTripTimes.push_back(roundTripTime);
+}
+
+static double percentile(const vector<long long> &sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  const size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return 0.001 * sorted[index];
+}
+
+static void usage() {
+  cout << "Usage: remote_benchmark [options]" << endl;
+  cout << "  --ip <address>       address of the robot or of the emulator (default 127.0.0.1)" << endl;
+  cout << "  --steps <count>      number of steps (default 2000)" << endl;
+  cout << "  --step <ms>          duration of a step (default 8)" << endl;
+  cout << "  --camera <ms>        sampling period of the camera (default 0, disabled)" << endl;
+  cout << "  --sensors <ms>       sampling period of the other sensors (default 8, 0 to disable)" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  const char *ip = "127.0.0.1";
+  int steps = 2000;
+  int step = 8;
+  int cameraPeriod = 0;
+  int sensorPeriod = 8;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--ip") == 0 && hasValue)
+      ip = argv[++i];
+    else if (strcmp(argv[i], "--steps") == 0 && hasValue)
+      steps = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--step") == 0 && hasValue)
+      step = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--camera") == 0 && hasValue)
+      cameraPeriod = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--sensors") == 0 && hasValue)
+      sensorPeriod = atoi(argv[++i]);
+    else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (steps <= 0 || step <= 0) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  Wrapper::init();
+  Wrapper::setReplyHook(recordReply);
+  if (!Wrapper::start(ip))
+    return EXIT_FAILURE;
+
+  // the same devices as a walking controller with the camera
+  Wrapper::setSamplingPeriod(wb_robot_get_device("Camera"), cameraPeriod);
+  Wrapper::setSamplingPeriod(wb_robot_get_device("Accelerometer"), sensorPeriod);
+  Wrapper::setSamplingPeriod(wb_robot_get_device("Gyro"), sensorPeriod);
+  WbDeviceTag motors[NMOTORS];
+  for (int i = 0; i < NMOTORS; i++) {
+    motors[i] = wb_robot_get_device(motorNames[i]);
+    Wrapper::setSamplingPeriod(wb_robot_get_device((string(motorNames[i]) + "S").c_str()), sensorPeriod);
+  }
+
+  gRoundTripTimes.reserve(steps);
+  int lateSteps = 0;
+  const long long start = Time::currentTime();
+  for (int i = 0; i < steps && !Wrapper::hasFailed(); i++) {
+    // every motor moves at every step, as during a walk
+    for (int j = 0; j < NMOTORS; j++)
+      Wrapper::motorSetPosition(motors[j], 0.2 * sin(0.01 * i + j));
+    if (Wrapper::robotStep(step) > 0)
+      lateSteps++;
+  }
+  const double duration = 1e-6 * (Time::currentTime() - start);
+  const bool failed = Wrapper::hasFailed();
+
+  const Communication *communication = Wrapper::communication();
+  const double bytesSentPerStep = (double)communication->bytesSent() / steps;
+  const double bytesReceivedPerStep = (double)communication->bytesReceived() / steps;
+  Wrapper::stop();
+
+  sort(gRoundTripTimes.begin(), gRoundTripTimes.end());
+  const WebotsStubCounters &counters = webotsStubCounters();
+  printf("steps:            %d in %.2f s, %.1f steps/s (%.1f expected), %d late\n", steps, duration, steps / duration,
+         1000.0 / step, lateSteps);
+  printf("round trip (ms):  p50 %.2f, p90 %.2f, p99 %.2f, max %.2f over %d replies\n", percentile(gRoundTripTimes, 0.5),
+         percentile(gRoundTripTimes, 0.9), percentile(gRoundTripTimes, 0.99), percentile(gRoundTripTimes, 1.0),
+         (int)gRoundTripTimes.size());
+  printf("bytes per step:   %.1f sent, %.1f received\n", bytesSentPerStep, bytesReceivedPerStep);
+  printf("values received:  %d images, %d accelerometer, %d gyro, %d positions\n", counters.images,
+         counters.accelerometer, counters.gyro, counters.positions);
+
+  Wrapper::cleanup();
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Description:  Minimal implementation of the Webots functions used by the plugin,
+ *               so that the plugin can be benchmarked outside of Webots
+ */
+
+#include "webots_stub.hpp"
+
+#include <webots/camera.h>
+#include <webots/device.h>
+#include <webots/remote_control.h>
+#include <webots/robot.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static vector<string> gDeviceNames;
+static WebotsStubCounters gCounters = {0, 0, 0, 0, 0};
+
+const WebotsStubCounters &webotsStubCounters() {
+  return gCounters;
+}
+
+// the tags are given in the order of the first request, 0 is not a valid tag
+WbDeviceTag wb_robot_get_device(const char *name) {
+  for (size_t i = 0; i < gDeviceNames.size(); i++) {
+    if (gDeviceNames[i] == name)
+      return i + 1;
+  }
+  gDeviceNames.push_back(name);
+  return gDeviceNames.size();
+}
+
+const char *wb_device_get_name(WbDeviceTag tag) {
+  return tag > 0 && tag <= gDeviceNames.size() ? gDeviceNames[tag - 1].c_str() : "";
+}
+
+WbNodeType wb_device_get_node_type(WbDeviceTag tag) {
+  return WB_NODE_NO_NODE;
+}
+
+int wb_camera_get_width(WbDeviceTag tag) {
+  return 320;
+}
+
+int wb_camera_get_height(WbDeviceTag tag) {
+  return 240;
+}
+
+void wbr_accelerometer_set_values(WbDeviceTag tag, const double *values) {
+  gCounters.accelerometer++;
+}
+
+void wbr_gyro_set_values(WbDeviceTag tag, const double *values) {
+  gCounters.gyro++;
+}
+
+void wbr_camera_set_image(WbDeviceTag tag, const unsigned char *image) {
+  gCounters.images++;
+}
+
+void wbr_position_sensor_set_value(WbDeviceTag tag, double value) {
+  gCounters.positions++;
+}
+
+void wbr_motor_set_torque_feedback(WbDeviceTag tag, double value) {
+  gCounters.torques++;
+}
@@ -0,0 +1,32 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Description:  Counts the sensor values given by the plugin to the stub of Webots
+ */
+
+#ifndef WEBOTS_STUB_HPP
+#define WEBOTS_STUB_HPP
+
+struct WebotsStubCounters {
+  int accelerometer;
+  int gyro;
+  int images;
+  int positions;
+  int torques;
+};
+
+const WebotsStubCounters &webotsStubCounters();
+
+#endif
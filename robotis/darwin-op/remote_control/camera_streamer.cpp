@@ -0,0 +1,230 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "camera_streamer.hpp"
+
+#include <stdlib.h>
+#include <time.h>
+
+// the camera encoding should not take more than this share of the camera period
+#define MAX_CPU_SHARE 0.25
+// number of comfortable frames before improving the image again
+#define STABLE_FRAMES 30
+
+// from the best to the cheapest image
+const CameraStreamer::Level CameraStreamer::cLevels[] = {{0, 1, 0},  {50, 1, 0}, {35, 1, 0}, {50, 2, 0}, {35, 2, 0},
+                                                         {35, 2, 1}, {35, 4, 1}, {35, 4, 3}, {35, 4, 7}};
+const int CameraStreamer::cNumberOfLevels = sizeof(cLevels) / sizeof(cLevels[0]);
+
+struct BufferDestination {
+  struct jpeg_destination_mgr manager;
+  JOCTET *buffer;
+  size_t capacity;
+  bool overflow;
+};
+
+static void initDestination(j_compress_ptr compress) {
+  BufferDestination *destination = (BufferDestination *)compress->dest;
+  destination->manager.next_output_byte = destination->buffer;
+  destination->manager.free_in_buffer = destination->capacity;
+  destination->overflow = false;
+}
+
+static boolean emptyDestination(j_compress_ptr compress) {
+  // the image does not fit in the buffer, it is dropped
+  BufferDestination *destination = (BufferDestination *)compress->dest;
+  destination->overflow = true;
+  destination->manager.next_output_byte = destination->buffer;
+  destination->manager.free_in_buffer = destination->capacity;
+  return TRUE;
+}
+
+static void termDestination(j_compress_ptr compress) {
+}
+
+static double currentTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+CameraStreamer::CameraStreamer(int cameraWidth, int cameraHeight, int cropWidth, int cropHeight, bool adaptive,
+                               bool grayscale) :
+  mCameraWidth(cameraWidth),
+  mCameraHeight(cameraHeight),
+  mCropWidth(cropWidth),
+  mCropHeight(cropHeight),
+  mAdaptive(adaptive),
+  mGrayscale(grayscale),
+  mLevel(0),
+  mStableFrames(0),
+  mSkipCounter(0),
+  mLastEncodeTime(0.0),
+  mQuality(0),
+  mDownscale(1),
+  mSkipped(false) {
+  // full resolution -> quality at 65%, smaller image -> quality at 80%
+  mFixedQuality = (cropWidth == cameraWidth && cropHeight == cameraHeight) ? 65 : 80;
+  mQuality = mFixedQuality;
+
+  // the downscaled image should keep a sensible size and an exact number of pixels
+  mMaxDownscale = 1;
+  while (mMaxDownscale < 4 && cropWidth % (2 * mMaxDownscale) == 0 && cropHeight % (2 * mMaxDownscale) == 0 &&
+         cropWidth / (2 * mMaxDownscale) >= 16 && cropHeight / (2 * mMaxDownscale) >= 16)
+    mMaxDownscale *= 2;
+
+  // a JPEG image is never bigger than the raw RGB image
+  mCapacity = 3 * cropWidth * cropHeight;
+  mJpeg = (unsigned char *)malloc(mCapacity);
+  mScaled = (unsigned char *)malloc(4 * cropWidth * cropHeight);
+
+  mCompress.err = jpeg_std_error(&mError);
+  jpeg_create_compress(&mCompress);
+  BufferDestination *destination = (BufferDestination *)(*mCompress.mem->alloc_small)(
+    (j_common_ptr)&mCompress, JPOOL_PERMANENT, sizeof(BufferDestination));
+  destination->manager.init_destination = initDestination;
+  destination->manager.empty_output_buffer = emptyDestination;
+  destination->manager.term_destination = termDestination;
+  destination->buffer = mJpeg;
+  destination->capacity = mCapacity;
+  destination->overflow = false;
+  mCompress.dest = &destination->manager;
+}
+
+CameraStreamer::~CameraStreamer() {
+  jpeg_destroy_compress(&mCompress);
+  free(mJpeg);
+  free(mScaled);
+}
+
+int CameraStreamer::encodeFixed(const unsigned char *image) {
+  mQuality = mFixedQuality;
+  mDownscale = 1;
+  mSkipped = false;
+  return compress(image, mQuality, 1, false);
+}
+
+int CameraStreamer::encode(const unsigned char *image, int pendingBytes) {
+  if (!mAdaptive) {
+    mQuality = mFixedQuality;
+    mDownscale = 1;
+    mSkipped = false;
+    return compress(image, mQuality, 1, mGrayscale);
+  }
+
+  const Level &level = cLevels[mLevel];
+  const double start = currentTime();
+  const double period = mLastEncodeTime > 0.0 ? start - mLastEncodeTime : 0.0;
+  mLastEncodeTime = start;
+
+  mSkipped = mSkipCounter < level.skip;
+  if (mSkipped) {
+    mSkipCounter++;
+    return 0;
+  }
+  mSkipCounter = 0;
+
+  mQuality = level.quality > 0 ? level.quality : mFixedQuality;
+  mDownscale = level.downscale < mMaxDownscale ? level.downscale : mMaxDownscale;
+  const int length = compress(image, mQuality, mDownscale, mGrayscale);
+  adapt(currentTime() - start, period * (level.skip + 1), pendingBytes, length);
+  return length;
+}
+
+void CameraStreamer::adapt(double encodeTime, double period, int pendingBytes, int length) {
+  if (period <= 0.0)
+    return;
+
+  // the link is saturated when the previous images are still waiting in the socket
+  const bool linkSaturated = length == 0 || pendingBytes > 2 * length;
+  const double cpuShare = encodeTime / period;
+  if (linkSaturated || cpuShare > MAX_CPU_SHARE) {
+    if (mLevel < cNumberOfLevels - 1)
+      mLevel++;
+    mStableFrames = 0;
+  } else if (cpuShare < MAX_CPU_SHARE / 2 && pendingBytes < length / 2) {
+    if (++mStableFrames >= STABLE_FRAMES && mLevel > 0) {
+      mLevel--;
+      mStableFrames = 0;
+    }
+  } else
+    mStableFrames = 0;
+}
+
+const unsigned char *CameraStreamer::scale(const unsigned char *image, int downscale, bool grayscale) {
+  const int width = mCropWidth / downscale;
+  const int height = mCropHeight / downscale;
+  const int left = (mCameraWidth - mCropWidth) / 2;
+  const int top = (mCameraHeight - mCropHeight) / 2;
+  const int area = downscale * downscale;
+  unsigned char *output = mScaled;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      // box filter over the downscale x downscale BGRA pixels
+      int b = 0, g = 0, r = 0;
+      for (int j = 0; j < downscale; j++) {
+        const unsigned char *pixel = image + 4 * ((top + y * downscale + j) * mCameraWidth + left + x * downscale);
+        for (int i = 0; i < downscale; i++, pixel += 4) {
+          b += pixel[0];
+          g += pixel[1];
+          r += pixel[2];
+        }
+      }
+      if (grayscale)
+        *output++ = ((29 * b + 150 * g + 77 * r) / area + 128) >> 8;
+      else {
+        *output++ = b / area;
+        *output++ = g / area;
+        *output++ = r / area;
+        *output++ = 255;
+      }
+    }
+  }
+  return mScaled;
+}
+
+int CameraStreamer::compress(const unsigned char *image, int quality, int downscale, bool grayscale) {
+  const int width = mCropWidth / downscale;
+  const int height = mCropHeight / downscale;
+  const unsigned char *source = image;
+  int stride = 4 * mCameraWidth;
+  if (downscale == 1 && !grayscale)  // libjpeg-turbo reads the BGRA camera image in place
+    source += 4 * (((mCameraHeight - mCropHeight) / 2) * mCameraWidth + (mCameraWidth - mCropWidth) / 2);
+  else {
+    source = scale(image, downscale, grayscale);
+    stride = (grayscale ? 1 : 4) * width;
+  }
+
+  mCompress.image_width = width;
+  mCompress.image_height = height;
+  mCompress.input_components = grayscale ? 1 : 4;
+  mCompress.in_color_space = grayscale ? JCS_GRAYSCALE : JCS_EXT_BGRA;
+  jpeg_set_defaults(&mCompress);
+  jpeg_set_quality(&mCompress, quality, TRUE);
+  mCompress.dct_method = JDCT_IFAST;
+  jpeg_start_compress(&mCompress, TRUE);
+  while (mCompress.next_scanline < mCompress.image_height) {
+    JSAMPROW row = (JSAMPROW)(source + mCompress.next_scanline * stride);
+    jpeg_write_scanlines(&mCompress, &row, 1);
+  }
+  jpeg_finish_compress(&mCompress);
+
+  BufferDestination *destination = (BufferDestination *)mCompress.dest;
+  // an image which does not fit the buffer is sent as skipped, the client keeps the previous one
+  if (destination->overflow) {
+    mSkipped = true;
+    return 0;
+  }
+  return mCapacity - destination->manager.free_in_buffer;
+}
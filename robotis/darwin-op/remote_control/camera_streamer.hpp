@@ -0,0 +1,93 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Adaptive JPEG streaming of the ROBOTIS OP2 camera for the remote-control
+
+#ifndef CAMERA_STREAMER_HPP
+#define CAMERA_STREAMER_HPP
+
+#include <stdio.h>
+#include <jpeglib.h>
+
+// Compresses the center of the BGRA camera image. In adaptive mode, a rate controller
+// trades JPEG quality, then resolution, then frame rate to keep the encoding time
+// below a share of the camera period and the images from piling up in the socket.
+class CameraStreamer {
+public:
+  // cropWidth x cropHeight pixels are taken from the center of the cameraWidth x cameraHeight image
+  CameraStreamer(int cameraWidth, int cameraHeight, int cropWidth, int cropHeight, bool adaptive, bool grayscale);
+  virtual ~CameraStreamer();
+
+  // returns the length of the JPEG image, 0 if the frame is skipped or does not fit the buffer
+  // pendingBytes is the amount of data not yet acknowledged by the client
+  int encode(const unsigned char *image, int pendingBytes);
+  // legacy clients always receive color images at the fixed quality
+  int encodeFixed(const unsigned char *image);
+
+  const unsigned char *jpeg() const { return mJpeg; }
+  int capacity() const { return mCapacity; }
+
+  // raw cropped image, its rows are stride() bytes apart in the camera image
+  const unsigned char *cropOrigin(const unsigned char *image) const {
+    return image + 4 * (((mCameraHeight - mCropHeight) / 2) * mCameraWidth + (mCameraWidth - mCropWidth) / 2);
+  }
+  int cropWidth() const { return mCropWidth; }
+  int cropHeight() const { return mCropHeight; }
+  int stride() const { return 4 * mCameraWidth; }
+
+  // parameters of the last image, sent to the client with the image
+  int quality() const { return mQuality; }
+  int downscale() const { return mDownscale; }
+  bool isGrayscale() const { return mGrayscale; }
+  bool isSkipped() const { return mSkipped; }
+
+private:
+  struct Level {
+    int quality;    // 0 for the fixed quality
+    int downscale;  // width and height are divided by this factor
+    int skip;       // number of frames skipped after each encoded frame
+  };
+  static const Level cLevels[];
+  static const int cNumberOfLevels;
+
+  int compress(const unsigned char *image, int quality, int downscale, bool grayscale);
+  void adapt(double encodeTime, double period, int pendingBytes, int length);
+  const unsigned char *scale(const unsigned char *image, int downscale, bool grayscale);
+
+  int mCameraWidth;
+  int mCameraHeight;
+  int mCropWidth;
+  int mCropHeight;
+  int mFixedQuality;
+  int mMaxDownscale;
+  bool mAdaptive;
+  bool mGrayscale;
+
+  int mLevel;
+  int mStableFrames;
+  int mSkipCounter;
+  double mLastEncodeTime;
+
+  int mQuality;
+  int mDownscale;
+  bool mSkipped;
+
+  struct jpeg_compress_struct mCompress;
+  struct jpeg_error_mgr mError;
+  unsigned char *mScaled;
+  unsigned char *mJpeg;
+  int mCapacity;
+};
+
+#endif
@@ -0,0 +1,197 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "emulated_robot.hpp"
+
+#include "../remote_protocol.hpp"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <jpeglib.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// fraction of the tracking error recovered by the emulated motors at each step
+#define MOTOR_RESPONSE 0.3
+// torque feedback (* 10000) per radian of tracking error
+#define MOTOR_STIFFNESS 20000.0
+
+using namespace std;
+
+static long long currentTime() {
+  timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return (long long)tim.tv_sec * 1000000 + tim.tv_nsec / 1000;
+}
+
+EmulatedRobot::EmulatedRobot(int stepDuration) :
+  mStepDuration(stepDuration),
+  mDeadline(0),
+  mStep(0),
+  mImage(NULL),
+  mSyntheticImage(4 * EMULATED_CAMERA_WIDTH * EMULATED_CAMERA_HEIGHT) {
+  for (int i = 0; i < NMOTORS; i++) {
+    mPositions[i] = 0.0;
+    mTorques[i] = 0.0;
+    mTargets[i] = 0.0;
+  }
+  updateSensors();
+  updateImage();
+}
+
+EmulatedRobot::~EmulatedRobot() {
+}
+
+bool EmulatedRobot::loadSensorRecording(const char *filename) {
+  ifstream file(filename);
+  if (!file) {
+    cerr << "Cannot open the sensor recording " << filename << endl;
+    return false;
+  }
+  string line;
+  while (getline(file, line)) {
+    for (size_t i = 0; i < line.size(); i++) {
+      if (line[i] == ',')
+        line[i] = ' ';
+    }
+    istringstream stream(line);
+    vector<int> values;
+    int value;
+    while (stream >> value)
+      values.push_back(value);
+    if (values.empty())
+      continue;
+    if (values.size() != remote_protocol::NUMBER_OF_SENSOR_SLOTS) {
+      cerr << "Wrong number of values in the sensor recording " << filename << ": " << values.size() << " instead of "
+           << remote_protocol::NUMBER_OF_SENSOR_SLOTS << endl;
+      return false;
+    }
+    mSensorRecording.push_back(values);
+  }
+  updateSensors();
+  return !mSensorRecording.empty();
+}
+
+bool EmulatedRobot::loadFrame(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    cerr << "Cannot open the camera image " << filename << endl;
+    return false;
+  }
+
+  struct jpeg_decompress_struct decompress;
+  struct jpeg_error_mgr error;
+  decompress.err = jpeg_std_error(&error);
+  jpeg_create_decompress(&decompress);
+  jpeg_stdio_src(&decompress, file);
+  jpeg_read_header(&decompress, TRUE);
+  decompress.out_color_space = JCS_EXT_BGRA;
+  jpeg_start_decompress(&decompress);
+
+  bool success = decompress.output_width == EMULATED_CAMERA_WIDTH && decompress.output_height == EMULATED_CAMERA_HEIGHT;
+  if (success) {
+    vector<unsigned char> frame(4 * EMULATED_CAMERA_WIDTH * EMULATED_CAMERA_HEIGHT);
+    while (decompress.output_scanline < decompress.output_height) {
+      JSAMPROW row = &frame[4 * EMULATED_CAMERA_WIDTH * decompress.output_scanline];
+      jpeg_read_scanlines(&decompress, &row, 1);
+    }
+    mFrames.push_back(frame);
+    jpeg_finish_decompress(&decompress);
+  } else
+    cerr << "The camera image " << filename << " should be " << EMULATED_CAMERA_WIDTH << "x" << EMULATED_CAMERA_HEIGHT
+         << endl;
+  jpeg_destroy_decompress(&decompress);
+  fclose(file);
+
+  updateImage();
+  return success;
+}
+
+void EmulatedRobot::remoteStep() {
+  // the steps end on absolute deadlines, as on the robot
+  if (mDeadline == 0)
+    mDeadline = currentTime();
+  mDeadline += 1000LL * mStepDuration;
+  timespec tim;
+  tim.tv_sec = mDeadline / 1000000;
+  tim.tv_nsec = (mDeadline % 1000000) * 1000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tim, NULL) == EINTR) {
+  }
+
+  mStep++;
+  updateSensors();
+  updateImage();
+}
+
+void EmulatedRobot::setRemoteMotorPosition(int index, int value) {
+  // same conversion as Remote::setRemoteMotorPosition()
+  mTargets[index] = (M_PI * value) / 2048;
+}
+
+void EmulatedRobot::updateSensors() {
+  if (!mSensorRecording.empty()) {
+    const vector<int> &values = mSensorRecording[mStep % mSensorRecording.size()];
+    for (int c = 0; c < 3; c++) {
+      mAccelerometer[c] = values[remote_protocol::ACCELEROMETER_SLOT + c];
+      mGyro[c] = values[remote_protocol::GYRO_SLOT + c];
+    }
+    for (int i = 0; i < NMOTORS; i++) {
+      mPositions[i] = values[remote_protocol::POSITION_SENSOR_SLOT + i];
+      mTorques[i] = values[remote_protocol::TORQUE_FEEDBACK_SLOT + i];
+    }
+    return;
+  }
+
+  // raw values of the robot sensors, 512 is the rest value and 1g is about 128 on the accelerometer
+  const double t = 0.001 * mStep * mStepDuration;
+  mAccelerometer[0] = 512 + 6 * sin(2.0 * t);
+  mAccelerometer[1] = 512 + 6 * cos(2.0 * t);
+  mAccelerometer[2] = 640 + (rand() % 5 - 2);
+  for (int c = 0; c < 3; c++)
+    mGyro[c] = 512 + 4 * sin(3.0 * t + c) + (rand() % 3 - 1);
+
+  for (int i = 0; i < NMOTORS; i++) {
+    const double position = mPositions[i] / 10000;
+    const double error = mTargets[i] - position;
+    mPositions[i] = (int)(10000 * (position + MOTOR_RESPONSE * error));
+    mTorques[i] = (int)(MOTOR_STIFFNESS * error);
+  }
+}
+
+void EmulatedRobot::updateImage() {
+  if (!mFrames.empty()) {
+    mImage = &mFrames[mStep % mFrames.size()][0];
+    return;
+  }
+
+  // a scrolling checkerboard with some noise gives JPEG images of a realistic size
+  const int offset = 2 * mStep;
+  for (int y = 0; y < EMULATED_CAMERA_HEIGHT; y++) {
+    unsigned char *pixel = &mSyntheticImage[4 * EMULATED_CAMERA_WIDTH * y];
+    for (int x = 0; x < EMULATED_CAMERA_WIDTH; x++, pixel += 4) {
+      const bool light = (((x + offset) / 20) + (y / 20)) % 2 == 0;
+      const int noise = rand() % 16;
+      pixel[0] = (light ? 200 : 40) + noise;
+      pixel[1] = (light ? 180 : 60) + noise;
+      pixel[2] = (unsigned char)(x * 255 / EMULATED_CAMERA_WIDTH);
+      pixel[3] = 255;
+    }
+  }
+  mImage = &mSyntheticImage[0];
+}
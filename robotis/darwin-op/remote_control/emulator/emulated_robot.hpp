@@ -0,0 +1,81 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Stand-in for the ROBOTIS OP2 devices, feeding synthetic or
+//                recorded sensor values and camera images to the remote-control server
+
+#ifndef EMULATED_ROBOT_HPP
+#define EMULATED_ROBOT_HPP
+
+#include "../remote_robot.hpp"
+
+#include <string>
+#include <vector>
+
+#define EMULATED_CAMERA_WIDTH 320
+#define EMULATED_CAMERA_HEIGHT 240
+
+// Without recording, the position sensors follow the commanded positions with
+// a first order lag, the torque feedback is proportional to the tracking error,
+// the accelerometer and the gyro oscillate slowly around their rest values and
+// the camera shows a scrolling pattern.
+class EmulatedRobot : public RemoteRobot {
+public:
+  // stepDuration is the duration of a step of the robot in milliseconds
+  explicit EmulatedRobot(int stepDuration);
+  virtual ~EmulatedRobot();
+
+  // one line per step, with the remote_protocol::NUMBER_OF_SENSOR_SLOTS values in the order of
+  // the slots separated by spaces or commas, the recording is replayed in a loop
+  bool loadSensorRecording(const char *filename);
+  // 320x240 JPEG images, replayed in a loop
+  bool loadFrame(const char *filename);
+
+  virtual void remoteStep();
+
+  virtual const double *getRemoteAccelerometer() const { return mAccelerometer; }
+  virtual const double *getRemoteGyro() const { return mGyro; }
+  virtual const unsigned char *getRemoteImage() const { return mImage; }
+  virtual double getRemotePositionSensor(int index) { return mPositions[index]; }
+  virtual double getRemoteMotorTorque(int index) { return mTorques[index]; }
+
+  virtual void setRemoteLED(int index, int value) {}
+  virtual void setRemoteMotorPosition(int index, int value);
+  virtual void setRemoteMotorVelocity(int index, int value) {}
+  virtual void setRemoteMotorAcceleration(int index, int value) {}
+  virtual void setRemoteMotorAvailableTorque(int index, int value) {}
+  virtual void setRemoteMotorTorque(int index, int value) {}
+  virtual void setRemoteMotorControlPID(int index, int p, int i, int d) {}
+
+private:
+  void updateSensors();
+  void updateImage();
+
+  int mStepDuration;
+  long long mDeadline;  // microseconds on the monotonic clock
+  int mStep;
+
+  double mAccelerometer[3];
+  double mGyro[3];
+  double mPositions[NMOTORS];  // radians * 10000, as the real position sensors
+  double mTorques[NMOTORS];
+  double mTargets[NMOTORS];
+
+  std::vector<std::vector<int> > mSensorRecording;
+  std::vector<std::vector<unsigned char> > mFrames;  // decoded BGRA images
+  unsigned char *mImage;
+  std::vector<unsigned char> mSyntheticImage;
+};
+
+#endif
@@ -0,0 +1,211 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "link_emulator.hpp"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <iostream>
+
+// payload of a TCP segment on an ethernet or wifi link
+#define SEGMENT_SIZE 1448
+// minimum retransmission timeout of Linux, in microseconds
+#define RETRANSMISSION_TIMEOUT 200000
+// the relay stops reading from a side while this amount of data waits to be delivered to the other side
+#define MAX_QUEUED_BYTES 65536
+
+using namespace std;
+
+static long long currentTime() {
+  timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return (long long)tim.tv_sec * 1000000 + tim.tv_nsec / 1000;
+}
+
+LinkEmulator::LinkEmulator(int latency, int bandwidth, double loss) :
+  mLatency(latency),
+  mBandwidth(bandwidth),
+  mLoss(loss),
+  mListenSocket(-1),
+  mServerPort(0) {
+}
+
+LinkEmulator::~LinkEmulator() {
+  // the relay thread ends with the process
+  if (mListenSocket != -1)
+    close(mListenSocket);
+}
+
+bool LinkEmulator::start(int listenPort, int serverPort) {
+  mServerPort = serverPort;
+  mListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if (mListenSocket == -1) {
+    perror("socket");
+    return false;
+  }
+  int opt = 1;
+  setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, (const char *)&opt, sizeof(int));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(listenPort);
+  if (bind(mListenSocket, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(mListenSocket, 1) == -1) {
+    perror("bind");
+    return false;
+  }
+  if (pthread_create(&mThread, NULL, run, this) != 0) {
+    cerr << "Cannot start the link emulator" << endl;
+    return false;
+  }
+  pthread_detach(mThread);
+  return true;
+}
+
+void *LinkEmulator::run(void *emulator) {
+  LinkEmulator *self = static_cast<LinkEmulator *>(emulator);
+  while (true) {
+    const int client = accept(self->mListenSocket, NULL, NULL);
+    if (client == -1) {
+      if (errno == EINTR)
+        continue;
+      perror("accept");
+      return NULL;
+    }
+
+    const int server = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(self->mServerPort);
+    if (server == -1 || connect(server, (struct sockaddr *)&address, sizeof(address)) == -1) {
+      perror("connect");
+      close(client);
+      if (server != -1)
+        close(server);
+      continue;
+    }
+
+    int noDelay = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(int));
+    setsockopt(server, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(int));
+    self->relay(client, server);
+    close(client);
+    close(server);
+  }
+  return NULL;
+}
+
+void LinkEmulator::relay(int client, int server) {
+  Direction directions[2];
+  directions[0].from = client;
+  directions[0].to = server;
+  directions[1].from = server;
+  directions[1].to = client;
+  for (int d = 0; d < 2; d++) {
+    directions[d].queuedBytes = 0;
+    directions[d].transmissionEnd = 0;
+    directions[d].lastDeliveryTime = 0;
+  }
+
+  while (true) {
+    const long long now = currentTime();
+    struct pollfd fds[2];
+    int timeout = -1;
+    for (int d = 0; d < 2; d++) {
+      fds[d].fd = directions[d].from;
+      fds[d].events = directions[d].queuedBytes < MAX_QUEUED_BYTES ? POLLIN : 0;
+      fds[d].revents = 0;
+      if (!directions[d].queue.empty()) {
+        const long long wait = directions[d].queue.front().deliveryTime - now;
+        const int milliseconds = wait <= 0 ? 0 : (int)((wait + 999) / 1000);
+        if (timeout == -1 || milliseconds < timeout)
+          timeout = milliseconds;
+      }
+    }
+
+    if (poll(fds, 2, timeout) == -1 && errno != EINTR) {
+      perror("poll");
+      return;
+    }
+
+    for (int d = 0; d < 2; d++) {
+      if ((fds[d].revents & (POLLIN | POLLHUP | POLLERR)) && !receive(&directions[d], currentTime()))
+        return;
+      if (!deliver(&directions[d], currentTime()))
+        return;
+    }
+  }
+}
+
+bool LinkEmulator::receive(Direction *direction, long long now) {
+  unsigned char buffer[16 * SEGMENT_SIZE];
+  const int n = recv(direction->from, buffer, sizeof(buffer), 0);
+  if (n <= 0)
+    return n == -1 && errno == EINTR;
+
+  for (int offset = 0; offset < n; offset += SEGMENT_SIZE) {
+    const int size = n - offset < SEGMENT_SIZE ? n - offset : SEGMENT_SIZE;
+    Segment segment;
+    segment.data.assign(buffer + offset, buffer + offset + size);
+
+    // the segments are sent one after the other at the link bandwidth
+    long long start = now > direction->transmissionEnd ? now : direction->transmissionEnd;
+    if (mBandwidth > 0)
+      direction->transmissionEnd = start + 1000LL * 8 * size / mBandwidth;
+    else
+      direction->transmissionEnd = start;
+    segment.deliveryTime = direction->transmissionEnd + 1000LL * mLatency;
+    if (mLoss > 0.0 && rand() < mLoss * RAND_MAX)
+      segment.deliveryTime += RETRANSMISSION_TIMEOUT + 2000LL * mLatency;
+    // TCP delivers in order, a retransmitted segment delays the following ones
+    if (segment.deliveryTime < direction->lastDeliveryTime)
+      segment.deliveryTime = direction->lastDeliveryTime;
+    direction->lastDeliveryTime = segment.deliveryTime;
+
+    direction->queue.push_back(segment);
+    direction->queuedBytes += size;
+  }
+  return true;
+}
+
+bool LinkEmulator::deliver(Direction *direction, long long now) {
+  while (!direction->queue.empty() && direction->queue.front().deliveryTime <= now) {
+    const vector<unsigned char> &data = direction->queue.front().data;
+    size_t sent = 0;
+    while (sent < data.size()) {
+      const ssize_t w = send(direction->to, &data[sent], data.size() - sent, MSG_NOSIGNAL);
+      if (w == -1) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      sent += w;
+    }
+    direction->queuedBytes -= data.size();
+    direction->queue.pop_front();
+  }
+  return true;
+}
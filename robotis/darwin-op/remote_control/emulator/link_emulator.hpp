@@ -0,0 +1,67 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   TCP relay adding the latency, bandwidth and loss of a
+//                wireless link between the remote-control client and server
+
+#ifndef LINK_EMULATOR_HPP
+#define LINK_EMULATOR_HPP
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+// The data is cut into segments. Each segment is delayed by its transmission
+// time at the given bandwidth and by the one-way latency. A lost segment is
+// delivered after a retransmission timeout and, as in TCP, holds back the
+// segments following it. The relay stops reading when too much data is queued,
+// so that the sender sees its socket fill up as on a slow link.
+class LinkEmulator {
+public:
+  // latency in milliseconds (one way), bandwidth in kbit/s (0 for unlimited), loss as a probability per segment
+  LinkEmulator(int latency, int bandwidth, double loss);
+  virtual ~LinkEmulator();
+
+  // relays the connections accepted on listenPort to serverPort on the local host, in a thread
+  bool start(int listenPort, int serverPort);
+
+private:
+  struct Segment {
+    long long deliveryTime;
+    std::vector<unsigned char> data;
+  };
+
+  struct Direction {
+    int from;
+    int to;
+    std::deque<Segment> queue;
+    int queuedBytes;
+    long long transmissionEnd;
+    long long lastDeliveryTime;
+  };
+
+  static void *run(void *emulator);
+  void relay(int client, int server);
+  bool receive(Direction *direction, long long now);
+  bool deliver(Direction *direction, long long now);
+
+  int mLatency;
+  int mBandwidth;
+  double mLoss;
+  int mListenSocket;
+  int mServerPort;
+  pthread_t mThread;
+};
+
+#endif
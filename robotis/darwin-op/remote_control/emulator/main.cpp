@@ -0,0 +1,130 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Runs the remote-control server of the ROBOTIS OP2 on a plain
+//                Linux host, in front of an emulated robot and an emulated link
+
+#include "emulated_robot.hpp"
+#include "link_emulator.hpp"
+
+#include "../camera_streamer.hpp"
+#include "../remote_server.hpp"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+// with an emulated link, the server listens on these ports behind the link emulator
+#define INTERNAL_PORT_OFFSET 10000
+
+using namespace std;
+
+static void usage() {
+  cout << "Usage: remote_emulator [options]" << endl;
+  cout << "  --step <ms>             duration of a robot step (default 8)" << endl;
+  cout << "  --latency <ms>          one-way latency of the link (default 0)" << endl;
+  cout << "  --bandwidth <kbit/s>    bandwidth of the link (default unlimited)" << endl;
+  cout << "  --loss <percent>        probability to lose a TCP segment (default 0)" << endl;
+  cout << "  --sensors <file>        replays recorded sensor values, one step per line" << endl;
+  cout << "  --frame <file.jpg>      replays a 320x240 camera image, can be repeated" << endl;
+  cout << "  --zoom <width> <height> camera zoom factors, as the remote_control arguments" << endl;
+  cout << "  --fixed                 disables the adaptation of the camera stream" << endl;
+  cout << "  --gray                  streams grayscale images" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  setvbuf(stdout, NULL, _IONBF, 0);
+  setvbuf(stderr, NULL, _IONBF, 0);
+  // a client disconnecting while a reply is sent should not stop the emulator
+  signal(SIGPIPE, SIG_IGN);
+
+  int stepDuration = 8;
+  int latency = 0;
+  int bandwidth = 0;
+  double loss = 0.0;
+  int cameraWidthZoomFactor = 1;
+  int cameraHeightZoomFactor = 1;
+  bool adaptiveCamera = true;
+  bool grayscaleCamera = false;
+  const char *sensorRecording = NULL;
+  vector<const char *> frames;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--step") == 0 && hasValue)
+      stepDuration = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--latency") == 0 && hasValue)
+      latency = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--bandwidth") == 0 && hasValue)
+      bandwidth = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--loss") == 0 && hasValue)
+      loss = 0.01 * atof(argv[++i]);
+    else if (strcmp(argv[i], "--sensors") == 0 && hasValue)
+      sensorRecording = argv[++i];
+    else if (strcmp(argv[i], "--frame") == 0 && hasValue)
+      frames.push_back(argv[++i]);
+    else if (strcmp(argv[i], "--zoom") == 0 && i + 2 < argc) {
+      cameraWidthZoomFactor = atoi(argv[++i]);
+      cameraHeightZoomFactor = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--fixed") == 0)
+      adaptiveCamera = false;
+    else if (strcmp(argv[i], "--gray") == 0)
+      grayscaleCamera = true;
+    else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (stepDuration <= 0 || cameraWidthZoomFactor <= 0 || cameraHeightZoomFactor <= 0) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  EmulatedRobot robot(stepDuration);
+  if (sensorRecording && !robot.loadSensorRecording(sensorRecording))
+    return EXIT_FAILURE;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (!robot.loadFrame(frames[i]))
+      return EXIT_FAILURE;
+  }
+
+  // the link emulator takes the ports of the robot and relays to the server
+  int port = PORT;
+  int observerPort = OBSERVER_PORT;
+  LinkEmulator link(latency, bandwidth, loss);
+  if (latency > 0 || bandwidth > 0 || loss > 0.0) {
+    port += INTERNAL_PORT_OFFSET;
+    if (!link.start(PORT, port))
+      return EXIT_FAILURE;
+    cout << "Emulating a link with " << latency << " ms of latency, " << bandwidth << " kbit/s and " << 100 * loss
+         << "% of loss on port " << PORT << ", observers connect directly on port " << observerPort + INTERNAL_PORT_OFFSET
+         << endl;
+    observerPort += INTERNAL_PORT_OFFSET;
+  }
+
+  CameraStreamer cameraStreamer(EMULATED_CAMERA_WIDTH, EMULATED_CAMERA_HEIGHT, EMULATED_CAMERA_WIDTH / cameraWidthZoomFactor,
+                                EMULATED_CAMERA_HEIGHT / cameraHeightZoomFactor, adaptiveCamera, grayscaleCamera);
+
+  // unlike the robot, the emulator serves one session after the other
+  while (true) {
+    RemoteServer server(&robot, &cameraStreamer);
+    if (!server.open(port, observerPort))
+      return EXIT_FAILURE;
+    server.run();
+  }
+  return EXIT_SUCCESS;
+}
@@ -17,7 +17,7 @@
 #ifndef REMOTE_HPP
 #define REMOTE_HPP
 
-#define NMOTORS 20
+#include "remote_robot.hpp"
 
 #include <webots/Robot.hpp>
 
@@ -29,7 +29,7 @@ namespace webots {
   class Accelerometer;
   class Gyro;
 
-  class Remote : public Robot {
+  class Remote : public Robot, public RemoteRobot {
   public:
     Remote();
     virtual ~Remote();
@@ -0,0 +1,289 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Wire format of the ROBOTIS OP2 remote-control, shared by the
+//                remote_control server and the robotis-op2_tcpip plugin
+
+#ifndef REMOTE_PROTOCOL_HPP
+#define REMOTE_PROTOCOL_HPP
+
+// Requests (plugin -> robot):
+//   magic, total size (2 bytes, little endian), [sequence (4 bytes)], fields..., 0
+// Replies (robot -> plugin):
+//   magic, total size (4 bytes), [sequence (4 bytes)], fields..., 0
+// The sequence number is only present in the pipelined messages, the total size
+// includes the header and the final 0. Integers are big endian unless specified.
+//
+// Request fields and their reply, in the order they are sent:
+//   'D' keyframe (1 byte)      -> nothing, the sensor values are sent in a sensor block (see below)
+//   'M' handshake (1 byte)     -> [name length (1 byte), name], slot (1 byte), generation (int)
+//   'A'                        -> 3 ints (accelerometer)
+//   'G'                        -> 3 ints (gyro)
+//   'C'                        -> JPEG length (int), [quality, downscale, image flags (1 byte each)],
+//                                 followed by the JPEG image
+//   'L' index, value (3 bytes) -> nothing
+//   'S' index, motor fields... -> nothing
+//   'P' index                  -> 1 int (position sensor * 10000)
+//   'F' index                  -> 1 int (motor torque feedback * 10000)
+// Motor fields: 'p', 'v', 'a', 'm', 'f' followed by an int, 'c' followed by 3 ints, 't' followed by a
+// trajectory: count (1 byte), step duration (2 bytes, milliseconds), count varints.
+// The image parameters are only present in the pipelined replies, the JPEG image is
+// (camera width / downscale) x (camera height / downscale) and is empty when skipped.
+//
+// Sensor block: when the request starts with 'D', the values of the 'A', 'G', 'P' and 'F'
+// fields are not sent in place but in a block at the end of the reply:
+//   flags (1 byte), [change mask (1 bit per value)], varints...
+// In a keyframe every value is sent, otherwise the mask tells which values changed since
+// they were last sent and only their difference is sent. Both ends keep the last value
+// sent for each sensor slot; a keyframe is sent on request and periodically.
+//
+// Trajectories: the 't' field follows the 'p' field of the same motor. Its varints are the zigzag encoded
+// differences between the setpoints of the next steps, starting from the 'p' value, so that the setpoint
+// of step i + 1 is played i step durations after the step of the request. The robot plays one setpoint
+// per step when the motor has no 'p' field in the request, and on its own when the requests are late.
+// A 'p' field replaces the remaining setpoints, a 'p' field without 't' clears them.
+//
+// Shared memory: a client running on the same machine as the server may send 'M'. The server
+// answers with the name of its shared memory when the handshake byte is set, then with the slot
+// holding the snapshot of this step (see shared_snapshot.hpp), or NO_SHARED_SLOT when it cannot.
+// When a slot is given, the following 'A', 'G', 'P', 'F' and 'C' fields have no reply: the values
+// and the raw camera image are read from the slot, without JPEG compression.
+
+namespace remote_protocol {
+  enum Magic { LEGACY = 'W', PIPELINED = 'P' };
+
+  enum Tag {
+    DELTA_SENSORS = 'D',
+    SHARED_MEMORY = 'M',
+    ACCELEROMETER = 'A',
+    GYRO = 'G',
+    CAMERA = 'C',
+    LED = 'L',
+    MOTOR = 'S',
+    POSITION_SENSOR = 'P',
+    TORQUE_FEEDBACK = 'F',
+    MOTOR_POSITION = 'p',
+    MOTOR_VELOCITY = 'v',
+    MOTOR_ACCELERATION = 'a',
+    MOTOR_AVAILABLE_TORQUE = 'm',
+    MOTOR_CONTROL_PID = 'c',
+    MOTOR_TORQUE = 'f',
+    MOTOR_TRAJECTORY = 't'
+  };
+
+  enum ImageFlag { IMAGE_GRAYSCALE = 1, IMAGE_SKIPPED = 2 };
+
+  enum SensorBlockFlag { SENSOR_KEYFRAME = 1 };
+
+  // index of the last value sent for each sensor, shared by both ends
+  enum SensorSlot {
+    ACCELEROMETER_SLOT = 0,
+    GYRO_SLOT = 3,
+    POSITION_SENSOR_SLOT = 6,
+    TORQUE_FEEDBACK_SLOT = 26,
+    NUMBER_OF_SENSOR_SLOTS = 46
+  };
+
+  enum { SHARED_MEMORY_NAME_SIZE = 64, NO_SHARED_SLOT = 255 };
+
+  enum { MAX_TRAJECTORY_LENGTH = 16 };
+
+  enum {
+    NUMBER_OF_LEDS = 5,
+    NUMBER_OF_MOTORS = 20,
+    MAX_REQUEST_HEADER_SIZE = 7,
+    MAX_REPLY_HEADER_SIZE = 9,
+    // every sensor requested and every motor field sent
+    MAX_REQUEST_SIZE = MAX_REQUEST_HEADER_SIZE + 2 + 2 + 3 + 5 * NUMBER_OF_LEDS +
+                       NUMBER_OF_MOTORS * (2 + 5 * 5 + 13 + 4 + 5 * MAX_TRAJECTORY_LENGTH) + 2 * 2 * NUMBER_OF_MOTORS + 1,
+    // every sensor requested and the shared memory handshake, without the JPEG image,
+    // a varint takes at most 5 bytes
+    MAX_REPLY_SIZE_WITHOUT_IMAGE = MAX_REPLY_HEADER_SIZE + (1 + SHARED_MEMORY_NAME_SIZE + 1 + 4) + 4 + 3 + 1 +
+                                   (NUMBER_OF_SENSOR_SLOTS + 7) / 8 + 5 * NUMBER_OF_SENSOR_SLOTS + 1
+  };
+
+  inline bool isMagic(int c) { return c == LEGACY || c == PIPELINED; }
+  inline int requestHeaderSize(int magic) { return magic == PIPELINED ? 7 : 3; }
+  inline int replyHeaderSize(int magic) { return magic == PIPELINED ? 9 : 5; }
+  // the JPEG image cannot be bigger than the raw RGB image
+  inline int maxReplySize(int width, int height) { return MAX_REPLY_SIZE_WITHOUT_IMAGE + 3 * width * height; }
+
+  inline bool isMotorField(int c) {
+    return c == MOTOR_POSITION || c == MOTOR_VELOCITY || c == MOTOR_ACCELERATION || c == MOTOR_AVAILABLE_TORQUE ||
+           c == MOTOR_CONTROL_PID || c == MOTOR_TORQUE || c == MOTOR_TRAJECTORY;
+  }
+
+  // signed values are zigzag encoded so that small differences give short varints
+  inline unsigned int zigzag(int value) { return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31); }
+  inline int unzigzag(unsigned int value) { return (int)(value >> 1) ^ -(int)(value & 1); }
+
+  inline void writeInt(unsigned char *buffer, int value) {
+    buffer[0] = (value >> 24) & 0xFF;
+    buffer[1] = (value >> 16) & 0xFF;
+    buffer[2] = (value >> 8) & 0xFF;
+    buffer[3] = value & 0xFF;
+  }
+
+  inline int readInt(const unsigned char *buffer) {
+    return buffer[3] + (buffer[2] << 8) + (buffer[1] << 16) + (buffer[0] << 24);
+  }
+
+  // Serializes into a buffer owned by the caller, nothing is allocated.
+  // Writing past the capacity is ignored and reported by overflow().
+  class PacketWriter {
+  public:
+    PacketWriter(unsigned char *buffer, int capacity) : mBuffer(buffer), mCapacity(capacity), mSize(0), mOverflow(false) {}
+
+    void reset() {
+      mSize = 0;
+      mOverflow = false;
+    }
+    int size() const { return mSize; }
+    bool overflow() const { return mOverflow; }
+    unsigned char *data() { return mBuffer; }
+
+    void writeByte(int value) {
+      if (reserve(1))
+        mBuffer[mSize++] = value & 0xFF;
+    }
+    void writeInt(int value) {
+      if (reserve(4)) {
+        remote_protocol::writeInt(mBuffer + mSize, value);
+        mSize += 4;
+      }
+    }
+    void writeVarint(unsigned int value) {
+      while (value >= 0x80) {
+        writeByte(value | 0x80);
+        value >>= 7;
+      }
+      writeByte(value);
+    }
+    void writeIntAt(int position, int value) {
+      if (position + 4 <= mSize)
+        remote_protocol::writeInt(mBuffer + position, value);
+    }
+
+  private:
+    bool reserve(int size) {
+      if (mSize + size > mCapacity)
+        mOverflow = true;
+      return !mOverflow;
+    }
+
+    unsigned char *mBuffer;
+    int mCapacity;
+    int mSize;
+    bool mOverflow;
+  };
+
+  // Reads from a buffer owned by the caller, reading past the end returns 0 and is reported by overflow().
+  class PacketReader {
+  public:
+    PacketReader(const unsigned char *data, int size) : mData(data), mSize(size), mPosition(0), mOverflow(false) {}
+
+    int position() const { return mPosition; }
+    int remaining() const { return mSize - mPosition; }
+    bool overflow() const { return mOverflow; }
+    const unsigned char *current() const { return mData + mPosition; }
+
+    int peek() const { return mPosition < mSize ? mData[mPosition] : 0; }
+    int readByte() { return reserve(1) ? mData[mPosition++] : 0; }
+    int readInt() {
+      if (!reserve(4))
+        return 0;
+      mPosition += 4;
+      return remote_protocol::readInt(mData + mPosition - 4);
+    }
+    unsigned int readVarint() {
+      unsigned int value = 0;
+      for (int shift = 0; shift < 35; shift += 7) {
+        const int c = readByte();
+        value |= (unsigned int)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+          break;
+      }
+      return value;
+    }
+    void skip(int size) {
+      if (reserve(size))
+        mPosition += size;
+    }
+
+  private:
+    bool reserve(int size) {
+      if (size < 0 || mPosition + size > mSize)
+        mOverflow = true;
+      return !mOverflow;
+    }
+
+    const unsigned char *mData;
+    int mSize;
+    int mPosition;
+    bool mOverflow;
+  };
+
+  inline void skipMotorField(PacketReader *reader) {
+    const int field = reader->readByte();
+    if (field == MOTOR_TRAJECTORY) {
+      const int count = reader->readByte();
+      reader->skip(2);
+      for (int i = 0; i < count; i++)
+        reader->readVarint();
+    } else
+      reader->skip(field == MOTOR_CONTROL_PID ? 12 : 4);
+  }
+
+  // writes the values of the given sensor slots and updates the last values sent
+  inline void writeSensorBlock(PacketWriter *writer, int *lastValues, const int *slots, const int *values, int count,
+                               bool keyframe) {
+    writer->writeByte(keyframe ? SENSOR_KEYFRAME : 0);
+    if (!keyframe) {
+      for (int i = 0; i < count; i += 8) {
+        int mask = 0;
+        for (int j = i; j < count && j < i + 8; j++) {
+          if (values[j] != lastValues[slots[j]])
+            mask |= 1 << (j - i);
+        }
+        writer->writeByte(mask);
+      }
+    }
+    for (int i = 0; i < count; i++) {
+      if (keyframe)
+        writer->writeVarint(zigzag(values[i]));
+      else if (values[i] != lastValues[slots[i]])
+        writer->writeVarint(zigzag((int)((unsigned int)values[i] - (unsigned int)lastValues[slots[i]])));
+      lastValues[slots[i]] = values[i];
+    }
+  }
+
+  // reads the values of the given sensor slots and updates the last values received
+  inline void readSensorBlock(PacketReader *reader, int *lastValues, const int *slots, int *values, int count) {
+    const bool keyframe = reader->readByte() & SENSOR_KEYFRAME;
+    const unsigned char *mask = reader->current();
+    if (!keyframe)
+      reader->skip((count + 7) / 8);
+    for (int i = 0; i < count; i++) {
+      if (keyframe)
+        values[i] = unzigzag(reader->readVarint());
+      else if (!reader->overflow() && (mask[i / 8] & (1 << (i % 8))))
+        values[i] = (int)((unsigned int)lastValues[slots[i]] + (unsigned int)unzigzag(reader->readVarint()));
+      else
+        values[i] = lastValues[slots[i]];
+      lastValues[slots[i]] = values[i];
+    }
+  }
+}  // namespace remote_protocol
+
+#endif
@@ -0,0 +1,45 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Devices of the robot served by the remote-control server,
+//                implemented by the real robot and by the emulator
+
+#ifndef REMOTE_ROBOT_HPP
+#define REMOTE_ROBOT_HPP
+
+#define NMOTORS 20
+
+// The values use the units of the wire format (see remote_protocol.hpp).
+class RemoteRobot {
+public:
+  virtual ~RemoteRobot() {}
+
+  virtual void remoteStep() = 0;
+
+  virtual const double *getRemoteAccelerometer() const = 0;
+  virtual const double *getRemoteGyro() const = 0;
+  virtual const unsigned char *getRemoteImage() const = 0;  // 320x240 BGRA
+  virtual double getRemotePositionSensor(int index) = 0;
+  virtual double getRemoteMotorTorque(int index) = 0;
+
+  virtual void setRemoteLED(int index, int value) = 0;
+  virtual void setRemoteMotorPosition(int index, int value) = 0;
+  virtual void setRemoteMotorVelocity(int index, int value) = 0;
+  virtual void setRemoteMotorAcceleration(int index, int value) = 0;
+  virtual void setRemoteMotorAvailableTorque(int index, int value) = 0;
+  virtual void setRemoteMotorTorque(int index, int value) = 0;
+  virtual void setRemoteMotorControlPID(int index, int p, int i, int d) = 0;
+};
+
+#endif
@@ -0,0 +1,735 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_server.hpp"
+
+#include "camera_streamer.hpp"
+#include "remote_robot.hpp"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <iostream>
+
+#define closesocket(s) close(s)
+
+typedef struct sockaddr_in SOCKADDR_IN;
+typedef struct sockaddr SOCKADDR;
+
+#define MAX_EVENTS 16
+
+using namespace std;
+
+// in microseconds, not affected by the changes of the system time
+static long long currentTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+RemoteServer::RemoteServer(RemoteRobot *remote, CameraStreamer *cameraStreamer) :
+  mRemote(remote),
+  mCameraStreamer(cameraStreamer),
+  mControllerSocket(-1),
+  mObserverSocket(-1),
+  mEpoll(-1),
+  mStopped(false),
+  mController(NULL),
+  mGeneration(0),
+  mImageGeneration(-1),
+  mImageAdaptive(false),
+  mImageLength(0),
+  mTrajectoryStep(0),
+  mNextPlayoutTime(-1),
+  mStepsAhead(0),
+  mPlayedSteps(0),
+  mSharedRegion(NULL),
+  mSharedGeneration(-1) {
+  memset(mSensorValues, 0, sizeof(mSensorValues));
+  memset(mTrajectories, 0, sizeof(mTrajectories));
+  mSharedMemoryName[0] = '\0';
+}
+
+RemoteServer::~RemoteServer() {
+  for (map<int, Client *>::iterator it = mClients.begin(); it != mClients.end(); ++it) {
+    closesocket(it->first);
+    delete it->second;
+  }
+  if (mEpoll != -1)
+    close(mEpoll);
+  if (mObserverSocket != -1)
+    closesocket(mObserverSocket);
+  if (mPlayedSteps > 0)
+    cout << mPlayedSteps << " steps played from the trajectories while the requests were late" << endl;
+  if (mControllerSocket != -1) {
+    cout << "Closing server socket" << endl;
+    closesocket(mControllerSocket);
+  }
+  if (mSharedRegion) {
+    munmap(mSharedRegion, sizeof(remote_protocol::SharedRegion));
+    shm_unlink(mSharedMemoryName);
+  }
+}
+
+bool RemoteServer::open(int port, int observerPort) {
+  mEpoll = epoll_create(MAX_EVENTS);
+  if (mEpoll == -1) {
+    perror("epoll_create");
+    return false;
+  }
+  mControllerSocket = listen(port);
+  if (mControllerSocket == -1)
+    return false;
+  // the robot can still be controlled without observers and without shared memory
+  mObserverSocket = listen(observerPort);
+  createSharedMemory(port);
+  cout << "Waiting for client connection on port " << port << "..." << endl;
+  return true;
+}
+
+int RemoteServer::listen(int port) {
+  SOCKADDR_IN sin;
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock == -1) {
+    perror("socket");
+    return -1;
+  }
+
+  // Configuration
+  sin.sin_addr.s_addr = htonl(INADDR_ANY);     // Adresse IP automatic
+  sin.sin_family = AF_INET;                    // Protocole familial (IP)
+  sin.sin_port = htons(port);                  // Listening of the port
+  bzero(&sin.sin_zero, sizeof(sin.sin_zero));  // make sure the zero are correctly initialized
+
+  int opt = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&opt, sizeof(int));
+
+  if (bind(sock, (SOCKADDR *)&sin, sizeof(sin)) == -1) {
+    perror("bind");
+    closesocket(sock);
+    return -1;
+  }
+  if (::listen(sock, 4) == -1) {
+    perror("listen");
+    closesocket(sock);
+    return -1;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = sock;
+  if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, sock, &event) == -1) {
+    perror("epoll_ctl");
+    closesocket(sock);
+    return -1;
+  }
+  return sock;
+}
+
+void RemoteServer::run() {
+  mRemote->remoteStep();
+  takeSnapshot();
+
+  struct epoll_event events[MAX_EVENTS];
+  while (!mStopped) {
+    const int n = epoll_wait(mEpoll, events, MAX_EVENTS, playoutTimeout());
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      perror("epoll_wait");
+      break;
+    }
+
+    for (int i = 0; i < n; i++) {
+      const int fd = events[i].data.fd;
+      if (fd == mControllerSocket || fd == mObserverSocket) {
+        accept(fd);
+        continue;
+      }
+      map<int, Client *>::iterator it = mClients.find(fd);
+      if (it == mClients.end() || it->second->disconnected)
+        continue;
+      if (events[i].events & EPOLLOUT)
+        flush(it->second);
+      // a hang up or an error is reported by recv()
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        receive(it->second);
+    }
+
+    serveController();
+    playTrajectories();
+    serveObservers();
+    removeDisconnectedClients();
+  }
+}
+
+void RemoteServer::accept(int listenSocket) {
+  SOCKADDR_IN csin;
+  socklen_t crecsize = sizeof(csin);
+  int csock = ::accept(listenSocket, (SOCKADDR *)&csin, &crecsize);
+  if (csock == -1) {
+    perror("accept");
+    return;
+  }
+
+  const bool controller = listenSocket == mControllerSocket;
+  if (controller && mController) {
+    cerr << "Error: a client is already controlling the robot" << endl;
+    closesocket(csock);
+    return;
+  }
+
+  fcntl(csock, F_SETFL, fcntl(csock, F_GETFL) | O_NONBLOCK);
+  // the replies are sent as soon as they are ready, they should not be delayed by the Nagle algorithm
+  int noDelay = 1;
+  setsockopt(csock, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(int));
+
+  // the client is on the same machine if it connected to one of its own addresses
+  SOCKADDR_IN local;
+  socklen_t localSize = sizeof(local);
+  const bool isLocal = getsockname(csock, (SOCKADDR *)&local, &localSize) == 0 &&
+                       local.sin_addr.s_addr == csin.sin_addr.s_addr;
+
+  Client *client = new Client;
+  client->socket = csock;
+  client->controller = controller;
+  client->local = isLocal;
+  client->disconnected = false;
+  client->received = 0;
+  client->pending.reserve(remote_protocol::MAX_REPLY_SIZE_WITHOUT_IMAGE + mCameraStreamer->capacity());
+  client->pendingOffset = 0;
+  client->servedGeneration = -1;
+  memset(client->lastSensorValues, 0, sizeof(client->lastSensorValues));
+  client->repliesSinceKeyframe = SENSOR_KEYFRAME_PERIOD;
+  mClients[csock] = client;
+  if (controller)
+    mController = client;
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = csock;
+  if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, csock, &event) == -1) {
+    perror("epoll_ctl");
+    disconnect(client);
+    return;
+  }
+  cout << (controller ? "Client connected." : "Observer connected.") << endl;
+}
+
+void RemoteServer::receive(Client *client) {
+  while (client->received < RECEIVE_BUFFER_SIZE) {
+    const int r = recv(client->socket, &client->receiveBuffer[client->received], RECEIVE_BUFFER_SIZE - client->received, 0);
+    if (r > 0)
+      client->received += r;
+    else if (r == -1 && errno == EINTR)
+      continue;
+    else if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    else {
+      disconnect(client);
+      return;
+    }
+  }
+  updateEvents(client);
+}
+
+void RemoteServer::flush(Client *client) {
+  while (client->pendingOffset < (int)client->pending.size()) {
+    const int w = write(client->socket, &client->pending[client->pendingOffset],
+                        client->pending.size() - client->pendingOffset);
+    if (w >= 0)
+      client->pendingOffset += w;
+    else if (errno == EINTR)
+      continue;
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+    else {
+      disconnect(client);
+      return;
+    }
+  }
+  if (client->pendingOffset == (int)client->pending.size()) {
+    client->pending.clear();
+    client->pendingOffset = 0;
+  }
+  updateEvents(client);
+}
+
+void RemoteServer::send(Client *client, struct iovec *vector, int count) {
+  // most of the time the socket accepts the whole reply and nothing is copied
+  while (count > 0) {
+    ssize_t n = writev(client->socket, vector, count);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      perror("writev");
+      disconnect(client);
+      return;
+    }
+    // skip what has already been sent
+    while (count > 0 && n >= (ssize_t)vector->iov_len) {
+      n -= vector->iov_len;
+      vector++;
+      count--;
+    }
+    if (count > 0) {
+      vector->iov_base = (char *)vector->iov_base + n;
+      vector->iov_len -= n;
+    }
+  }
+
+  // otherwise the rest is kept until the socket is writable again
+  for (int i = 0; i < count; i++) {
+    const unsigned char *data = (const unsigned char *)vector[i].iov_base;
+    client->pending.insert(client->pending.end(), data, data + vector[i].iov_len);
+  }
+  updateEvents(client);
+}
+
+void RemoteServer::updateEvents(Client *client) {
+  if (client->disconnected)
+    return;
+  // a full receive buffer is not read until its requests are handled
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = (client->received < RECEIVE_BUFFER_SIZE ? EPOLLIN : 0) | (client->pending.empty() ? 0 : EPOLLOUT);
+  event.data.fd = client->socket;
+  epoll_ctl(mEpoll, EPOLL_CTL_MOD, client->socket, &event);
+}
+
+void RemoteServer::disconnect(Client *client) {
+  if (client->disconnected)
+    return;
+  client->disconnected = true;
+  epoll_ctl(mEpoll, EPOLL_CTL_DEL, client->socket, NULL);
+  if (client->controller) {
+    cout << "Client disconnected." << endl;
+    mStopped = true;
+  } else
+    cout << "Observer disconnected." << endl;
+}
+
+void RemoteServer::removeDisconnectedClients() {
+  map<int, Client *>::iterator it = mClients.begin();
+  while (it != mClients.end()) {
+    Client *client = it->second;
+    if (client->disconnected) {
+      if (client == mController)
+        mController = NULL;
+      closesocket(client->socket);
+      delete client;
+      mClients.erase(it++);
+    } else
+      ++it;
+  }
+}
+
+void RemoteServer::serveController() {
+  // each request of the controlling client steps the robot, the observers get the new snapshot in between
+  while (mController && !mController->disconnected && mController->pending.empty()) {
+    const int total = requestSize(mController);
+    if (total == 0)
+      break;
+    handleRequest(mController, total);
+    bool moving;
+    if (mStepsAhead > 0) {
+      // the robot already played this step while the request was late
+      mStepsAhead--;
+      moving = advanceTrajectories(false);
+    } else {
+      moving = advanceTrajectories(true);
+      step();
+    }
+    // the robot waits a bit longer than a step for the next request before going on on its own
+    mNextPlayoutTime = moving && mTrajectoryStep > 0 ? currentTime() + 3 * mTrajectoryStep / 2 : -1;
+  }
+  if (mController && !mController->disconnected)
+    updateEvents(mController);
+}
+
+void RemoteServer::serveObservers() {
+  for (map<int, Client *>::iterator it = mClients.begin(); it != mClients.end(); ++it) {
+    Client *client = it->second;
+    // a slow observer skips the snapshots taken while its last reply was still being sent
+    if (client->controller || client->disconnected || !client->pending.empty() ||
+        client->servedGeneration == mGeneration)
+      continue;
+    const int total = requestSize(client);
+    if (total == 0)
+      continue;
+    handleRequest(client, total);
+    client->servedGeneration = mGeneration;
+    updateEvents(client);
+  }
+}
+
+int RemoteServer::requestSize(Client *client) {
+  if (client->received < 3)
+    return 0;
+  const int magic = client->receiveBuffer[0];
+  if (!remote_protocol::isMagic(magic)) {
+    cerr << "Error: wrong TCP message received" << endl;
+    client->received = 0;
+    return 0;
+  }
+  const int total = client->receiveBuffer[1] + client->receiveBuffer[2] * 256;
+  if (total < remote_protocol::requestHeaderSize(magic) || total > RECEIVE_BUFFER_SIZE) {
+    cerr << "Error: wrong TCP message size received" << endl;
+    client->received = 0;
+    return 0;
+  }
+  return client->received >= total ? total : 0;
+}
+
+void RemoteServer::handleRequest(Client *client, int total) {
+  const int magic = client->receiveBuffer[0];
+  remote_protocol::PacketReader request(client->receiveBuffer, total);
+  request.skip(3);
+  remote_protocol::PacketWriter reply(mSendBuffer, sizeof(mSendBuffer));
+  reply.writeByte(magic);
+  reply.writeInt(0);  // the total size of the reply will be stored here
+  if (magic == remote_protocol::PIPELINED)
+    reply.writeInt(request.readInt());  // the sequence number is sent back with the reply
+
+  // the JPEG image is inserted after the first imagePosition bytes of the reply
+  int imagePosition = -1;
+  int imageLength = 0;
+
+  // with shared memory, the sensor values and the image are not sent but published in a slot
+  bool shared = false;
+
+  // in delta mode, the sensor values are gathered and sent in a block at the end of the reply
+  bool deltaSensors = false;
+  bool sensorKeyframe = false;
+  int sensorSlots[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  int sensorValues[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  int sensorCount = 0;
+
+  // the request is terminated by a final 0 (see RobotisOp2OutputPacket::apply())
+  while (request.peek() != 0) {
+    const int tag = request.readByte();
+    int sensorSlot = -1;
+    int sensorValueCount = 1;
+    switch (tag) {
+      case remote_protocol::DELTA_SENSORS:
+        deltaSensors = true;
+        sensorKeyframe = request.readByte() != 0 || client->repliesSinceKeyframe >= SENSOR_KEYFRAME_PERIOD;
+        break;
+      case remote_protocol::SHARED_MEMORY: {
+        const bool handshake = request.readByte() != 0;
+        shared = mSharedRegion && client->local;
+        if (handshake) {
+          const int length = shared ? strlen(mSharedMemoryName) : 0;
+          reply.writeByte(length);
+          for (int c = 0; c < length; c++)
+            reply.writeByte(mSharedMemoryName[c]);
+        }
+        // the snapshot is published once the whole request is known
+        reply.writeByte(shared ? mGeneration % remote_protocol::SHARED_SNAPSHOT_SLOTS : remote_protocol::NO_SHARED_SLOT);
+        reply.writeInt(mGeneration);
+        break;
+      }
+      case remote_protocol::ACCELEROMETER:
+        sensorSlot = remote_protocol::ACCELEROMETER_SLOT;
+        sensorValueCount = 3;
+        break;
+      case remote_protocol::GYRO:
+        sensorSlot = remote_protocol::GYRO_SLOT;
+        sensorValueCount = 3;
+        break;
+      case remote_protocol::CAMERA:
+        if (shared)
+          break;
+        imageLength = encodeImage(magic == remote_protocol::PIPELINED);
+        reply.writeInt(imageLength);
+        if (magic == remote_protocol::PIPELINED) {
+          reply.writeByte(mCameraStreamer->quality());
+          reply.writeByte(mCameraStreamer->downscale());
+          reply.writeByte((mCameraStreamer->isGrayscale() ? remote_protocol::IMAGE_GRAYSCALE : 0) |
+                          (mCameraStreamer->isSkipped() ? remote_protocol::IMAGE_SKIPPED : 0));
+        }
+        imagePosition = reply.size();
+        break;
+      case remote_protocol::LED: {
+        const int index = request.readByte();
+        int value = request.readByte() << 16;
+        value += request.readByte() << 8;
+        value += request.readByte();
+        if (client->controller)
+          mRemote->setRemoteLED(index, value);
+        break;
+      }
+      case remote_protocol::MOTOR: {
+        const int index = request.readByte();
+        while (remote_protocol::isMotorField(request.peek())) {
+          if (client->controller)
+            applyMotorField(index, &request);
+          else
+            remote_protocol::skipMotorField(&request);
+        }
+        break;
+      }
+      case remote_protocol::POSITION_SENSOR: {
+        const int index = request.readByte();
+        if (index < NMOTORS)
+          sensorSlot = remote_protocol::POSITION_SENSOR_SLOT + index;
+        else if (!deltaSensors && !shared)
+          reply.writeInt(0);
+        break;
+      }
+      case remote_protocol::TORQUE_FEEDBACK: {
+        const int index = request.readByte();
+        if (index < NMOTORS)
+          sensorSlot = remote_protocol::TORQUE_FEEDBACK_SLOT + index;
+        else if (!deltaSensors && !shared)
+          reply.writeInt(0);
+        break;
+      }
+      default:
+        cerr << "Error: received unknown message: " << (char)tag << endl;
+        request.skip(request.remaining());
+        break;
+    }
+
+    for (int c = 0; sensorSlot >= 0 && !shared && c < sensorValueCount; c++) {
+      if (!deltaSensors)
+        reply.writeInt(mSensorValues[sensorSlot + c]);
+      else if (sensorCount < remote_protocol::NUMBER_OF_SENSOR_SLOTS) {
+        sensorSlots[sensorCount] = sensorSlot + c;
+        sensorValues[sensorCount++] = mSensorValues[sensorSlot + c];
+      }
+    }
+  }
+  if (request.overflow())
+    cerr << "Error: truncated TCP message received" << endl;
+
+  if (shared)
+    publishSharedSnapshot();
+
+  if (deltaSensors) {
+    remote_protocol::writeSensorBlock(&reply, client->lastSensorValues, sensorSlots, sensorValues, sensorCount,
+                                      sensorKeyframe);
+    client->repliesSinceKeyframe = sensorKeyframe ? 0 : client->repliesSinceKeyframe + 1;
+  }
+
+  // Terminate the reply and send it, the size includes the final 0 and the image
+  reply.writeByte(0);
+  reply.writeIntAt(1, reply.size() + imageLength);
+  struct iovec vector[3];
+  int count = 1;
+  vector[0].iov_base = mSendBuffer;
+  vector[0].iov_len = reply.size();
+  if (imagePosition >= 0) {
+    vector[0].iov_len = imagePosition;
+    vector[1].iov_base = (void *)mCameraStreamer->jpeg();
+    vector[1].iov_len = imageLength;
+    vector[2].iov_base = mSendBuffer + imagePosition;
+    vector[2].iov_len = reply.size() - imagePosition;
+    count = 3;
+  }
+
+  // keep the following requests already received
+  client->received -= total;
+  memmove(client->receiveBuffer, client->receiveBuffer + total, client->received);
+
+  send(client, vector, count);
+}
+
+void RemoteServer::applyMotorField(int index, remote_protocol::PacketReader *request) {
+  const int field = request->readByte();
+  if (field == remote_protocol::MOTOR_TRAJECTORY) {
+    readTrajectory(index, request);
+    return;
+  }
+  const int value = request->readInt();
+  if (index >= NMOTORS)
+    return;
+  switch (field) {
+    case remote_protocol::MOTOR_POSITION: {
+      // the setpoint of a late request is outdated but is still the best guess until the next step
+      mRemote->setRemoteMotorPosition(index, value);
+      Trajectory *trajectory = &mTrajectories[index];
+      trajectory->next = 0;
+      trajectory->count = 0;
+      trajectory->origin = value;
+      trajectory->replaced = true;
+      break;
+    }
+    case remote_protocol::MOTOR_VELOCITY:
+      mRemote->setRemoteMotorVelocity(index, value);
+      break;
+    case remote_protocol::MOTOR_ACCELERATION:
+      mRemote->setRemoteMotorAcceleration(index, value);
+      break;
+    case remote_protocol::MOTOR_AVAILABLE_TORQUE:
+      mRemote->setRemoteMotorAvailableTorque(index, value);
+      break;
+    case remote_protocol::MOTOR_CONTROL_PID: {
+      const int i = request->readInt();
+      const int d = request->readInt();
+      mRemote->setRemoteMotorControlPID(index, value, i, d);
+      break;
+    }
+    case remote_protocol::MOTOR_TORQUE:
+      mRemote->setRemoteMotorTorque(index, value);
+      break;
+  }
+}
+
+void RemoteServer::readTrajectory(int index, remote_protocol::PacketReader *request) {
+  const int count = request->readByte();
+  const int stepDuration = (request->readByte() << 8) + request->readByte();
+  if (stepDuration > 0)
+    mTrajectoryStep = 1000 * stepDuration;
+  Trajectory *trajectory = index < NMOTORS ? &mTrajectories[index] : NULL;
+  // the robot is ahead of a late request, its trajectory starts at the next step of the robot
+  const int skipped = mStepsAhead > 0 ? mStepsAhead - 1 : 0;
+  int setpoint = trajectory ? trajectory->origin : 0;
+  for (int i = 0; i < count; i++) {
+    setpoint += remote_protocol::unzigzag(request->readVarint());
+    if (trajectory && i >= skipped && trajectory->count < remote_protocol::MAX_TRAJECTORY_LENGTH)
+      trajectory->setpoints[trajectory->count++] = setpoint;
+  }
+}
+
+bool RemoteServer::advanceTrajectories(bool play) {
+  // the motors without a new setpoint in the request move to the next setpoint of their trajectory
+  bool remaining = false;
+  for (int i = 0; i < NMOTORS; i++) {
+    Trajectory *trajectory = &mTrajectories[i];
+    if (play && !trajectory->replaced && trajectory->next < trajectory->count)
+      mRemote->setRemoteMotorPosition(i, trajectory->setpoints[trajectory->next++]);
+    trajectory->replaced = false;
+    if (trajectory->next < trajectory->count)
+      remaining = true;
+  }
+  return remaining;
+}
+
+void RemoteServer::playTrajectories() {
+  if (mNextPlayoutTime < 0 || currentTime() < mNextPlayoutTime || mStopped)
+    return;
+  // the request of this step is late, the robot goes on with the setpoints it already received
+  const bool moving = advanceTrajectories(true);
+  step();
+  mStepsAhead++;
+  mPlayedSteps++;
+  mNextPlayoutTime = moving ? mNextPlayoutTime + mTrajectoryStep : -1;
+}
+
+int RemoteServer::playoutTimeout() const {
+  if (mNextPlayoutTime < 0)
+    return -1;
+  const long long remaining = mNextPlayoutTime - currentTime();
+  return remaining > 0 ? (int)((remaining + 999) / 1000) : 0;
+}
+
+void RemoteServer::step() {
+  mRemote->remoteStep();
+  takeSnapshot();
+  serveObservers();
+}
+
+void RemoteServer::takeSnapshot() {
+  const double *acc = mRemote->getRemoteAccelerometer();
+  const double *gyro = mRemote->getRemoteGyro();
+  for (int c = 0; c < 3; c++) {
+    mSensorValues[remote_protocol::ACCELEROMETER_SLOT + c] = (int)acc[c];
+    mSensorValues[remote_protocol::GYRO_SLOT + c] = (int)gyro[c];
+  }
+  for (int i = 0; i < NMOTORS; i++) {
+    mSensorValues[remote_protocol::POSITION_SENSOR_SLOT + i] = (int)mRemote->getRemotePositionSensor(i);
+    mSensorValues[remote_protocol::TORQUE_FEEDBACK_SLOT + i] = (int)mRemote->getRemoteMotorTorque(i);
+  }
+  mGeneration++;
+}
+
+int RemoteServer::encodeImage(bool adaptive) {
+  // the image of a snapshot is encoded once and sent to every client asking for it
+  if (mImageGeneration == mGeneration && mImageAdaptive == adaptive)
+    return mImageLength;
+
+  if (adaptive) {
+    // the stream adapts to the link of the controlling client, not to the observers
+    int pendingBytes = 0;
+    if (!mController || ioctl(mController->socket, SIOCOUTQ, &pendingBytes) == -1)
+      pendingBytes = 0;
+    mImageLength = mCameraStreamer->encode(mRemote->getRemoteImage(), pendingBytes);
+  } else
+    mImageLength = mCameraStreamer->encodeFixed(mRemote->getRemoteImage());
+  mImageGeneration = mGeneration;
+  mImageAdaptive = adaptive;
+  return mImageLength;
+}
+
+void RemoteServer::createSharedMemory(int port) {
+  snprintf(mSharedMemoryName, sizeof(mSharedMemoryName), "/robotis-op2-remote-%d", port);
+  // a region left by a previous server which did not exit cleanly is replaced
+  shm_unlink(mSharedMemoryName);
+  const int fd = shm_open(mSharedMemoryName, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd == -1) {
+    perror("shm_open");
+    return;
+  }
+  // the server usually runs as root, the clients only need to read
+  fchmod(fd, 0644);
+  void *region = MAP_FAILED;
+  if (ftruncate(fd, sizeof(remote_protocol::SharedRegion)) == 0)
+    region = mmap(NULL, sizeof(remote_protocol::SharedRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (region == MAP_FAILED) {
+    perror("mmap");
+    shm_unlink(mSharedMemoryName);
+    return;
+  }
+
+  mSharedRegion = static_cast<remote_protocol::SharedRegion *>(region);
+  memset(mSharedRegion, 0, sizeof(remote_protocol::SharedRegion));
+  mSharedRegion->slotCount = remote_protocol::SHARED_SNAPSHOT_SLOTS;
+  for (int i = 0; i < remote_protocol::SHARED_SNAPSHOT_SLOTS; i++)
+    mSharedRegion->slots[i].generation = -1;
+  __sync_synchronize();
+  mSharedRegion->magic = remote_protocol::SHARED_REGION_MAGIC;
+}
+
+void RemoteServer::publishSharedSnapshot() {
+  // A slot is written once per generation, with the image even if this client does not need it: rewriting
+  // it for a later client would make the readers of the first write fail while it is copied.
+  if (mSharedGeneration == mGeneration)
+    return;
+  remote_protocol::SharedSnapshot *snapshot =
+    &mSharedRegion->slots[mGeneration % remote_protocol::SHARED_SNAPSHOT_SLOTS];
+  remote_protocol::writeSharedSnapshot(snapshot, mGeneration, mSensorValues,
+                                       mCameraStreamer->cropOrigin(mRemote->getRemoteImage()),
+                                       mCameraStreamer->cropWidth(), mCameraStreamer->cropHeight(),
+                                       mCameraStreamer->stride());
+  mSharedGeneration = mGeneration;
+}
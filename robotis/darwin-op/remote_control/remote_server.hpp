@@ -0,0 +1,137 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Event-driven server of the ROBOTIS OP2 remote-control, serving
+//                one controlling client and any number of read-only observers
+
+#ifndef REMOTE_SERVER_HPP
+#define REMOTE_SERVER_HPP
+
+#include "remote_protocol.hpp"
+#include "shared_snapshot.hpp"
+
+#include <sys/uio.h>
+#include <map>
+#include <vector>
+
+// the controlling client (Webots) connects on this port
+#define PORT 5023
+// observers (loggers, dashboards, ...) connect on this port, their actuator commands are ignored
+#define OBSERVER_PORT 5024
+// a pipelined client may send several requests at once
+#define RECEIVE_BUFFER_SIZE (4 * remote_protocol::MAX_REQUEST_SIZE)
+// number of replies between two sensor keyframes
+#define SENSOR_KEYFRAME_PERIOD 250
+
+class CameraStreamer;
+class RemoteRobot;
+
+// Only the controlling client steps the robot. After each step, the sensor values are read
+// once into a snapshot shared by all the clients, and the camera image is encoded at most once
+// and sent to every client asking for it. The sockets are non-blocking: a client that does not
+// read its replies fast enough keeps the rest of its last reply and is not served again until
+// it has received it, so that observers never slow down the controlling client.
+// Clients on the same machine may read the snapshots from shared memory instead.
+// When the requests of the controlling client are late, the robot keeps stepping on its own with
+// the trajectories already received, and the late requests catch up without stepping it again.
+class RemoteServer {
+public:
+  RemoteServer(RemoteRobot *remote, CameraStreamer *cameraStreamer);
+  virtual ~RemoteServer();
+
+  bool open(int port = PORT, int observerPort = OBSERVER_PORT);
+  // returns when the controlling client disconnects
+  void run();
+
+private:
+  struct Client {
+    int socket;
+    bool controller;
+    bool local;  // on the same machine, may use the shared memory
+    bool disconnected;
+    unsigned char receiveBuffer[RECEIVE_BUFFER_SIZE];
+    int received;  // a pipelined client may already have sent the beginning of its next requests
+    std::vector<unsigned char> pending;  // part of the last reply not yet accepted by the socket
+    int pendingOffset;
+    int servedGeneration;  // an observer receives at most one reply per snapshot
+    // last sensor values sent to the client, see the sensor block in remote_protocol.hpp
+    int lastSensorValues[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+    int repliesSinceKeyframe;
+  };
+
+  int listen(int port);
+  void accept(int listenSocket);
+  void receive(Client *client);
+  void flush(Client *client);
+  void send(Client *client, struct iovec *vector, int count);
+  void updateEvents(Client *client);
+  void disconnect(Client *client);
+  void removeDisconnectedClients();
+
+  void serveController();
+  void serveObservers();
+  int requestSize(Client *client);
+  void handleRequest(Client *client, int total);
+  void applyMotorField(int index, remote_protocol::PacketReader *request);
+  void readTrajectory(int index, remote_protocol::PacketReader *request);
+  bool advanceTrajectories(bool play);
+  void playTrajectories();
+  int playoutTimeout() const;
+  void step();
+  void takeSnapshot();
+  int encodeImage(bool adaptive);
+  void createSharedMemory(int port);
+  void publishSharedSnapshot();
+
+  RemoteRobot *mRemote;
+  CameraStreamer *mCameraStreamer;
+
+  int mControllerSocket;
+  int mObserverSocket;
+  int mEpoll;
+  bool mStopped;
+  std::map<int, Client *> mClients;
+  Client *mController;
+
+  // sensor values measured after the last step, in the slots of remote_protocol::SensorSlot
+  int mGeneration;
+  int mSensorValues[remote_protocol::NUMBER_OF_SENSOR_SLOTS];
+  // image of the snapshot, in the buffer of the camera streamer
+  int mImageGeneration;
+  bool mImageAdaptive;
+  int mImageLength;
+
+  // setpoints of the next steps sent by the controlling client, see remote_protocol.hpp
+  struct Trajectory {
+    int setpoints[remote_protocol::MAX_TRAJECTORY_LENGTH];
+    int next;
+    int count;
+    int origin;     // 'p' value the setpoints are relative to
+    bool replaced;  // by the request being handled
+  };
+  Trajectory mTrajectories[remote_protocol::NUMBER_OF_MOTORS];
+  int mTrajectoryStep;         // in microseconds
+  long long mNextPlayoutTime;  // when the robot steps on its own if no request arrives, -1 if never
+  int mStepsAhead;             // steps played on its own whose request has not arrived yet
+  int mPlayedSteps;
+
+  // shared memory for the local clients, NULL if it could not be created
+  remote_protocol::SharedRegion *mSharedRegion;
+  char mSharedMemoryName[remote_protocol::SHARED_MEMORY_NAME_SIZE];
+  int mSharedGeneration;  // last generation published
+
+  unsigned char mSendBuffer[remote_protocol::MAX_REPLY_SIZE_WITHOUT_IMAGE];
+};
+
+#endif
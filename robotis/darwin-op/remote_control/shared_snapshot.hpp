@@ -0,0 +1,90 @@
+// Copyright 1996-2022 Cyberbotics Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Description:   Layout of the shared memory through which the remote_control server
+//                gives its snapshots to a client running on the same machine
+
+#ifndef SHARED_SNAPSHOT_HPP
+#define SHARED_SNAPSHOT_HPP
+
+#include "remote_protocol.hpp"
+
+#include <string.h>
+
+// The server writes the snapshot of each step in the slot (generation % SHARED_SNAPSHOT_SLOTS)
+// and tells in its reply which generation to read (see the 'M' field in remote_protocol.hpp).
+// There is one writer and no lock: the sequence of a slot is odd while it is written, a reader
+// copies the slot and checks that the sequence did not change in the meantime. Between two requests
+// of a client, the server may step on its own once per setpoint of the trajectories (see
+// MAX_TRAJECTORY_LENGTH), and the client has at most a few requests in flight: the ring is larger than
+// both together, so the slot of a reply is not written again before it is read.
+
+namespace remote_protocol {
+  enum {
+    SHARED_SNAPSHOT_SLOTS = MAX_TRAJECTORY_LENGTH + 4,
+    SHARED_IMAGE_SIZE = 4 * 320 * 240  // BGRA camera image
+  };
+
+  static const unsigned int SHARED_REGION_MAGIC = 0x4F503252;  // "OP2R"
+
+  struct SharedSnapshot {
+    volatile unsigned int sequence;
+    int generation;
+    int sensorValues[NUMBER_OF_SENSOR_SLOTS];  // in the order of SensorSlot
+    int imageWidth;
+    int imageHeight;
+    unsigned char image[SHARED_IMAGE_SIZE];
+  };
+
+  struct SharedRegion {
+    unsigned int magic;
+    int slotCount;
+    SharedSnapshot slots[SHARED_SNAPSHOT_SLOTS];
+  };
+
+  // image is imageWidth x imageHeight BGRA pixels, rows are separated by stride bytes
+  inline void writeSharedSnapshot(SharedSnapshot *snapshot, int generation, const int *sensorValues,
+                                  const unsigned char *image, int imageWidth, int imageHeight, int stride) {
+    snapshot->sequence++;
+    __sync_synchronize();
+    snapshot->generation = generation;
+    memcpy(snapshot->sensorValues, sensorValues, sizeof(snapshot->sensorValues));
+    snapshot->imageWidth = imageWidth;
+    snapshot->imageHeight = imageHeight;
+    for (int y = 0; image && y < imageHeight; y++)
+      memcpy(snapshot->image + 4 * imageWidth * y, image + stride * y, 4 * imageWidth);
+    __sync_synchronize();
+    snapshot->sequence++;
+  }
+
+  // copies the snapshot of the given generation, image may be NULL if it is not needed,
+  // returns false if the slot holds another generation or was written during the copy
+  inline bool readSharedSnapshot(const SharedSnapshot *snapshot, int generation, int *sensorValues,
+                                 unsigned char *image, int imageWidth, int imageHeight) {
+    const unsigned int sequence = snapshot->sequence;
+    __sync_synchronize();
+    if ((sequence & 1) || snapshot->generation != generation)
+      return false;
+    memcpy(sensorValues, snapshot->sensorValues, sizeof(snapshot->sensorValues));
+    if (image) {
+      if (snapshot->imageWidth != imageWidth || snapshot->imageHeight != imageHeight)
+        return false;
+      memcpy(image, snapshot->image, 4 * imageWidth * imageHeight);
+    }
+    __sync_synchronize();
+    return snapshot->sequence == sequence;
+  }
+}  // namespace remote_protocol
+
+#endif
@@ -74,6 +74,17 @@ namespace webots {
     void setPresentSpeed(int speed);
     void setPresentLoad(int load);
 
+    bool hasMotionChanged() const { return mGoalPosition != mSentGoalPosition || mMovingSpeed != mSentMovingSpeed; }
+    bool hasSettingsChanged() const { return mPGain != mSentPGain || mTorqueLimit != mSentTorqueLimit; }
+    void markMotionSent();
+    void markSettingsSent();
+    void invalidateSentValues();
+
+    // Resolved once from the static maps //
+    int mID;
+    int mLimUp;
+    int mLimDown;
+
     // For acceleration module //
     double mAcceleration;
     double mActualVelocity;
@@ -87,12 +98,17 @@ namespace webots {
     int mTorqueLimit;
     int mTorqueFeedback;
 
+    // Last values sent by SynchWrite (-1 = unknown) //
+    int mSentGoalPosition;
+    int mSentPGain;
+    int mSentMovingSpeed;
+    int mSentTorqueLimit;
+
     // For Bulk Read //
     int mPresentSpeed;
     int mPresentLoad;
 
-    friend int Robot::step(int duration);
-    friend Robot::Robot();
+    friend class Robot;
   };
 }  // namespace webots
 
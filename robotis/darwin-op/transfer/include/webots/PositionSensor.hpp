@@ -45,13 +45,14 @@ namespace webots {
 
     void setPresentPosition(int position);
 
+    int mID;
+
     // For Bulk Read //
     int mPresentPosition;
 
     int mFeedback;
 
-    friend int Robot::step(int duration);
-    friend Robot::Robot();
+    friend class Robot;
   };
 }  // namespace webots
 
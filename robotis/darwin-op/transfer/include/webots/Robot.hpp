@@ -19,9 +19,10 @@
 #ifndef ROBOT_HPP
 #define ROBOT_HPP
 
-#include <sys/time.h>
+#include <time.h>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <minIni.h>
 
@@ -59,27 +60,54 @@ namespace webots {
     PositionSensor *getPositionSensor(const std::string &name) const;
     Speaker *getSpeaker(const std::string &name) const;
     Keyboard *getKeyboard() const { return mKeyboard; }
+    int getNumberOfDevices() const { return (int)mDeviceList.size(); }
+    Device *getDeviceByIndex(int index) const;
 
     // not member(s) of the Webots API function: please don't use
     ::Robot::CM730 *getCM730() const { return mCM730; }
     static Robot *getInstance() { return cInstance; }
 
+    // step timing, not member(s) of the Webots API
+    int getStepOverrunCount() const { return mOverrunCount; }
+    double getStepSlack() const { return mStepSlack; }  // [ms] margin to the deadline of the last step, negative if late
+    void setStepBusyWait(int microseconds) { mBusyWait = microseconds; }
+
   private:
+    enum DeviceType { ACCELEROMETER, CAMERA, GYRO, LED_DEVICE, MOTOR, POSITION_SENSOR, SPEAKER };
+    static const int cNumberOfMotors = 20;
+
     void initDevices();
+    void addDevice(Device *device, DeviceType type);
     void initRobotisOp2();
     void LoadINISettings(minIni *ini, const std::string &section);
-    Device *getDevice(const std::string &name) const;
+    Device *getDevice(const std::string &name, DeviceType type) const;
 
     static Robot *cInstance;
 
-    std::map<const std::string, Device *> mDevices;
+    // the devices are resolved once by name into a dense tag, the typed arrays below are indexed by tag or by motor id - 1
+    std::map<const std::string, int> mDeviceTags;
+    std::vector<Device *> mDeviceList;
+    std::vector<DeviceType> mDeviceTypes;
+    Motor *mMotors[cNumberOfMotors];
+    PositionSensor *mPositionSensors[cNumberOfMotors];
+    Accelerometer *mAccelerometer;
+    Gyro *mGyro;
+    LED *mHeadLed;
+    LED *mEyeLed;
 
     int mTimeStep;
+    int mRefreshPeriod;
+    int mStepsSinceRefresh;
     Keyboard *mKeyboard;
     ::Robot::LinuxCM730 *mLinuxCM730;
     ::Robot::CM730 *mCM730;
-    struct timeval mStart;
+    struct timespec mStart;
     double mPreviousStepTime;
+    struct timespec mDeadline;
+    bool mDeadlineSet;
+    int mOverrunCount;
+    double mStepSlack;
+    int mBusyWait;
   };
 }  // namespace webots
 
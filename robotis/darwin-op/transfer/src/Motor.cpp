@@ -42,6 +42,9 @@ template<typename T> int sgn(T val) {
 
 Motor::Motor(const std::string &name) : Device(name) {
   initStaticMap();
+  mID = mNamesToIDs[getName()];
+  mLimUp = mNamesToLimUp[getName()];
+  mLimDown = mNamesToLimDown[getName()];
   mAcceleration = -1;
   mMaxVelocity = 10;
   mActualVelocity = 0;
@@ -53,6 +56,7 @@ Motor::Motor(const std::string &name) : Device(name) {
   mPresentSpeed = 0;
   mPresentLoad = 0;
   mTorqueFeedback = 0;
+  invalidateSentValues();
 }
 
 Motor::~Motor() {
@@ -169,7 +173,7 @@ void Motor::setVelocity(double vel) {
 void Motor::setTorque(double torque) {
   CM730 *cm730 = Robot::getInstance()->getCM730();
   if (torque == 0)
-    cm730->WriteWord(mNamesToIDs[getName()], MX28::P_TORQUE_ENABLE, 0, 0);
+    cm730->WriteWord(mID, MX28::P_TORQUE_ENABLE, 0, 0);
   else {
     this->setAvailableTorque(fabs(torque));
     int firm_ver = 0;
@@ -177,9 +181,9 @@ void Motor::setTorque(double torque) {
       cerr << "Can't read firmware version from Dynamixel ID " << JointData::ID_HEAD_PAN << endl;
     else if (27 <= firm_ver) {
       if (torque > 0)
-        mGoalPosition = mNamesToLimDown[getName()];
+        mGoalPosition = mLimDown;
       else
-        mGoalPosition = mNamesToLimUp[getName()];
+        mGoalPosition = mLimUp;
     } else
       cerr << "Motor::setTorque not available for this version of Dynamixel firmware, please update it." << endl;
   }
@@ -196,7 +200,7 @@ void Motor::setAvailableTorque(double availableTorque) {
   } else {
     mTorqueLimit = 0;
     mTorqueEnable = 0;
-    cm730->WriteWord(mNamesToIDs[getName()], MX28::P_TORQUE_ENABLE, 0, 0);
+    cm730->WriteWord(mID, MX28::P_TORQUE_ENABLE, 0, 0);
   }
 
   // don't override the motor alarm
@@ -242,10 +246,10 @@ void Motor::setPosition(double position) {
   if (value >= 0 && value <= MX28::MAX_VALUE) {
     //       Self-Collision Avoidance      //
     // Work only with a resolution of 4096 //
-    if (value > mNamesToLimUp[getName()])
-      value = mNamesToLimUp[getName()];
-    else if (value < mNamesToLimDown[getName()])
-      value = mNamesToLimDown[getName()];
+    if (value > mLimUp)
+      value = mLimUp;
+    else if (value < mLimDown)
+      value = mLimDown;
 
     mGoalPosition = value;
   }
@@ -312,16 +316,33 @@ void Motor::setPresentLoad(int load) {
   mPresentLoad = load;
 }
 
+void Motor::markMotionSent() {
+  mSentGoalPosition = mGoalPosition;
+  mSentMovingSpeed = mMovingSpeed;
+}
+
+void Motor::markSettingsSent() {
+  mSentPGain = mPGain;
+  mSentTorqueLimit = mTorqueLimit;
+}
+
+void Motor::invalidateSentValues() {
+  mSentGoalPosition = -1;
+  mSentPGain = -1;
+  mSentMovingSpeed = -1;
+  mSentTorqueLimit = -1;
+}
+
 double Motor::getTargetPosition() const {
   return mGoalPosition;
 }
 
 double Motor::getMinPosition() const {
-  return (MX28::Value2Angle(mNamesToLimDown[getName()]) * (M_PI / 180.0));
+  return (MX28::Value2Angle(mLimDown) * (M_PI / 180.0));
 }
 
 double Motor::getMaxPosition() const {
-  return (MX28::Value2Angle(mNamesToLimUp[getName()]) * (M_PI / 180.0));
+  return (MX28::Value2Angle(mLimUp) * (M_PI / 180.0));
 }
 
 int Motor::getType() const {
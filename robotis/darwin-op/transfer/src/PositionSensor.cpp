@@ -33,6 +33,7 @@ std::map<const std::string, int> PositionSensor::mNamesToInitPos;
 
 PositionSensor::PositionSensor(const std::string &name) : Device(name) {
   initStaticMap();
+  mID = mNamesToIDs[getName()];
   mPresentPosition = mNamesToInitPos[getName()];
   mFeedback = 0;
 }
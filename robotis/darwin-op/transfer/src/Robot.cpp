@@ -26,6 +26,7 @@
 
 #include "LinuxDARwIn.h"
 
+#include <errno.h>
 #include <libgen.h>
 #include <unistd.h>
 #include <iostream>
@@ -34,6 +35,19 @@ using namespace std;
 
 webots::Robot *webots::Robot::cInstance = NULL;
 
+static void addMilliseconds(struct timespec *t, int ms) {
+  t->tv_sec += ms / 1000;
+  t->tv_nsec += (long)(ms % 1000) * 1000000L;
+  if (t->tv_nsec >= 1000000000L) {
+    t->tv_sec++;
+    t->tv_nsec -= 1000000000L;
+  }
+}
+
+static double differenceInMilliseconds(const struct timespec &a, const struct timespec &b) {
+  return (a.tv_sec - b.tv_sec) * 1000.0 + (a.tv_nsec - b.tv_nsec) / 1000000.0;
+}
+
 webots::Robot::Robot() {
   if (cInstance == NULL)
     cInstance = this;
@@ -44,8 +58,12 @@ webots::Robot::Robot() {
 
   initRobotisOp2();
   initDevices();
-  gettimeofday(&mStart, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &mStart);
   mPreviousStepTime = 0.0;
+  mDeadlineSet = false;
+  mOverrunCount = 0;
+  mStepSlack = 0.0;
+  mBusyWait = 200;
   mKeyboard = new Keyboard();
 
   // Load TimeStep from the file "config.ini"
@@ -55,15 +73,15 @@ webots::Robot::Robot() {
     cout << "The time step selected of " << mTimeStep << "ms is very small and will probably not be respected." << endl;
     cout << "A time step of at least 16ms is recommended." << endl;
   }
+  mRefreshPeriod = mTimeStep > 0 && mTimeStep < 1000 ? 1000 / mTimeStep : 1;  // rewrite all the motors every second
+  mStepsSinceRefresh = 0;
 
   mCM730->MakeBulkReadPacketWb();  // Create the BulkReadPacket to read the actuators states in Robot::step
 
   // Unactive all Joints in the Motion Manager //
-  std::map<const std::string, int>::iterator motorIt;
-  for (motorIt = Motor::mNamesToIDs.begin(); motorIt != Motor::mNamesToIDs.end(); ++motorIt) {
-    ::Robot::MotionStatus::m_CurrentJoints.SetEnable((*motorIt).second, 0);
-    ::Robot::MotionStatus::m_CurrentJoints.SetValue((*motorIt).second,
-                                                    ((Motor *)mDevices[(*motorIt).first])->getGoalPosition());
+  for (int i = 0; i < cNumberOfMotors; i++) {
+    ::Robot::MotionStatus::m_CurrentJoints.SetEnable(mMotors[i]->mID, 0);
+    ::Robot::MotionStatus::m_CurrentJoints.SetValue(mMotors[i]->mID, mMotors[i]->getGoalPosition());
   }
 
   // Make each motors go to the start position slowly
@@ -71,9 +89,9 @@ webots::Robot::Robot() {
   int value, changed_motors = 0, n = 0;
   int param[20 * msgLength];
 
-  for (motorIt = Motor::mNamesToIDs.begin(); motorIt != Motor::mNamesToIDs.end(); ++motorIt) {
-    Motor *motor = static_cast<Motor *>(mDevices[(*motorIt).first]);
-    int motorId = (*motorIt).second;
+  for (int i = 0; i < cNumberOfMotors; i++) {
+    Motor *motor = mMotors[i];
+    int motorId = motor->mID;
     if (motor->getTorqueEnable() && !(::Robot::MotionStatus::m_CurrentJoints.GetEnable(motorId))) {
       param[n++] = motorId;              // id
       value = motor->getGoalPosition();  // Start position
@@ -97,19 +115,18 @@ webots::Robot::~Robot() {
 }
 
 int webots::Robot::step(int duration) {
+  struct timespec stepStart;
+  clock_gettime(CLOCK_MONOTONIC, &stepStart);
+
   // play motions if any
   Motion::playMotions();
 
   double actualTime = getTime() * 1000;
   int stepDuration = actualTime - mPreviousStepTime;
-  std::map<const std::string, int>::iterator motorIt;
-  std::map<const std::string, int>::iterator position_sensorIt;
 
   // -------- Update speed of each motors, according to acceleration limit if set --------  //
-  for (motorIt = Motor::mNamesToIDs.begin(); motorIt != Motor::mNamesToIDs.end(); ++motorIt) {
-    Motor *motor = static_cast<Motor *>(mDevices[(*motorIt).first]);
-    motor->updateSpeed(stepDuration);
-  }
+  for (int i = 0; i < cNumberOfMotors; i++)
+    mMotors[i]->updateSpeed(stepDuration);
 
   // -------- Bulk Read to read the actuators states (position, speed and load) and body sensors -------- //
   if (!(::Robot::MotionManager::GetInstance()->GetEnable()))  // If MotionManager is enable, no need to execute the BulkRead,
@@ -117,9 +134,9 @@ int webots::Robot::step(int duration) {
     mCM730->BulkRead();
 
   // Motors
-  for (motorIt = Motor::mNamesToIDs.begin(); motorIt != Motor::mNamesToIDs.end(); ++motorIt) {
-    Motor *motor = static_cast<Motor *>(mDevices[(*motorIt).first]);
-    int motorId = (*motorIt).second;
+  for (int i = 0; i < cNumberOfMotors; i++) {
+    Motor *motor = mMotors[i];
+    int motorId = motor->mID;
     motor->setPresentSpeed(mCM730->m_BulkReadData[motorId].ReadWord(::Robot::MX28::P_PRESENT_SPEED_L));
     motor->setPresentLoad(mCM730->m_BulkReadData[motorId].ReadWord(::Robot::MX28::P_PRESENT_LOAD_L));
 
@@ -131,12 +148,10 @@ int webots::Robot::step(int duration) {
   }
 
   // Position sensors
-  for (position_sensorIt = PositionSensor::mNamesToIDs.begin(); position_sensorIt != PositionSensor::mNamesToIDs.end();
-       ++position_sensorIt) {
-    PositionSensor *position_sensor = static_cast<PositionSensor *>(mDevices[(*position_sensorIt).first]);
-    int position_sensorId = (*position_sensorIt).second;
+  for (int i = 0; i < cNumberOfMotors; i++) {
+    PositionSensor *position_sensor = mPositionSensors[i];
     position_sensor->setPresentPosition(
-      mCM730->m_BulkReadData[position_sensorId].ReadWord(::Robot::MX28::P_PRESENT_POSITION_L));
+      mCM730->m_BulkReadData[position_sensor->mID].ReadWord(::Robot::MX28::P_PRESENT_POSITION_L));
   }
 
   int values[3];
@@ -145,19 +160,19 @@ int webots::Robot::step(int duration) {
   values[0] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_GYRO_X_L);
   values[1] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_GYRO_Y_L);
   values[2] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_GYRO_Z_L);
-  ((Gyro *)mDevices["Gyro"])->setValues(values);
+  mGyro->setValues(values);
 
   // Accelerometer
   values[0] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_ACCEL_X_L);
   values[1] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_ACCEL_Y_L);
   values[2] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_ACCEL_Z_L);
-  ((Accelerometer *)mDevices["Accelerometer"])->setValues(values);
+  mAccelerometer->setValues(values);
   // Led states
   values[0] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_LED_HEAD_L);
   values[1] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_LED_EYE_L);
   values[2] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadByte(::Robot::CM730::P_LED_PANNEL);
-  ((LED *)mDevices["HeadLed"])->setColor(values[0]);
-  ((LED *)mDevices["EyeLed"])->setColor(values[1]);
+  mHeadLed->setColor(values[0]);
+  mEyeLed->setColor(values[1]);
   LED::setBackPanel(values[2]);
 
   // push button state (TODO: check with real robot that the masks are correct)
@@ -166,47 +181,105 @@ int webots::Robot::step(int duration) {
   // values[2] = mCM730->m_BulkReadData[::Robot::CM730::ID_CM].ReadWord(::Robot::CM730::P_BUTTON) & 0x4;
 
   // -------- Sync Write to actuators --------  //
-  const int msgLength = 9;  // id + P + Empty + Goal Position (L + H) + Moving speed (L + H) + Torque Limit (L + H)
-
-  int param[20 * msgLength];
-  int n = 0;
-  int changed_motors = 0;
+  // Only the motors whose registers changed since the previous write are sent: goal position and moving speed change
+  // often and are written together, while P gain and torque limit rarely change and are written with the whole block.
+  // All the motors are periodically rewritten because a lost packet is not acknowledged.
+  const int settingsMsgLength = 9;  // id + P + Empty + Goal Position (L + H) + Moving speed (L + H) + Torque Limit (L + H)
+  const int motionMsgLength = 5;    // id + Goal Position (L + H) + Moving speed (L + H)
+
+  int settingsParam[20 * settingsMsgLength];
+  int motionParam[20 * motionMsgLength];
+  int settingsN = 0, motionN = 0;
+  int settingsMotors = 0, motionMotors = 0;
   int value;
 
-  for (motorIt = Motor::mNamesToIDs.begin(); motorIt != Motor::mNamesToIDs.end(); ++motorIt) {
-    Motor *motor = static_cast<Motor *>(mDevices[(*motorIt).first]);
-    int motorId = (*motorIt).second;
-    if (motor->getTorqueEnable() && !(::Robot::MotionStatus::m_CurrentJoints.GetEnable(motorId))) {
-      param[n++] = motorId;
-      param[n++] = motor->getPGain();
-      param[n++] = 0;  // Empty
+  bool refresh = false;
+  if (++mStepsSinceRefresh >= mRefreshPeriod) {
+    mStepsSinceRefresh = 0;
+    refresh = true;
+  }
+
+  for (int i = 0; i < cNumberOfMotors; i++) {
+    Motor *motor = mMotors[i];
+    int motorId = motor->mID;
+    if (!motor->getTorqueEnable() || ::Robot::MotionStatus::m_CurrentJoints.GetEnable(motorId)) {
+      // the registers are overwritten by the MotionManager or by the torque disabling
+      motor->invalidateSentValues();
+      continue;
+    }
+    if (refresh)
+      motor->invalidateSentValues();
+
+    if (motor->hasSettingsChanged()) {
+      settingsParam[settingsN++] = motorId;
+      settingsParam[settingsN++] = motor->getPGain();
+      settingsParam[settingsN++] = 0;  // Empty
       // TODO: controlPID should be implemented there
       value = motor->getGoalPosition();
-      param[n++] = ::Robot::CM730::GetLowByte(value);
-      param[n++] = ::Robot::CM730::GetHighByte(value);
+      settingsParam[settingsN++] = ::Robot::CM730::GetLowByte(value);
+      settingsParam[settingsN++] = ::Robot::CM730::GetHighByte(value);
       value = motor->getMovingSpeed();
-      param[n++] = ::Robot::CM730::GetLowByte(value);
-      param[n++] = ::Robot::CM730::GetHighByte(value);
+      settingsParam[settingsN++] = ::Robot::CM730::GetLowByte(value);
+      settingsParam[settingsN++] = ::Robot::CM730::GetHighByte(value);
       value = motor->getTorqueLimit();
-      param[n++] = ::Robot::CM730::GetLowByte(value);
-      param[n++] = ::Robot::CM730::GetHighByte(value);
-      changed_motors++;
+      settingsParam[settingsN++] = ::Robot::CM730::GetLowByte(value);
+      settingsParam[settingsN++] = ::Robot::CM730::GetHighByte(value);
+      motor->markSettingsSent();
+      motor->markMotionSent();
+      settingsMotors++;
+    } else if (motor->hasMotionChanged()) {
+      motionParam[motionN++] = motorId;
+      value = motor->getGoalPosition();
+      motionParam[motionN++] = ::Robot::CM730::GetLowByte(value);
+      motionParam[motionN++] = ::Robot::CM730::GetHighByte(value);
+      value = motor->getMovingSpeed();
+      motionParam[motionN++] = ::Robot::CM730::GetLowByte(value);
+      motionParam[motionN++] = ::Robot::CM730::GetHighByte(value);
+      motor->markMotionSent();
+      motionMotors++;
     }
   }
-  mCM730->SyncWrite(::Robot::MX28::P_P_GAIN, msgLength, changed_motors, param);
+  if (settingsMotors > 0)
+    mCM730->SyncWrite(::Robot::MX28::P_P_GAIN, settingsMsgLength, settingsMotors, settingsParam);
+  if (motionMotors > 0)
+    mCM730->SyncWrite(::Robot::MX28::P_GOAL_POSITION_L, motionMsgLength, motionMotors, motionParam);
 
   // -------- Keyboard Reset ----------- //
   mKeyboard->resetKeyboard();
 
   // -------- Timing management -------- //
-  if (stepDuration < duration) {  // Step to short -> wait remaining time
-    usleep((duration - stepDuration) * 1000);
-    mPreviousStepTime = actualTime;
-    return 0;
-  } else {  // Step to long -> return step duration
-    mPreviousStepTime = actualTime;
-    return stepDuration;
+  // The deadlines are absolute on the monotonic clock so that late wake-ups do not accumulate: sleep until shortly
+  // before the deadline, then busy-wait the last microseconds to compensate the scheduler latency.
+  if (!mDeadlineSet) {
+    mDeadline = stepStart;
+    mDeadlineSet = true;
   }
+  addMilliseconds(&mDeadline, duration);
+  mPreviousStepTime = actualTime;
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  mStepSlack = differenceInMilliseconds(mDeadline, now);
+  if (mStepSlack < 0) {  // Step to long -> return step duration
+    mOverrunCount++;
+    int elapsed = duration - mStepSlack;
+    if (-mStepSlack > duration)  // more than a whole step late: restart the schedule instead of rushing the next steps
+      mDeadline = now;
+    return elapsed;
+  }
+
+  struct timespec wakeUp = mDeadline;
+  wakeUp.tv_nsec -= mBusyWait * 1000L;
+  while (wakeUp.tv_nsec < 0) {
+    wakeUp.tv_sec--;
+    wakeUp.tv_nsec += 1000000000L;
+  }
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL) == EINTR) {
+  }
+  do
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  while (differenceInMilliseconds(mDeadline, now) > 0);
+  return 0;
 }
 
 std::string webots::Robot::getName() const {
@@ -214,15 +287,11 @@ std::string webots::Robot::getName() const {
 }
 
 double webots::Robot::getTime() const {
-  struct timeval end;
-
-  gettimeofday(&end, NULL);
+  struct timespec end;
 
-  long seconds = end.tv_sec - mStart.tv_sec;
-  long useconds = end.tv_usec - mStart.tv_usec;
-  long mtime = (seconds * 1000 + useconds / 1000.0) + 0.5;
+  clock_gettime(CLOCK_MONOTONIC, &end);
 
-  return (double)mtime / 1000.0;
+  return differenceInMilliseconds(end, mStart) / 1000.0;
 }
 
 int webots::Robot::getMode() const {
@@ -233,133 +302,116 @@ double webots::Robot::getBasicTimeStep() const {
   return mTimeStep;
 }
 
-webots::Device *webots::Robot::getDevice(const std::string &name) const {
-  std::map<const std::string, webots::Device *>::const_iterator it = mDevices.find(name);
-  if (it != mDevices.end())
-    return (*it).second;
+webots::Device *webots::Robot::getDeviceByIndex(int index) const {
+  if (index >= 0 && index < (int)mDeviceList.size())
+    return mDeviceList[index];
   return NULL;
 }
 
-webots::Accelerometer *webots::Robot::getAccelerometer(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::Accelerometer *accelerometer = dynamic_cast<webots::Accelerometer *>(device);
-    if (accelerometer)
-      return accelerometer;
-  }
+webots::Device *webots::Robot::getDevice(const std::string &name, DeviceType type) const {
+  std::map<const std::string, int>::const_iterator it = mDeviceTags.find(name);
+  if (it != mDeviceTags.end() && mDeviceTypes[(*it).second] == type)
+    return mDeviceList[(*it).second];
   return NULL;
 }
 
+webots::Accelerometer *webots::Robot::getAccelerometer(const std::string &name) const {
+  return static_cast<webots::Accelerometer *>(getDevice(name, ACCELEROMETER));
+}
+
 webots::Camera *webots::Robot::getCamera(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::Camera *camera = dynamic_cast<webots::Camera *>(device);
-    if (camera)
-      return camera;
-  }
-  return NULL;
+  return static_cast<webots::Camera *>(getDevice(name, CAMERA));
 }
 
 webots::Gyro *webots::Robot::getGyro(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::Gyro *gyro = dynamic_cast<webots::Gyro *>(device);
-    if (gyro)
-      return gyro;
-  }
-  return NULL;
+  return static_cast<webots::Gyro *>(getDevice(name, GYRO));
 }
 
 webots::Motor *webots::Robot::getMotor(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::Motor *motor = dynamic_cast<webots::Motor *>(device);
-    if (motor)
-      return motor;
-  }
-  return NULL;
+  return static_cast<webots::Motor *>(getDevice(name, MOTOR));
 }
 
 webots::PositionSensor *webots::Robot::getPositionSensor(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::PositionSensor *position_sensor = dynamic_cast<webots::PositionSensor *>(device);
-    if (position_sensor)
-      return position_sensor;
-  }
-  return NULL;
+  return static_cast<webots::PositionSensor *>(getDevice(name, POSITION_SENSOR));
 }
 
 webots::LED *webots::Robot::getLED(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::LED *led = dynamic_cast<webots::LED *>(device);
-    if (led)
-      return led;
-  }
-  return NULL;
+  return static_cast<webots::LED *>(getDevice(name, LED_DEVICE));
 }
 
 webots::Speaker *webots::Robot::getSpeaker(const std::string &name) const {
-  webots::Device *device = getDevice(name);
-  if (device) {
-    webots::Speaker *speaker = dynamic_cast<webots::Speaker *>(device);
-    if (speaker)
-      return speaker;
+  return static_cast<webots::Speaker *>(getDevice(name, SPEAKER));
+}
+
+void webots::Robot::addDevice(webots::Device *device, DeviceType type) {
+  mDeviceTags[device->getName()] = mDeviceList.size();
+  mDeviceList.push_back(device);
+  mDeviceTypes.push_back(type);
+
+  if (type == MOTOR) {
+    Motor *motor = static_cast<Motor *>(device);
+    mMotors[motor->mID - 1] = motor;
+  } else if (type == POSITION_SENSOR) {
+    PositionSensor *position_sensor = static_cast<PositionSensor *>(device);
+    mPositionSensors[position_sensor->mID - 1] = position_sensor;
   }
-  return NULL;
 }
 
 void webots::Robot::initDevices() {
-  mDevices["Accelerometer"] = new webots::Accelerometer("Accelerometer");
-  mDevices["Camera"] = new webots::Camera("Camera");
-  mDevices["Gyro"] = new webots::Gyro("Gyro");
-  mDevices["EyeLed"] = new webots::LED("EyeLed");
-  mDevices["HeadLed"] = new webots::LED("HeadLed");
-  mDevices["BackLedRed"] = new webots::LED("BackLedRed");
-  mDevices["BackLedGreen"] = new webots::LED("BackLedGreen");
-  mDevices["BackLedBlue"] = new webots::LED("BackLedBlue");
-  mDevices["ShoulderR"] = new webots::Motor("ShoulderR");
-  mDevices["ShoulderL"] = new webots::Motor("ShoulderL");
-  mDevices["ArmUpperR"] = new webots::Motor("ArmUpperR");
-  mDevices["ArmUpperL"] = new webots::Motor("ArmUpperL");
-  mDevices["ArmLowerR"] = new webots::Motor("ArmLowerR");
-  mDevices["ArmLowerL"] = new webots::Motor("ArmLowerL");
-  mDevices["PelvYR"] = new webots::Motor("PelvYR");
-  mDevices["PelvYL"] = new webots::Motor("PelvYL");
-  mDevices["PelvR"] = new webots::Motor("PelvR");
-  mDevices["PelvL"] = new webots::Motor("PelvL");
-  mDevices["LegUpperR"] = new webots::Motor("LegUpperR");
-  mDevices["LegUpperL"] = new webots::Motor("LegUpperL");
-  mDevices["LegLowerR"] = new webots::Motor("LegLowerR");
-  mDevices["LegLowerL"] = new webots::Motor("LegLowerL");
-  mDevices["AnkleR"] = new webots::Motor("AnkleR");
-  mDevices["AnkleL"] = new webots::Motor("AnkleL");
-  mDevices["FootR"] = new webots::Motor("FootR");
-  mDevices["FootL"] = new webots::Motor("FootL");
-  mDevices["Neck"] = new webots::Motor("Neck");
-  mDevices["Head"] = new webots::Motor("Head");
-  mDevices["ShoulderRS"] = new webots::PositionSensor("ShoulderRS");
-  mDevices["ShoulderLS"] = new webots::PositionSensor("ShoulderLS");
-  mDevices["ArmUpperRS"] = new webots::PositionSensor("ArmUpperRS");
-  mDevices["ArmUpperLS"] = new webots::PositionSensor("ArmUpperLS");
-  mDevices["ArmLowerRS"] = new webots::PositionSensor("ArmLowerRS");
-  mDevices["ArmLowerLS"] = new webots::PositionSensor("ArmLowerLS");
-  mDevices["PelvYRS"] = new webots::PositionSensor("PelvYRS");
-  mDevices["PelvYLS"] = new webots::PositionSensor("PelvYLS");
-  mDevices["PelvRS"] = new webots::PositionSensor("PelvRS");
-  mDevices["PelvLS"] = new webots::PositionSensor("PelvLS");
-  mDevices["LegUpperRS"] = new webots::PositionSensor("LegUpperRS");
-  mDevices["LegUpperLS"] = new webots::PositionSensor("LegUpperLS");
-  mDevices["LegLowerRS"] = new webots::PositionSensor("LegLowerRS");
-  mDevices["LegLowerLS"] = new webots::PositionSensor("LegLowerLS");
-  mDevices["AnkleRS"] = new webots::PositionSensor("AnkleRS");
-  mDevices["AnkleLS"] = new webots::PositionSensor("AnkleLS");
-  mDevices["FootRS"] = new webots::PositionSensor("FootRS");
-  mDevices["FootLS"] = new webots::PositionSensor("FootLS");
-  mDevices["NeckS"] = new webots::PositionSensor("NeckS");
-  mDevices["HeadS"] = new webots::PositionSensor("HeadS");
-  mDevices["Speaker"] = new webots::Speaker("Speaker");
+  addDevice(new webots::Accelerometer("Accelerometer"), ACCELEROMETER);
+  addDevice(new webots::Camera("Camera"), CAMERA);
+  addDevice(new webots::Gyro("Gyro"), GYRO);
+  addDevice(new webots::LED("EyeLed"), LED_DEVICE);
+  addDevice(new webots::LED("HeadLed"), LED_DEVICE);
+  addDevice(new webots::LED("BackLedRed"), LED_DEVICE);
+  addDevice(new webots::LED("BackLedGreen"), LED_DEVICE);
+  addDevice(new webots::LED("BackLedBlue"), LED_DEVICE);
+  addDevice(new webots::Motor("ShoulderR"), MOTOR);
+  addDevice(new webots::Motor("ShoulderL"), MOTOR);
+  addDevice(new webots::Motor("ArmUpperR"), MOTOR);
+  addDevice(new webots::Motor("ArmUpperL"), MOTOR);
+  addDevice(new webots::Motor("ArmLowerR"), MOTOR);
+  addDevice(new webots::Motor("ArmLowerL"), MOTOR);
+  addDevice(new webots::Motor("PelvYR"), MOTOR);
+  addDevice(new webots::Motor("PelvYL"), MOTOR);
+  addDevice(new webots::Motor("PelvR"), MOTOR);
+  addDevice(new webots::Motor("PelvL"), MOTOR);
+  addDevice(new webots::Motor("LegUpperR"), MOTOR);
+  addDevice(new webots::Motor("LegUpperL"), MOTOR);
+  addDevice(new webots::Motor("LegLowerR"), MOTOR);
+  addDevice(new webots::Motor("LegLowerL"), MOTOR);
+  addDevice(new webots::Motor("AnkleR"), MOTOR);
+  addDevice(new webots::Motor("AnkleL"), MOTOR);
+  addDevice(new webots::Motor("FootR"), MOTOR);
+  addDevice(new webots::Motor("FootL"), MOTOR);
+  addDevice(new webots::Motor("Neck"), MOTOR);
+  addDevice(new webots::Motor("Head"), MOTOR);
+  addDevice(new webots::PositionSensor("ShoulderRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("ShoulderLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("ArmUpperRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("ArmUpperLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("ArmLowerRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("ArmLowerLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("PelvYRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("PelvYLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("PelvRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("PelvLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("LegUpperRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("LegUpperLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("LegLowerRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("LegLowerLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("AnkleRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("AnkleLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("FootRS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("FootLS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("NeckS"), POSITION_SENSOR);
+  addDevice(new webots::PositionSensor("HeadS"), POSITION_SENSOR);
+  addDevice(new webots::Speaker("Speaker"), SPEAKER);
+
+  mAccelerometer = getAccelerometer("Accelerometer");
+  mGyro = getGyro("Gyro");
+  mHeadLed = getLED("HeadLed");
+  mEyeLed = getLED("EyeLed");
 }
 
 void webots::Robot::initRobotisOp2() {